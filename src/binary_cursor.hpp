@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+// bounds-checked reader over an in-memory image of a file (e.g. a mapped
+// ndfbin), every read throws instead of running past the end of the data
+class BinaryCursor {
+private:
+  std::span<const std::byte> m_data;
+  size_t m_pos = 0;
+
+  void require(size_t count) const {
+    if (count > m_data.size() - m_pos) {
+      throw std::runtime_error(
+          std::format("BinaryCursor: read of {} bytes @0x{:02X} past end 0x{:02X}",
+                      count, m_pos, m_data.size()));
+    }
+  }
+
+public:
+  BinaryCursor() = default;
+  explicit BinaryCursor(std::span<const std::byte> data) : m_data(data) {}
+
+  [[nodiscard]] size_t tell() const { return m_pos; }
+  [[nodiscard]] size_t size() const { return m_data.size(); }
+  [[nodiscard]] size_t remaining() const { return m_data.size() - m_pos; }
+  [[nodiscard]] std::span<const std::byte> data() const { return m_data; }
+
+  void seek(size_t pos) {
+    if (pos > m_data.size()) {
+      throw std::runtime_error(
+          std::format("BinaryCursor: seek to 0x{:02X} past end 0x{:02X}", pos,
+                      m_data.size()));
+    }
+    m_pos = pos;
+  }
+
+  void skip(size_t count) {
+    require(count);
+    m_pos += count;
+  }
+
+  template <typename T> T read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    require(sizeof(T));
+    T value;
+    std::memcpy(&value, m_data.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return value;
+  }
+
+  // returns a view into the underlying data, no copy is made
+  std::span<const std::byte> read_bytes(size_t count) {
+    require(count);
+    auto ret = m_data.subspan(m_pos, count);
+    m_pos += count;
+    return ret;
+  }
+
+  std::string_view read_string(size_t length) {
+    auto bytes = read_bytes(length);
+    return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+  }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// growable in-memory output buffer, the counterpart of BinaryCursor. code
+// written against std::ostream (to_ndfbin of the properties) appends to it
+// through stream(), nothing ever seeks
+class BinaryWriter : private std::streambuf {
+private:
+  std::vector<std::byte> m_data;
+  std::ostream m_stream{this};
+
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      m_data.push_back(std::byte(traits_type::to_char_type(c)));
+    }
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char *data, std::streamsize count) override {
+    write_bytes({reinterpret_cast<const std::byte *>(data), size_t(count)});
+    return count;
+  }
+
+public:
+  BinaryWriter() = default;
+  // the stream points at this object
+  BinaryWriter(const BinaryWriter &) = delete;
+  BinaryWriter &operator=(const BinaryWriter &) = delete;
+
+  [[nodiscard]] size_t size() const { return m_data.size(); }
+  [[nodiscard]] std::span<const std::byte> data() const { return m_data; }
+  [[nodiscard]] std::ostream &stream() { return m_stream; }
+
+  void reserve(size_t size) { m_data.reserve(size); }
+  void clear() { m_data.clear(); }
+  // hands out the buffer, the writer is empty afterwards
+  std::vector<std::byte> release() { return std::exchange(m_data, {}); }
+
+  template <typename T> void write(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write_bytes({reinterpret_cast<const std::byte *>(&value), sizeof(T)});
+  }
+
+  void write_bytes(std::span<const std::byte> bytes) {
+    m_data.insert(m_data.end(), bytes.begin(), bytes.end());
+  }
+
+  // length prefixed string, the way ndfbin stores its tables
+  void write_string(std::string_view str) {
+    write<uint32_t>(str.size());
+    write_bytes({reinterpret_cast<const std::byte *>(str.data()), str.size()});
+  }
+};
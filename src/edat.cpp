@@ -6,6 +6,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 using namespace etcetera;
 using namespace std::string_literals;
@@ -27,6 +28,13 @@ int main(int argc, char **argv) {
       .default_value(false)
       .implicit_value(true)
       .help("Don't read the files, just parse the dictionary, necessary for some ndfbin edats.");
+  program.add_argument("-j", "--jobs")
+      .default_value(std::max(std::thread::hardware_concurrency(), 1u))
+      .scan<'u', unsigned int>()
+      .help("number of files extracted or packed in parallel");
+  program.add_argument("-u", "--update").help(
+      "update the input file with all files below this folder, their path relative to it is the path in the "
+      "archive. only replaced and added files get read, the updated archive replaces the input once it is complete.");
   program.add_argument("-p", "--pack").default_value(false).implicit_value(true).help(
       "instead of parsing the input file, pack the input xml file into an edat file, ignored if -r is set.");
 
@@ -52,35 +60,46 @@ int main(int argc, char **argv) {
 
   fs::path input_path = program.get("input");
 
+  if(auto update = program.present("--update")) {
+    fs::path update_path = *update;
+    std::map<std::string, fs::path> changes;
+    for(const auto &entry : fs::recursive_directory_iterator(update_path)) {
+      if(entry.is_regular_file()) {
+        changes.emplace(entry.path().lexically_relative(update_path).generic_string(), entry.path());
+      }
+    }
+    auto edat = EDat::create();
+    edat->jobs = program.get<unsigned int>("--jobs");
+    edat->update_archive(input_path, changes);
+    return 0;
+  }
+
   if(program.get<bool>("-r")) {
     spdlog::debug("input path {}", input_path.c_str());
-    std::ifstream input;
-    input.open(input_path, std::ios::binary);
     auto edat = EDat::create();
+    edat->jobs = program.get<unsigned int>("--jobs");
     if(!program.get<bool>("-i")) {
       edat->outpath = program.get("--output");
     } else {
       edat->outpath = fs::temp_directory_path();
     }
-    edat->parse(input);
+    edat->parse_file(input_path);
     auto output_path = input_path;
     if(!program.get<bool>("-i")) {
       output_path = program.get("--output") / input_path.filename();
     }
     spdlog::debug("Output path: {}", output_path.c_str());
-    std::fstream ofs(output_path, std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc);
-    edat->build(ofs);
+    edat->build_file(output_path);
     return 0;
   }
 
   auto edat = EDat::create();
   edat->outpath = program.get("--output");
   edat->read_files = !program.get<bool>("--dont-read-files");
+  edat->jobs = program.get<unsigned int>("--jobs");
 
   if(!program.get<bool>("-p")) {
-    std::ifstream input;
-    input.open(program.get("input"), std::ios::binary);
-    edat->parse(input);
+    edat->parse_file(input_path);
 
     pugi::xml_document doc;
     auto root = doc.append_child("root");
@@ -93,7 +112,6 @@ int main(int argc, char **argv) {
     spdlog::debug("Load result: {}", result.description());
     edat->parse_xml(doc.child("root").child("EDat"), "EDat", true);
 
-    std::fstream ofs(program.get("--output") / input_path.filename().replace_extension(".dat"), std::fstream::in | std::fstream::out | std::fstream::binary | std::fstream::trunc);
-    edat->build(ofs);
+    edat->build_file(program.get("--output") / input_path.filename().replace_extension(".dat"));
   }
 }
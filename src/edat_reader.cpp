@@ -0,0 +1,168 @@
+#include "edat_reader.hpp"
+
+#include "parallel_for.hpp"
+#include "positional_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <set>
+#include <stdexcept>
+
+// strings in the dictionary are null terminated and padded to an even size
+static std::string_view read_aligned_string(BinaryCursor &cursor) {
+  auto data = cursor.data().subspan(cursor.tell());
+  auto end = std::ranges::find(data, std::byte{0});
+  if (end == data.end()) {
+    throw std::runtime_error(
+        std::format("EDatReader: unterminated string @0x{:02X}", cursor.tell()));
+  }
+  size_t length = end - data.begin();
+  auto ret = cursor.read_string(length);
+  cursor.skip(length % 2 == 0 ? 2 : 1);
+  return ret;
+}
+
+static void parse_path(BinaryCursor &cursor, const std::string &path,
+                       size_t ending, std::vector<EDatFile> &files) {
+  while (cursor.tell() < ending) {
+    size_t entry_start = cursor.tell();
+    auto path_size = cursor.read<uint32_t>();
+    auto entry_size = cursor.read<uint32_t>();
+    size_t entry_end = entry_size != 0 ? entry_start + entry_size : ending;
+
+    // path_size != 0 -> more parts of the path
+    // path_size == 0 -> the file header
+    if (path_size != 0 && cursor.tell() != ending) {
+      auto part = read_aligned_string(cursor);
+      if (cursor.tell() != entry_start + path_size) {
+        throw std::runtime_error(std::format(
+            "EDatReader: invalid path size @0x{:02X}", entry_start));
+      }
+      parse_path(cursor, path + std::string(part), entry_end, files);
+    } else {
+      auto header = cursor.read<EDatFileHeader>();
+      std::string file_path = path + std::string(read_aligned_string(cursor));
+      std::ranges::replace(file_path, '\\', '/');
+      files.emplace_back(std::move(file_path), header);
+    }
+
+    if (cursor.tell() != entry_end) {
+      throw std::runtime_error(std::format(
+          "EDatReader: invalid entry size @0x{:02X}", entry_start));
+    }
+  }
+}
+
+// data starts with the archive header, the dictionary has to follow it
+static EDatHeader parse_dictionary(std::span<const std::byte> data,
+                                   std::vector<EDatFile> &files) {
+  files.clear();
+  BinaryCursor cursor(data);
+  auto header = cursor.read<EDatHeader>();
+  if (header.magic[0] != 'e' || header.magic[1] != 'd' ||
+      header.magic[2] != 'a' || header.magic[3] != 't') {
+    throw std::runtime_error("EDatReader: invalid magic number");
+  }
+  if (header.offset_dictionary != sizeof(EDatHeader)) {
+    throw std::runtime_error("EDatReader: invalid dictionary offset");
+  }
+  if (header.size_dictionary == 0) {
+    return header;
+  }
+
+  auto empty = cursor.read<uint32_t>();
+  if (empty == 0x01) {
+    return header;
+  }
+  if (empty != 0x0A) {
+    throw std::runtime_error(
+        std::format("EDatReader: expected 0x01 or 0x0A, got {}", empty));
+  }
+  cursor.skip(6);
+
+  size_t ending = size_t(header.offset_dictionary) + header.size_dictionary;
+  if (ending > cursor.size()) {
+    throw std::runtime_error("EDatReader: dictionary is out of bounds");
+  }
+  parse_path(cursor, "", ending, files);
+
+  std::ranges::sort(files, {}, &EDatFile::first);
+  return header;
+}
+
+EDatHeader read_edat_dictionary(std::istream &stream,
+                                std::vector<EDatFile> &files) {
+  std::vector<std::byte> data(sizeof(EDatHeader));
+  auto read = [&](size_t offset, size_t size) {
+    stream.read(reinterpret_cast<char *>(data.data() + offset),
+                std::streamsize(size));
+    if (!stream) {
+      throw std::runtime_error("EDatReader: archive is truncated");
+    }
+  };
+  read(0, sizeof(EDatHeader));
+  EDatHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  // the offset gets checked by parse_dictionary, only read what follows
+  // the header
+  if (header.offset_dictionary == sizeof(EDatHeader)) {
+    data.resize(sizeof(EDatHeader) + header.size_dictionary);
+    read(sizeof(EDatHeader), header.size_dictionary);
+  }
+  return parse_dictionary(data, files);
+}
+
+void EDatReader::load(const fs::path &path) {
+  m_files.clear();
+  m_header = {};
+  m_archive.open(path);
+  m_path = path;
+  m_header = parse_dictionary(m_archive.data(), m_files);
+}
+
+std::optional<EDatFileHeader>
+EDatReader::get_file_header(std::string_view path) const {
+  std::string key(path);
+  std::ranges::replace(key, '\\', '/');
+  auto it = std::ranges::lower_bound(m_files, key, {}, &EDatFile::first);
+  if (it == m_files.end() || it->first != key) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::span<const std::byte> EDatReader::open(std::string_view path) const {
+  auto header = get_file_header(path);
+  if (!header) {
+    throw std::runtime_error(
+        std::format("EDatReader: no file {} in the archive", path));
+  }
+  size_t offset = size_t(m_header.offset_files) + header->offset;
+  if (offset + header->size > m_archive.size()) {
+    throw std::runtime_error(
+        std::format("EDatReader: file {} is out of bounds", path));
+  }
+  return m_archive.data().subspan(offset, header->size);
+}
+
+void extract_edat(const EDatReader &reader, const fs::path &outpath,
+                  unsigned jobs) {
+  auto &files = reader.get_files();
+  std::set<fs::path> directories;
+  for (const auto &[path, _] : files) {
+    directories.insert((outpath / fs::path(path)).parent_path());
+  }
+  for (const auto &directory : directories) {
+    fs::create_directories(directory);
+  }
+
+  PositionalFile archive(reader.get_path(), PositionalFile::Mode::read);
+  size_t offset_files = reader.get_header().offset_files;
+  parallel_for(files.size(), jobs, [&](size_t idx) {
+    const auto &[path, header] = files[idx];
+    PositionalFile file(outpath / fs::path(path), PositionalFile::Mode::write);
+    file.copy_from(archive, reader.get_archive(), offset_files + header.offset,
+                   header.size, 0);
+  });
+}
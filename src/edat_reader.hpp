@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary_cursor.hpp"
+#include "mapped_file.hpp"
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+#pragma pack(push, 1)
+struct EDatHeader {
+  uint8_t magic[4];
+  uint32_t unk0;
+  uint8_t pad0[17];
+  uint32_t offset_dictionary;
+  uint32_t size_dictionary;
+  uint32_t offset_files;
+  uint32_t size_files;
+  uint8_t pad1[4];
+  uint32_t sectorSize;
+  uint8_t checksum[16];
+  uint8_t pad2[972];
+};
+
+struct EDatFileHeader {
+  uint32_t offset;
+  uint32_t pad0;
+  uint32_t size;
+  uint32_t pad;
+  uint8_t checksum[16];
+};
+#pragma pack(pop)
+
+// a file of an archive, the path uses / like EDat
+using EDatFile = std::pair<std::string, EDatFileHeader>;
+
+// reads the header and the dictionary from the start of an archive in
+// stream, the files are sorted by path. only the dictionary is read, not the
+// files
+EDatHeader read_edat_dictionary(std::istream &stream,
+                                std::vector<EDatFile> &files);
+
+// read-only access to single files of an edat archive without extracting it.
+// only the dictionary gets parsed into a sorted index, the archive is mapped
+// and the files are handed out as views into the mapping
+class EDatReader {
+private:
+  fs::path m_path;
+  MappedFile m_archive;
+  EDatHeader m_header{};
+  // sorted by path
+  std::vector<EDatFile> m_files;
+
+public:
+  EDatReader() = default;
+  explicit EDatReader(const fs::path &path) { load(path); }
+
+  void load(const fs::path &path);
+
+  [[nodiscard]] const fs::path &get_path() const { return m_path; }
+  [[nodiscard]] const EDatHeader &get_header() const { return m_header; }
+  [[nodiscard]] const std::vector<EDatFile> &get_files() const {
+    return m_files;
+  }
+  // the whole archive as mapped
+  [[nodiscard]] std::span<const std::byte> get_archive() const {
+    return m_archive.data();
+  }
+
+  [[nodiscard]] std::optional<EDatFileHeader>
+  get_file_header(std::string_view path) const;
+  [[nodiscard]] bool contains(std::string_view path) const {
+    return get_file_header(path).has_value();
+  }
+  // the content of the file at path, no copy is made. the view is valid as
+  // long as the reader is alive and not loaded again. throws if the archive
+  // has no such file
+  [[nodiscard]] std::span<const std::byte> open(std::string_view path) const;
+};
+
+// extracts every file of the archive of reader below outpath on up to jobs
+// threads. the directories are created once up front, the workers copy with
+// positional reads of the archive, so they share it without seeking
+void extract_edat(const EDatReader &reader, const fs::path &outpath,
+                  unsigned jobs);
@@ -0,0 +1,430 @@
+#include "edat_writer.hpp"
+
+#include "mapped_file.hpp"
+#include "md5.hpp"
+#include "parallel_for.hpp"
+#include "positional_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+// these are all allowed characters in paths in their correct order, all
+// paths get sorted by this order. in the archive the paths use \ and not /,
+// internally only / is used so filepaths "just work"
+static constexpr std::string_view characters =
+    "/\\-.0123456789_ abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static constexpr uint8_t invalid_character_rank = 0xFF;
+// position of every byte in characters, invalid_character_rank if not allowed
+static constexpr std::array<uint8_t, 256> character_ranks = [] {
+  std::array<uint8_t, 256> ranks{};
+  ranks.fill(invalid_character_rank);
+  for (size_t i = 0; i < characters.size(); i++) {
+    ranks[uint8_t(characters[i])] = i;
+  }
+  return ranks;
+}();
+
+std::string edat_dictionary_sort_key(std::string_view path) {
+  std::string key(path.size(), '\0');
+  for (size_t i = 0; i < path.size(); i++) {
+    uint8_t rank = character_ranks[uint8_t(path[i])];
+    if (rank == invalid_character_rank) {
+      throw std::runtime_error(std::format(
+          "EDatWriter: character '{}' of {} is not allowed in an archive",
+          path[i], path));
+    }
+    key[i] = char(rank);
+  }
+  return key;
+}
+
+void sort_edat_entries(std::vector<EDatEntry> &entries) {
+  // sort by precomputed keys instead of looking up the ranks per comparison
+  std::vector<std::pair<std::string, size_t>> keys;
+  keys.reserve(entries.size());
+  for (size_t idx = 0; idx < entries.size(); idx++) {
+    keys.emplace_back(edat_dictionary_sort_key(entries[idx].path), idx);
+  }
+  std::ranges::sort(keys);
+  std::vector<EDatEntry> sorted;
+  sorted.reserve(entries.size());
+  for (const auto &[_, idx] : keys) {
+    sorted.push_back(std::move(entries[idx]));
+  }
+  entries = std::move(sorted);
+}
+
+namespace {
+// radix trie of the dictionary, every edge is labelled with the part of the
+// path stored in one dictionary entry. paths have to be inserted in
+// dictionary order, so new nodes are always appended to the children and
+// these stay sorted
+struct Trie {
+  std::string part;
+  std::vector<Trie> children;
+  // header of the file, only set for leaves
+  const EDatFileHeader *header = nullptr;
+
+  void insert(std::string_view path, const EDatFileHeader *file_header) {
+    Trie *current = this;
+    std::string_view full_path = path;
+    while (true) {
+      if (path.empty() || current->header) {
+        throw std::runtime_error(std::format(
+            "EDatWriter: {} is not the only file with its prefix", full_path));
+      }
+      if (current->children.empty() ||
+          current->children.back().part[0] != path[0]) {
+        if (!current->children.empty() &&
+            character_ranks[uint8_t(current->children.back().part[0])] >
+                character_ranks[uint8_t(path[0])]) {
+          throw std::runtime_error(std::format(
+              "EDatWriter: {} is not in dictionary order", full_path));
+        }
+        current->children.push_back({std::string(path), {}, file_header});
+        return;
+      }
+      Trie &last = current->children.back();
+      auto [part_end, path_end] = std::ranges::mismatch(last.part, path);
+      size_t common = part_end - last.part.begin();
+      if (part_end != last.part.end()) {
+        // split the edge at the first differing character
+        Trie tail = {last.part.substr(common), std::move(last.children),
+                     last.header};
+        last.part.resize(common);
+        last.children.clear();
+        last.header = nullptr;
+        last.children.push_back(std::move(tail));
+      }
+      path.remove_prefix(common);
+      current = &last;
+    }
+  }
+};
+} // namespace
+
+static size_t align_to(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+static void put_u32(std::string &out, uint32_t value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// null terminated and padded to an even size, with \ instead of /
+static size_t part_size(std::string_view part) {
+  return align_to(part.size() + 1, 2);
+}
+
+static void put_part(std::string &out, std::string_view part) {
+  size_t start = out.size();
+  out.append(part);
+  std::replace(out.begin() + start, out.end(), '/', '\\');
+  out.resize(start + part_size(part), '\0');
+}
+
+static void build_trie(std::string &out, const Trie &trie) {
+  for (size_t i = 0; i < trie.children.size(); i++) {
+    const Trie &child = trie.children[i];
+    bool is_last = i == trie.children.size() - 1;
+    size_t entry_start = out.size();
+    if (child.children.empty()) {
+      // no path size, the file header follows. the last entry of a level has
+      // no entry size
+      put_u32(out, 0);
+      put_u32(out, is_last ? 0
+                           : 8 + sizeof(EDatFileHeader) + part_size(child.part));
+      out.append(reinterpret_cast<const char *>(child.header),
+                 sizeof(EDatFileHeader));
+      put_part(out, child.part);
+    } else {
+      put_u32(out, 8 + part_size(child.part));
+      put_u32(out, 0);
+      put_part(out, child.part);
+      build_trie(out, child);
+      if (!is_last) {
+        uint32_t entry_size = out.size() - entry_start;
+        std::memcpy(out.data() + entry_start + 4, &entry_size,
+                    sizeof(entry_size));
+      }
+    }
+  }
+}
+
+std::string build_edat_dictionary(std::span<const EDatEntry> entries) {
+  std::string out;
+  put_u32(out, entries.empty() ? 0x01 : 0x0A);
+  out.append(6, '\0');
+
+  Trie trie;
+  for (const auto &entry : entries) {
+    trie.insert(entry.path, &entry.header);
+  }
+  build_trie(out, trie);
+  return out;
+}
+
+// everything but the checksum of the header for a dictionary of
+// dictionary_size bytes followed by files_size bytes of files
+static EDatHeader make_header(size_t dictionary_size, size_t files_size,
+                              uint32_t sector_size) {
+  EDatHeader header = {};
+  std::memcpy(header.magic, "edat", 4);
+  header.unk0 = 2;
+  header.sectorSize = sector_size;
+  header.offset_dictionary = sizeof(EDatHeader);
+  header.size_dictionary = dictionary_size;
+  header.offset_files =
+      align_to(header.offset_dictionary + dictionary_size, sector_size);
+  header.size_files = files_size;
+  return header;
+}
+
+static void set_checksum(uint8_t (&checksum)[16],
+                         std::span<const std::byte> data) {
+  auto digest = MD5::digest(data);
+  std::memcpy(checksum, digest.data(), digest.size());
+}
+
+// sets size and sector aligned offset of every entry from its source,
+// returns the size of the file section
+static size_t update_layout(std::span<EDatEntry> entries,
+                            uint32_t sector_size) {
+  size_t offset = 0;
+  for (auto &entry : entries) {
+    entry.header.offset = offset;
+    entry.header.size = fs::file_size(entry.source);
+    offset += align_to(entry.header.size, sector_size);
+  }
+  return offset;
+}
+
+// size of the file section as given by the file headers
+static size_t get_files_size(std::span<const EDatEntry> entries,
+                             uint32_t sector_size) {
+  size_t size = 0;
+  for (const auto &entry : entries) {
+    size = std::max(size, entry.header.offset +
+                              align_to(entry.header.size, sector_size));
+  }
+  return size;
+}
+
+// maps the source of entry, checking that it did not change since the layout
+// was computed
+static MappedFile map_source(const EDatEntry &entry) {
+  MappedFile file(entry.source);
+  if (file.size() != entry.header.size) {
+    throw std::runtime_error(std::format(
+        "EDatWriter: size of {} does not match its header", entry.source.string()));
+  }
+  return file;
+}
+
+EDatHeader build_edat(const fs::path &output, std::vector<EDatEntry> &entries,
+                      uint32_t sector_size, unsigned jobs,
+                      bool compute_layout) {
+  sort_edat_entries(entries);
+  size_t files_size = compute_layout ? update_layout(entries, sector_size)
+                                     : get_files_size(entries, sector_size);
+  // the dictionary size does not depend on the checksums, so the offsets of
+  // all files are known before any of them is read
+  auto header = make_header(build_edat_dictionary(entries).size(), files_size,
+                            sector_size);
+
+  PositionalFile file(output, PositionalFile::Mode::write);
+  parallel_for(entries.size(), jobs, [&](size_t idx) {
+    // only the entries get modified while the workers run
+    auto &entry = entries[idx];
+    auto input = map_source(entry);
+    if (compute_layout) {
+      set_checksum(entry.header.checksum, input.data());
+    }
+    file.write_at(header.offset_files + entry.header.offset, input.data());
+  });
+  // zero padding after the last file
+  if (files_size != 0) {
+    file.resize(header.offset_files + files_size);
+  }
+
+  auto dictionary = build_edat_dictionary(entries);
+  set_checksum(header.checksum, std::as_bytes(std::span(dictionary)));
+  file.write_at(0, std::as_bytes(std::span(&header, 1)));
+  file.write_at(header.offset_dictionary, std::as_bytes(std::span(dictionary)));
+  return header;
+}
+
+EDatHeader write_edat(std::ostream &stream, std::vector<EDatEntry> &entries,
+                      uint32_t sector_size, bool compute_layout) {
+  sort_edat_entries(entries);
+  size_t files_size = 0;
+  if (compute_layout) {
+    files_size = update_layout(entries, sector_size);
+    for (auto &entry : entries) {
+      set_checksum(entry.header.checksum, map_source(entry).data());
+    }
+  } else {
+    files_size = get_files_size(entries, sector_size);
+  }
+
+  auto dictionary = build_edat_dictionary(entries);
+  auto header = make_header(dictionary.size(), files_size, sector_size);
+  set_checksum(header.checksum, std::as_bytes(std::span(dictionary)));
+  stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  stream.write(dictionary.data(), std::streamsize(dictionary.size()));
+
+  // gaps are written as zeros instead of seeking past the end, which string
+  // streams do not allow
+  size_t position = header.offset_dictionary + dictionary.size();
+  std::vector<char> zeros(sector_size, '\0');
+  auto move_to = [&](size_t offset) {
+    if (offset < position) {
+      stream.seekp(std::streamoff(offset));
+    }
+    while (position < offset) {
+      size_t count = std::min(offset - position, zeros.size());
+      stream.write(zeros.data(), std::streamsize(count));
+      position += count;
+    }
+    position = offset;
+  };
+
+  // in the order of the offsets, kept headers do not have to be sorted
+  std::vector<const EDatEntry *> by_offset;
+  by_offset.reserve(entries.size());
+  for (const auto &entry : entries) {
+    by_offset.push_back(&entry);
+  }
+  std::ranges::stable_sort(by_offset, {}, [](const EDatEntry *entry) {
+    return uint32_t(entry->header.offset);
+  });
+  for (const auto *entry : by_offset) {
+    auto input = map_source(*entry);
+    move_to(header.offset_files + entry->header.offset);
+    stream.write(reinterpret_cast<const char *>(input.data().data()),
+                 std::streamsize(input.size()));
+    position += input.size();
+  }
+  if (files_size != 0) {
+    move_to(header.offset_files + files_size);
+  }
+  if (!stream) {
+    throw std::runtime_error("EDatWriter: failed to write the archive");
+  }
+  return header;
+}
+
+EDatHeader update_edat(const fs::path &archive,
+                       const std::map<std::string, fs::path> &changes,
+                       unsigned jobs) {
+  std::vector<EDatEntry> entries;
+  uint32_t sector_size = 0;
+  size_t old_offset_files = 0;
+  {
+    EDatReader reader(archive);
+    sector_size = reader.get_header().sectorSize;
+    old_offset_files = reader.get_header().offset_files;
+    entries.reserve(reader.get_files().size() + changes.size());
+    for (const auto &[path, header] : reader.get_files()) {
+      entries.push_back({path, {}, header});
+    }
+  }
+  if (sector_size == 0) {
+    throw std::runtime_error("EDatWriter: archive has no sector size");
+  }
+  size_t old_files_size = get_files_size(entries, sector_size);
+
+  // place the changed files, they are the entries with a source
+  std::map<std::string, size_t> index;
+  for (size_t idx = 0; idx < entries.size(); idx++) {
+    index.emplace(entries[idx].path, idx);
+  }
+  size_t files_size = old_files_size;
+  // sectors of relocated or shrunk files are zeroed, offset and size
+  std::vector<std::pair<size_t, size_t>> freed;
+  for (const auto &[archive_path, source] : changes) {
+    std::string path = archive_path;
+    std::ranges::replace(path, '\\', '/');
+    // throws on characters an archive can not store
+    edat_dictionary_sort_key(path);
+    size_t size = fs::file_size(source);
+    auto [it, added] = index.try_emplace(path, entries.size());
+    if (added) {
+      entries.push_back({path, {}, {}});
+    }
+    auto &entry = entries[it->second];
+    entry.source = source;
+    size_t slot = added ? 0 : align_to(entry.header.size, sector_size);
+    if (!added && size != 0 && align_to(size, sector_size) <= slot) {
+      freed.emplace_back(entry.header.offset + size, slot - size);
+    } else {
+      if (slot != 0) {
+        freed.emplace_back(size_t(entry.header.offset), slot);
+      }
+      entry.header.offset = files_size;
+      files_size += align_to(size, sector_size);
+    }
+    entry.header.size = size;
+  }
+
+  sort_edat_entries(entries);
+  auto header = make_header(build_edat_dictionary(entries).size(), files_size,
+                            sector_size);
+  spdlog::debug("update_edat {} changed files", changes.size());
+
+  // the archive is never written in place, a failed or interrupted update
+  // leaves the old one untouched
+  fs::path target = archive;
+  target += ".tmp";
+  try {
+    PositionalFile file(target, PositionalFile::Mode::write);
+    if (old_files_size != 0) {
+      MappedFile source_data(archive);
+      PositionalFile source(archive, PositionalFile::Mode::read);
+      file.copy_from(source, source_data.data(), old_offset_files,
+                     old_files_size, header.offset_files);
+    }
+
+    std::vector<std::byte> zeros;
+    for (const auto &[offset, size] : freed) {
+      zeros.resize(std::max(zeros.size(), size));
+      file.write_at(header.offset_files + offset,
+                    std::span(zeros).first(size));
+    }
+
+    std::vector<EDatEntry *> changed;
+    for (auto &entry : entries) {
+      if (!entry.source.empty()) {
+        changed.push_back(&entry);
+      }
+    }
+    parallel_for(changed.size(), jobs, [&](size_t idx) {
+      auto &entry = *changed[idx];
+      auto input = map_source(entry);
+      set_checksum(entry.header.checksum, input.data());
+      file.write_at(header.offset_files + entry.header.offset, input.data());
+    });
+    if (files_size != 0) {
+      file.resize(header.offset_files + files_size);
+    }
+
+    auto dictionary = build_edat_dictionary(entries);
+    set_checksum(header.checksum, std::as_bytes(std::span(dictionary)));
+    file.write_at(0, std::as_bytes(std::span(&header, 1)));
+    file.write_at(header.offset_dictionary,
+                  std::as_bytes(std::span(dictionary)));
+  } catch (...) {
+    std::error_code ec;
+    if (fs::is_regular_file(target, ec)) {
+      fs::remove(target, ec);
+    }
+    throw;
+  }
+  fs::rename(target, archive);
+  return header;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "edat_reader.hpp"
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+// a file to put into an archive
+struct EDatEntry {
+  // path in the archive, uses / like EDat
+  std::string path;
+  // the file on disk with the content
+  fs::path source;
+  EDatFileHeader header{};
+};
+
+// the path with every character replaced by its position in the dictionary
+// order, comparing the keys bytewise gives the order of the files in an
+// archive. throws on characters an archive can not store
+std::string edat_dictionary_sort_key(std::string_view path);
+
+// sorts entries into dictionary order
+void sort_edat_entries(std::vector<EDatEntry> &entries);
+
+// the dictionary as stored at offset_dictionary for entries in dictionary
+// order. its size only depends on the paths, not on the file headers. throws
+// on duplicate paths and on paths that are a prefix of another one, the
+// dictionary has no way to store them
+std::string build_edat_dictionary(std::span<const EDatEntry> entries);
+
+// writes an archive of entries to output and returns its header. entries
+// get sorted into dictionary order. with compute_layout the offsets, sizes
+// and checksums are computed from the sources, otherwise the headers are kept
+// and the sources have to have the sizes given in them. every source is read
+// once on up to jobs threads, which checksum it and write it to its sector
+// aligned offset, the dictionary gets written last
+EDatHeader build_edat(const fs::path &output, std::vector<EDatEntry> &entries,
+                      uint32_t sector_size, unsigned jobs,
+                      bool compute_layout = true);
+
+// the same archive as build_edat, written serially to stream
+EDatHeader write_edat(std::ostream &stream, std::vector<EDatEntry> &entries,
+                      uint32_t sector_size, bool compute_layout = true);
+
+// replaces or adds files in the archive at archive without touching the
+// others and returns its new header. changes maps archive paths to the files
+// on disk. a changed file keeps its sectors if it still fits, otherwise it and
+// every added file get appended after the last file. untouched files keep
+// their offsets and checksums and are not read, the file section gets copied
+// with copy_file_range where possible. the new archive is written next to the
+// old one as archive.tmp and renamed over it at the end, so a failed update
+// leaves the old archive as it was. relocated files leave dead sectors behind
+// until the archive is rebuilt
+EDatHeader update_edat(const fs::path &archive,
+                       const std::map<std::string, fs::path> &changes,
+                       unsigned jobs);
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// read-only memory mapping of a whole file, the mapping lives as long as the
+// object
+class MappedFile {
+private:
+  const std::byte *m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  HANDLE m_mapping = nullptr;
+#endif
+
+  void unmap() {
+#ifdef _WIN32
+    if (m_data) {
+      UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+      CloseHandle(m_mapping);
+    }
+    m_mapping = nullptr;
+#else
+    if (m_data) {
+      munmap(const_cast<std::byte *>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+public:
+  MappedFile() = default;
+  explicit MappedFile(const fs::path &path) { open(path); }
+  ~MappedFile() { unmap(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+#ifdef _WIN32
+      std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+    return *this;
+  }
+
+  void open(const fs::path &path) {
+    unmap();
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+                              FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Failed to open file " + path.string());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+      CloseHandle(file);
+      throw std::runtime_error("Failed to get size of file " + path.string());
+    }
+    m_size = size.QuadPart;
+    if (m_size == 0) {
+      CloseHandle(file);
+      return;
+    }
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!m_mapping) {
+      m_size = 0;
+      throw std::runtime_error("Failed to map file " + path.string());
+    }
+    m_data = static_cast<const std::byte *>(
+        MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+      unmap();
+      throw std::runtime_error("Failed to map file " + path.string());
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Failed to open file " + path.string());
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Failed to get size of file " + path.string());
+    }
+    m_size = st.st_size;
+    if (m_size == 0) {
+      ::close(fd);
+      return;
+    }
+    void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+      m_size = 0;
+      throw std::runtime_error("Failed to map file " + path.string());
+    }
+    m_data = static_cast<const std::byte *>(ptr);
+#endif
+  }
+
+  [[nodiscard]] std::span<const std::byte> data() const {
+    return {m_data, m_size};
+  }
+  [[nodiscard]] size_t size() const { return m_size; }
+};
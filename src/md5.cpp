@@ -0,0 +1,106 @@
+#include "md5.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// RFC 1321, per round constants and shift amounts
+static constexpr std::array<uint32_t, 64> round_constants = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+static constexpr std::array<int, 64> shifts = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+static uint32_t load_le32(const std::byte *data) {
+  return uint32_t(data[0]) | uint32_t(data[1]) << 8 |
+         uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+}
+
+void MD5::transform(const std::byte *block) {
+  std::array<uint32_t, 16> words;
+  for (size_t i = 0; i < words.size(); i++) {
+    words[i] = load_le32(block + i * 4);
+  }
+
+  auto [a, b, c, d] = m_state;
+  for (unsigned i = 0; i < 64; i++) {
+    uint32_t f;
+    unsigned word;
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      word = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      word = (5 * i + 1) % 16;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      word = (3 * i + 5) % 16;
+    } else {
+      f = c ^ (b | ~d);
+      word = (7 * i) % 16;
+    }
+    f += a + round_constants[i] + words[word];
+    a = d;
+    d = c;
+    c = b;
+    b += std::rotl(f, shifts[i]);
+  }
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+}
+
+void MD5::update(std::span<const std::byte> data) {
+  size_t used = m_size % 64;
+  m_size += data.size();
+  if (used != 0) {
+    size_t count = std::min(data.size(), 64 - used);
+    std::memcpy(m_block.data() + used, data.data(), count);
+    data = data.subspan(count);
+    if (used + count < 64) {
+      return;
+    }
+    transform(m_block.data());
+  }
+  while (data.size() >= 64) {
+    transform(data.data());
+    data = data.subspan(64);
+  }
+  if (!data.empty()) {
+    std::memcpy(m_block.data(), data.data(), data.size());
+  }
+}
+
+std::array<uint8_t, 16> MD5::finalize() {
+  uint64_t bits = m_size * 8;
+  // a one bit, zeros up to 8 bytes before the end of a block, then the
+  // length in bits
+  std::array<std::byte, 72> padding{};
+  padding[0] = std::byte{0x80};
+  size_t used = m_size % 64;
+  size_t count = used < 56 ? 56 - used : 120 - used;
+  for (size_t i = 0; i < 8; i++) {
+    padding[count + i] = std::byte(bits >> (i * 8));
+  }
+  update(std::span(padding).first(count + 8));
+
+  std::array<uint8_t, 16> ret;
+  for (size_t i = 0; i < ret.size(); i++) {
+    ret[i] = uint8_t(m_state[i / 4] >> (i % 4 * 8));
+  }
+  return ret;
+}
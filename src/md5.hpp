@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// md5 digest as used for the checksums of edat archives
+class MD5 {
+private:
+  std::array<uint32_t, 4> m_state = {0x67452301, 0xefcdab89, 0x98badcfe,
+                                     0x10325476};
+  std::array<std::byte, 64> m_block{};
+  uint64_t m_size = 0;
+
+  void transform(const std::byte *block);
+
+public:
+  void update(std::span<const std::byte> data);
+  // the digest of everything passed to update, the object can not be updated
+  // afterwards
+  [[nodiscard]] std::array<uint8_t, 16> finalize();
+
+  [[nodiscard]] static std::array<uint8_t, 16>
+  digest(std::span<const std::byte> data) {
+    MD5 md5;
+    md5.update(data);
+    return md5.finalize();
+  }
+};
@@ -1,73 +1,151 @@
 #include "ndf.hpp"
+#include "ndf_xml_writer.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+NDF &NDF::operator=(NDF &&other) noexcept {
+  if (this != &other) {
+    std::destroy_at(this);
+    std::construct_at(this, std::move(other));
+  }
+  return *this;
+}
+
+NDF::~NDF() {
+  // the properties live in the arenas, whatever order the members are in
+  object_map.clear();
+  reference_index.clear();
+}
 
 void NDF::save_as_ndf_xml(fs::path path) {
-  pugi::xml_document doc;
-  auto root = doc.append_child("NDF");
+  fs::create_directories(path.parent_path());
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("Failed to open file " + path.string());
+  }
+  save_as_ndf_xml_stream(file);
+}
+
+void NDF::save_as_ndf_xml_stream(std::ostream &stream) {
+  load_lazy_objects();
+  NDFXmlWriter writer(stream);
+  writer.start_element("NDF");
 
   for (const auto &[name, obj] : object_map) {
-    auto object_node = root.append_child(obj.name.c_str());
-    object_node.append_attribute("class") = obj.class_name.c_str();
-    object_node.append_attribute("export_path") = obj.export_path.c_str();
-    object_node.append_attribute("is_top_object") = obj.is_top_object;
+    writer.start_element(obj.name);
+    writer.attribute("class", obj.class_name);
+    writer.attribute("export_path", obj.export_path);
+    writer.attribute("is_top_object", obj.is_top_object);
 
     for (const auto &prop : obj.properties) {
-      prop->to_ndf_xml(object_node);
+      prop->to_ndf_xml(writer);
     }
+    writer.end_element();
   }
 
-  fs::create_directories(path.parent_path());
-  doc.save_file(path.c_str());
+  writer.finish();
 }
 
-void NDF::load_from_ndf_xml(fs::path path) {
+static NDFObject object_from_ndf_xml(const pugi::xml_node &obj) {
+  NDFObject object;
+  object.name = obj.name();
+  object.class_name = obj.attribute("class").as_string();
+  object.export_path = obj.attribute("export_path").as_string();
+  object.is_top_object = obj.attribute("is_top_object").as_bool();
+
+  for (const auto &prop : obj.children()) {
+    uint32_t ndf_type = prop.attribute("typeId").as_uint();
+    NDFPropertyPtr property =
+        NDFProperty::get_property_from_ndf_xml(ndf_type, prop);
+    property->from_ndf_xml(prop);
+    object.add_property(std::move(property));
+  }
+  return object;
+}
+
+void NDF::load_from_ndf_xml(fs::path path, unsigned jobs) {
   pugi::xml_document doc;
   pugi::xml_parse_result result = doc.load_file(path.c_str());
   spdlog::debug("Load result: {}", result.description());
   assert(result.status == pugi::status_ok);
 
+  std::vector<pugi::xml_node> object_nodes;
   for (const auto &obj : doc.child("NDF").children()) {
-    NDFObject object;
-    object.name = obj.name();
-    object.class_name = obj.attribute("class").as_string();
-    object.export_path = obj.attribute("export_path").as_string();
-    object.is_top_object = obj.attribute("is_top_object").as_bool();
-
-    for (const auto &prop : obj.children()) {
-      uint32_t ndf_type = prop.attribute("typeId").as_uint();
-      std::unique_ptr<NDFProperty> property =
-          NDFProperty::get_property_from_ndf_xml(ndf_type, prop);
-      property->from_ndf_xml(prop);
-      object.add_property(std::move(property));
+    object_nodes.push_back(obj);
+  }
+
+  jobs = std::clamp<unsigned>(jobs, 1,
+                              std::max<size_t>(object_nodes.size(), 1));
+  if (jobs == 1) {
+    for (const auto &obj : object_nodes) {
+      add_object(object_from_ndf_xml(obj));
+    }
+    fill_gen_object();
+    return;
+  }
+
+  // every thread converts a contiguous range of the objects into its own
+  // vector, the ranges get merged in order afterwards. the document is only
+  // read, pugixml allows that from several threads
+  std::vector<std::vector<NDFObject>> partitions(jobs);
+  std::vector<std::exception_ptr> errors(jobs);
+  size_t chunk = (object_nodes.size() + jobs - 1) / jobs;
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < jobs; i++) {
+    threads.emplace_back([&, i]() {
+      size_t begin = std::min(object_nodes.size(), i * chunk);
+      size_t end = std::min(object_nodes.size(), begin + chunk);
+      try {
+        partitions[i].reserve(end - begin);
+        for (size_t idx = begin; idx < end; idx++) {
+          partitions[i].push_back(object_from_ndf_xml(object_nodes[idx]));
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
     }
+  }
 
-    add_object(std::move(object));
+  object_map.reserve(object_map.size() + object_nodes.size());
+  for (auto &partition : partitions) {
+    for (auto &object : partition) {
+      add_object(std::move(object));
+    }
   }
   fill_gen_object();
 }
 
-void NDF::load_imprs(std::istream &stream,
+void NDF::load_imprs(BinaryCursor &cursor,
                      std::vector<std::string> current_import_path) {
-  uint32_t tran_index;
-  stream.read(reinterpret_cast<char *>(&tran_index), sizeof(uint32_t));
-  uint32_t index;
-  stream.read(reinterpret_cast<char *>(&index), sizeof(uint32_t));
-  uint32_t count;
-  stream.read(reinterpret_cast<char *>(&count), sizeof(uint32_t));
-
-  uint32_t begin_offset = (uint32_t)stream.tellg();
+  auto tran_index = cursor.read<uint32_t>();
+  auto index = cursor.read<uint32_t>();
+  auto count = cursor.read<uint32_t>();
+
+  size_t begin_offset = cursor.tell();
   if (count > 0) {
-    std::vector<uint32_t> offsets;
-    offsets.resize(count);
-    stream.read(reinterpret_cast<char *>(offsets.data()),
-                sizeof(uint32_t) * count);
+    auto offsets = cursor.read_bytes(sizeof(uint32_t) * count);
 
-    for (uint32_t offset : offsets) {
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t offset;
+      std::memcpy(&offset, offsets.data() + i * sizeof(uint32_t),
+                  sizeof(uint32_t));
       spdlog::debug("assertion @0x{:02X} is 0x{:02X} should be 0x{:02X}",
-                    begin_offset, ((uint32_t)stream.tellg() - begin_offset),
-                    offset);
-      assert(offset == ((uint32_t)stream.tellg() - begin_offset));
-      current_import_path.push_back(tran_table[tran_index]);
-      load_imprs(stream, current_import_path);
+                    begin_offset, cursor.tell() - begin_offset, offset);
+      assert(offset == cursor.tell() - begin_offset);
+      current_import_path.push_back(tran_table.at(tran_index));
+      load_imprs(cursor, current_import_path);
       current_import_path.pop_back();
     }
   }
@@ -78,30 +156,27 @@ void NDF::load_imprs(std::istream &stream,
 
   auto foo = current_import_path | std::views::join_with('/');
   std::string tmp(foo.begin(), foo.end());
-  import_name_table[index] = tmp + std::string("/") + tran_table[tran_index];
+  import_name_table[index] = tmp + std::string("/") + tran_table.at(tran_index);
   spdlog::debug("Import: {}", import_name_table[index]);
 }
 
-void NDF::load_exprs(std::istream &stream,
+void NDF::load_exprs(BinaryCursor &cursor,
                      std::vector<std::string> current_export_path) {
-  uint32_t tran_index;
-  stream.read(reinterpret_cast<char *>(&tran_index), sizeof(uint32_t));
-  uint32_t index;
-  stream.read(reinterpret_cast<char *>(&index), sizeof(uint32_t));
-  uint32_t count;
-  stream.read(reinterpret_cast<char *>(&count), sizeof(uint32_t));
-
-  uint32_t begin_offset = (uint32_t)stream.tellg();
+  auto tran_index = cursor.read<uint32_t>();
+  auto index = cursor.read<uint32_t>();
+  auto count = cursor.read<uint32_t>();
+
+  size_t begin_offset = cursor.tell();
   if (count > 0) {
-    std::vector<uint32_t> offsets;
-    offsets.resize(count);
-    stream.read(reinterpret_cast<char *>(offsets.data()),
-                sizeof(uint32_t) * count);
-
-    for (uint32_t offset : offsets) {
-      assert(offset == ((uint32_t)stream.tellg() - begin_offset));
-      current_export_path.push_back(tran_table[tran_index]);
-      load_exprs(stream, current_export_path);
+    auto offsets = cursor.read_bytes(sizeof(uint32_t) * count);
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t offset;
+      std::memcpy(&offset, offsets.data() + i * sizeof(uint32_t),
+                  sizeof(uint32_t));
+      assert(offset == cursor.tell() - begin_offset);
+      current_export_path.push_back(tran_table.at(tran_index));
+      load_exprs(cursor, current_export_path);
       current_export_path.pop_back();
     }
   }
@@ -110,10 +185,88 @@ void NDF::load_exprs(std::istream &stream,
     return;
   }
 
-  auto &obj = get_object(gen_object_items[index]);
+  // not get_object, that would decode objects of a lazy load
+  auto &obj = object_map.at(gen_object_table.at(index));
 
   auto test = current_export_path | std::views::join_with('/');
   std::string tmp(test.begin(), test.end());
-  obj.export_path = tmp + std::string("/") + tran_table[tran_index];
+  obj.export_path = tmp + std::string("/") + tran_table.at(tran_index);
   spdlog::debug("Export: {}", obj.export_path);
 }
+
+void NDF::build_reference_index() {
+  // references of pending objects are unknown
+  load_lazy_objects();
+  if (reference_index_valid) {
+    return;
+  }
+  reference_index.clear();
+  for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+    index_object_references(it.value());
+  }
+  reference_index_valid = true;
+}
+
+void NDF::index_object_references(NDFObject &object) {
+  for (auto *property : object.get_object_reference_properties()) {
+    reference_index[property->object_name].push_back({object.name, property});
+  }
+}
+
+void NDF::unindex_object_references(NDFObject &object) {
+  for (auto *property : object.get_object_reference_properties()) {
+    auto it = reference_index.find(property->object_name);
+    if (it == reference_index.end()) {
+      continue;
+    }
+    std::erase_if(it->second, [&](const NDFReferenceLocation &location) {
+      return location.property == property;
+    });
+    if (it->second.empty()) {
+      reference_index.erase(it);
+    }
+  }
+}
+
+void NDF::update_reference_owner(NDFObject &object) {
+  for (auto *property : object.get_object_reference_properties()) {
+    auto it = reference_index.find(property->object_name);
+    if (it == reference_index.end()) {
+      continue;
+    }
+    for (auto &location : it->second) {
+      if (location.property == property) {
+        location.object_name = object.name;
+      }
+    }
+  }
+}
+
+void NDF::rename_references(const std::string &previous_name,
+                            const std::string &name) {
+  auto node = reference_index.extract(previous_name);
+  if (node.empty()) {
+    return;
+  }
+  auto &target = reference_index[name];
+  for (auto &location : node.mapped()) {
+    location.property->object_name = name;
+    target.push_back(std::move(location));
+  }
+}
+
+std::vector<std::string>
+NDF::get_referencing_objects(const std::string &name) {
+  build_reference_index();
+  std::vector<std::string> ret;
+  auto it = reference_index.find(name);
+  if (it == reference_index.end()) {
+    return ret;
+  }
+  for (const auto &location : it->second) {
+    if (std::ranges::find(ret, location.object_name) == ret.end()) {
+      ret.push_back(location.object_name);
+    }
+  }
+  return ret;
+}
@@ -4,6 +4,8 @@
 #include <map>
 #include <ranges>
 #include <set>
+#include <span>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -13,6 +15,10 @@
 
 #include "pugixml.hpp"
 
+#include "binary_cursor.hpp"
+#include "binary_writer.hpp"
+#include "mapped_file.hpp"
+#include "ndf_index_table.hpp"
 #include "ndf_properties.hpp"
 
 #include <filesystem>
@@ -21,24 +27,28 @@ namespace fs = std::filesystem;
 using namespace std::literals;
 
 struct NDF;
-
-struct NDFClass {
-  std::map<std::string, uint32_t> properties;
-};
+// sections of a serialized ndfbin, defined in ndfbin.cpp
+struct NDFBinImage;
 
 struct NDFObject {
   std::string name;
   std::string class_name;
-  bool is_top_object;
+  bool is_top_object = false;
   std::string export_path;
-  std::vector<std::unique_ptr<NDFProperty>> properties;
+  std::pmr::vector<NDFPropertyPtr> properties;
   std::map<std::string, uint32_t> property_map;
-  std::unique_ptr<NDFProperty> &get_property(const std::string &name) {
+
+  NDFObject() = default;
+  // properties get allocated in arena, see NDF::property_arena
+  explicit NDFObject(std::pmr::memory_resource *arena)
+      : properties(arena ? arena : std::pmr::get_default_resource()) {}
+
+  NDFPropertyPtr &get_property(const std::string &name) {
     return properties.at(property_map.at(name));
   }
 
 public:
-  NDFObject get_copy() {
+  NDFObject get_copy() const {
     NDFObject ret;
     ret.name = name;
     ret.class_name = class_name;
@@ -50,7 +60,7 @@ public:
     }
     return ret;
   }
-  void add_property(std::unique_ptr<NDFProperty> property) {
+  void add_property(NDFPropertyPtr property) {
     property_map.insert({property->property_name, properties.size()});
     properties.push_back(std::move(property));
   }
@@ -88,6 +98,19 @@ public:
     }
     return ret;
   }
+  std::vector<NDFPropertyObjectReference *> get_object_reference_properties() {
+    std::vector<NDFPropertyObjectReference *> ret;
+    for (auto const &prop : properties) {
+      prop->get_object_reference_properties(ret);
+    }
+    return ret;
+  }
+};
+
+// an object reference property and the object it belongs to
+struct NDFReferenceLocation {
+  std::string object_name;
+  NDFPropertyObjectReference *property;
 };
 
 struct NDF {
@@ -96,64 +119,153 @@ public:
   std::map<unsigned int, std::string> import_name_table;
   std::vector<std::string> string_table;
   std::vector<std::string> class_table;
-  std::vector<std::pair<std::string, uint32_t>> property_table;
+  // PROP table, names are interned so properties share them with the table
+  std::vector<std::pair<NDFPropertyName, uint32_t>> property_table;
   std::vector<std::string> tran_table;
+
+private:
+  // properties loaded from ndfbin are allocated in this arena, so that freeing
+  // the NDF releases them at once. the destructor and the move assignment
+  // destroy the objects before the arena goes away. a monotonic arena never
+  // gets back the memory of removed or replaced properties, it is only freed
+  // with the NDF
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> property_arena =
+      std::make_unique<std::pmr::monotonic_buffer_resource>();
+  // one arena per thread of a parallel ndfbin load, a monotonic arena must
+  // not be used by several threads. same lifetime rules as property_arena
+  std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>>
+      worker_arenas;
+  // arena of the current thread while it decodes objects for a parallel load
+  static inline thread_local std::pmr::memory_resource *thread_property_arena =
+      nullptr;
+
+public:
+  // set to false to allocate every property on the heap instead
+  bool use_property_arena = true;
   tsl::ordered_map<std::string, NDFObject> object_map;
 
+  NDF() = default;
+  NDF(const NDF &) = delete;
+  NDF &operator=(const NDF &) = delete;
+  // the arenas move along with the objects that live in them
+  NDF(NDF &&) = default;
+  // destroys the objects of this NDF before taking over the arenas of other,
+  // a member wise assignment would free the arenas first
+  NDF &operator=(NDF &&other) noexcept;
+  ~NDF();
+
+  // objects allocated in the arena must not outlive the NDF, use
+  // NDFObject::get_copy to take them elsewhere
+  std::pmr::memory_resource *get_property_arena() {
+    if (!use_property_arena) {
+      return nullptr;
+    }
+    return thread_property_arena ? thread_property_arena
+                                 : property_arena.get();
+  }
+
   void save_as_ndf_xml(fs::path path);
-  void load_imprs(std::istream &stream,
+  // writes the xml object by object, never builds the whole document
+  void save_as_ndf_xml_stream(std::ostream &stream);
+  void load_imprs(BinaryCursor &cursor,
                   std::vector<std::string> current_import_path);
-  void load_exprs(std::istream &stream,
+  void load_exprs(BinaryCursor &cursor,
                   std::vector<std::string> current_export_path);
-  void load_from_ndf_xml(fs::path path);
+  // with jobs > 1 the objects are converted on that many threads, the order
+  // of object_map stays the one of the file
+  void load_from_ndf_xml(fs::path path, unsigned jobs = 1);
 
   void add_object(NDFObject object) {
-    object_map.insert({object.name, std::move(object)});
+    auto [it, inserted] = object_map.insert({object.name, std::move(object)});
+    if (inserted && reference_index_valid) {
+      index_object_references(it.value());
+    }
   }
 
-private:
-  std::vector<std::string> gen_object_items;
-  std::map<std::string, uint32_t> gen_object_table;
-
-  std::vector<std::string> gen_string_items;
-  std::map<std::string, uint32_t> gen_string_table;
+  // names of the objects that have a reference to name, the index gets built
+  // on the first call
+  std::vector<std::string> get_referencing_objects(const std::string &name);
+  // has to be called after changing object references or object_map without
+  // going through the functions of NDF, the index is rebuilt on the next use
+  void invalidate_reference_index() {
+    reference_index.clear();
+    reference_index_valid = false;
+  }
 
-  std::map<std::string, uint32_t> gen_clas_items;
-  std::vector<std::string> gen_clas_table;
+private:
+  // referenced object name -> every property referencing it. built lazily and
+  // kept up to date by add_object, change_object_name, bulk_rename_objects,
+  // copy_object and remove_object, so those only touch the properties that
+  // are affected. properties have a fixed address, they are owned through
+  // NDFPropertyPtr
+  std::unordered_map<std::string, std::vector<NDFReferenceLocation>>
+      reference_index;
+  bool reference_index_valid = false;
+
+  void build_reference_index();
+  void index_object_references(NDFObject &object);
+  void unindex_object_references(NDFObject &object);
+  // sets the owner of the indexed references of a renamed object, moving an
+  // object keeps its properties at their address
+  void update_reference_owner(NDFObject &object);
+  // points every reference to previous_name at name
+  void rename_references(const std::string &previous_name,
+                         const std::string &name);
+
+  // object, string, class and tran tables, indexed in order of first use
+  NDFIndexTable<std::string> gen_object_table;
+  NDFIndexTable<std::string> gen_string_table;
+  NDFIndexTable<std::string> gen_clas_table;
 
   std::vector<uint32_t> gen_topo_table;
 
-  std::map<std::string, uint32_t> gen_tran_items;
-  std::vector<std::string> gen_tran_table;
+  NDFIndexTable<std::string> gen_tran_table;
 
-  std::map<std::vector<uint32_t>, uint32_t> gen_import_table;
-  std::vector<std::vector<uint32_t>> gen_import_items;
-  std::map<std::vector<uint32_t>, uint32_t> gen_export_table;
-  std::vector<std::vector<uint32_t>> gen_export_items;
+  // import and export paths as tran indices. the import index is the index
+  // in the table, exports point to the object of gen_export_objects. both
+  // get written sorted by save_ndfbin_imprs
+  NDFIndexTable<std::vector<uint32_t>> gen_import_table;
+  NDFIndexTable<std::vector<uint32_t>> gen_export_table;
+  std::vector<uint32_t> gen_export_objects;
 
-  std::vector<NDFClass> gen_property_table;
-  std::vector<std::pair<std::string, uint32_t>> gen_property_items;
-  std::set<std::pair<std::string, uint32_t>> gen_property_set;
+  // PROP index by class index (high 32 bits) and property name id
+  std::unordered_map<uint64_t, uint32_t> gen_property_table;
+  std::vector<std::pair<NDFPropertyName, uint32_t>> gen_property_items;
 
-  void
-  save_ndfbin_imprs(const std::map<std::vector<uint32_t>, uint32_t> &gen_table,
-                    std::ostream &stream);
+  static uint64_t gen_property_key(uint32_t class_idx,
+                                   const NDFPropertyName &name) {
+    return (uint64_t(class_idx) << 32) | name.id();
+  }
+
+  // decodes the object at the cursor, it gets named after its index
+  NDFObject object_from_ndfbin(BinaryCursor &cursor, size_t object_idx);
+  // reads the properties up to the object terminator into object
+  void properties_from_ndfbin(BinaryCursor &cursor, NDFObject &object);
+  void load_ndfbin(std::span<const std::byte> data, unsigned jobs, bool lazy);
+  // decodes the objects of OBJE up to end_offset on jobs threads
+  void load_ndfbin_objects_parallel(BinaryCursor &cursor, size_t end_offset,
+                                    unsigned jobs);
+
+  // values holds the index written for every path of gen_table, the index
+  // in gen_table is used if it is empty
+  void save_ndfbin_imprs(const NDFIndexTable<std::vector<uint32_t>> &gen_table,
+                         std::span<const uint32_t> values,
+                         BinaryWriter &writer);
+  // serializes every section into its own buffer, offsets and sizes of the
+  // header and TOC follow from the buffer sizes
+  void build_ndfbin(NDFBinImage &image);
 
   // gets called by every save_as_ndfbin
   void fill_gen_object() {
-    for (const auto &[idx, it] : object_map | std::views::enumerate) {
-      gen_object_items.push_back(it.second.name);
-      gen_object_table.insert({it.second.name, gen_object_items.size() - 1});
+    gen_object_table.reserve(object_map.size());
+    for (const auto &[name, object] : object_map) {
+      gen_object_table.insert(object.name);
     }
   }
 
   // used for object reference
   uint32_t get_object_index(const std::string &name) {
-    auto obj_idx = gen_object_table.find(name);
-    if (obj_idx == gen_object_table.end()) {
-      return 4294967295;
-    }
-    return obj_idx->second;
+    return gen_object_table.find(name).value_or(4294967295);
   }
   // used for object references
   uint32_t get_class_of_object(const std::string &name) {
@@ -161,52 +273,71 @@ private:
     if (object_idx == 4294967295) {
       return 4294967295;
     }
-    return get_class(get_object(name).class_name);
+    return get_class(object_map.at(name).class_name);
   }
 
   uint32_t get_class(const std::string &str) {
-    auto obj_idx = gen_clas_items.find(str);
-    if (obj_idx == gen_clas_items.end()) {
-      return 4294967295;
-    }
-    return obj_idx->second;
+    return gen_clas_table.find(str).value_or(4294967295);
   }
   friend struct NDFPropertyObjectReference;
   friend struct NDFPropertyImportReference;
+  friend struct NDFValue;
+
+  // objects of a lazy load whose properties are not decoded yet, name ->
+  // offset of the first property in lazy_file
+  MappedFile lazy_file;
+  std::unordered_map<std::string, size_t> lazy_objects;
+  // rethrows decode errors, the object is left pending and without properties
+  void decode_lazy_object(NDFObject &object);
 
 public:
-  NDFObject &get_object(const std::string &str) { return object_map.at(str); }
+  // decodes the properties first if the object is pending from a lazy load
+  NDFObject &get_object(const std::string &str) {
+    auto &object = object_map.at(str);
+    if (!lazy_objects.empty()) {
+      decode_lazy_object(object);
+    }
+    return object;
+  }
 
+  // the object is moved, not copied, and keeps its position in object_map
   bool change_object_name(const std::string &previous_name,
                           const std::string &name, bool fix_references = true) {
     if (object_map.contains(name)) {
       spdlog::warn("change_object_name: object {} does already exist", name);
       return false;
     }
-    if (!object_map.contains(previous_name)) {
+    const auto it = object_map.find(previous_name);
+    if (it == object_map.end()) {
       spdlog::warn("change_object_name: object {} does not exist",
                    previous_name);
       return false;
     }
-    auto &object = get_object(previous_name);
-    const auto it = object_map.find(previous_name);
-    object_map[name] = object.get_copy();
-    object_map[name].name = name;
+    build_reference_index();
+    size_t position = it - object_map.begin();
+    NDFObject object = std::move(it.value());
+    object.name = name;
     object_map.erase(it);
+    auto inserted = object_map.emplace_at_position(
+        object_map.begin() + position, name, std::move(object));
+    update_reference_owner(inserted.first.value());
 
     if (fix_references) {
-      for (auto it = object_map.begin(); it != object_map.end(); ++it) {
-        it.value().fix_references(previous_name, name);
-      }
+      rename_references(previous_name, name);
     }
     return true;
   }
 
+  // renames all objects in one pass over object_map, the objects keep their
+  // positions. fails without changing anything if a name does not exist or
+  // a new name is taken by an object that keeps its name
   bool bulk_rename_objects(
       const std::unordered_map<std::string, std::string> &renames,
       bool fix_references = true) {
+    std::unordered_set<std::string_view> new_names;
     for (const auto &[previous_name, name] : renames) {
-      if (object_map.contains(name)) {
+      if (!new_names.insert(name).second ||
+          (object_map.contains(name) && !renames.contains(name))) {
         spdlog::warn("change_object_name: object {} does already exist", name);
         return false;
       }
@@ -215,16 +346,41 @@ public:
                      previous_name);
         return false;
       }
-      auto &object = get_object(previous_name);
-      const auto it = object_map.find(previous_name);
-      object_map[name] = object.get_copy();
-      object_map[name].name = name;
-      object_map.erase(it);
     }
+    build_reference_index();
+
+    tsl::ordered_map<std::string, NDFObject> renamed;
+    renamed.reserve(object_map.size());
+    for (auto it = object_map.begin(); it != object_map.end(); ++it) {
+      auto rename = renames.find(it->first);
+      if (rename == renames.end()) {
+        renamed.emplace(it->first, std::move(it.value()));
+        continue;
+      }
+      auto inserted = renamed.emplace(rename->second, std::move(it.value()));
+      inserted.first.value().name = rename->second;
+      update_reference_owner(inserted.first.value());
+    }
+    object_map = std::move(renamed);
 
     if (fix_references) {
-      for (auto it = object_map.begin(); it != object_map.end(); ++it) {
-        it.value().fix_references(renames);
+      // take all affected references out first, a reference renamed from a
+      // to b must not be renamed again by b -> c
+      std::vector<std::pair<const std::string *,
+                            std::vector<NDFReferenceLocation>>>
+          moved;
+      for (const auto &[previous_name, name] : renames) {
+        auto node = reference_index.extract(previous_name);
+        if (!node.empty()) {
+          moved.emplace_back(&name, std::move(node.mapped()));
+        }
+      }
+      for (auto &[name, locations] : moved) {
+        auto &target = reference_index[*name];
+        for (auto &location : locations) {
+          location.property->object_name = *name;
+          target.push_back(std::move(location));
+        }
       }
     }
 
@@ -243,85 +399,82 @@ public:
     auto &object = get_object(obj_name);
     auto new_object = object.get_copy();
     new_object.name = new_name;
-    object_map.insert({new_name, std::move(new_object)});
+    add_object(std::move(new_object));
     return true;
   }
 
+  // references to the removed object are kept, they still point at its name
   bool remove_object(const std::string &name) {
     if (!object_map.contains(name)) {
       spdlog::warn("remove_object: object {} does not exist", name);
       return false;
     }
+    if (reference_index_valid) {
+      unindex_object_references(get_object(name));
+    }
+    lazy_objects.erase(name);
     object_map.erase(name);
     return true;
   }
 
   uint32_t get_or_add_string(const std::string &str) {
-    auto it = gen_string_table.find(str);
-    if (it == gen_string_table.end()) {
-      gen_string_items.push_back(str);
-      gen_string_table.insert({str, gen_string_items.size() - 1});
-      return gen_string_items.size() - 1;
-    } else {
-      return it->second;
-    }
+    return gen_string_table.insert(str).first;
   }
 
-  uint32_t get_or_add_tran(const std::string &str) {
-    auto it = gen_tran_items.find(str);
-    if (it == gen_tran_items.end()) {
-      gen_tran_table.push_back(str);
-      gen_tran_items.insert({str, gen_tran_table.size() - 1});
-      return gen_tran_table.size() - 1;
-    } else {
-      return it->second;
-    }
+  uint32_t get_or_add_tran(std::string_view str) {
+    return gen_tran_table.insert(str).first;
   }
 
   uint32_t get_or_add_impr_indices(const std::vector<uint32_t> &vec) {
-    auto it = gen_import_table.find(vec);
-    if (it == gen_import_table.end()) {
-      gen_import_items.push_back(vec);
-      gen_import_table.insert({vec, gen_import_items.size() - 1});
-      return gen_import_items.size() - 1;
-    } else {
-      return it->second;
-    }
+    return gen_import_table.insert(vec).first;
   }
 
-  uint32_t get_or_add_impr(std::string impr) {
+  uint32_t get_or_add_impr(std::string_view impr) {
     std::vector<uint32_t> vec;
     for (auto str : std::views::split(impr, '/')) {
-      std::string foo = std::string(str.begin(), str.end());
-      vec.push_back(get_or_add_tran(foo));
+      vec.push_back(get_or_add_tran(std::string_view(str.begin(), str.end())));
     }
     return get_or_add_impr_indices(vec);
   }
 
+  // the first object with a path keeps it
   uint32_t get_or_add_expr_indices(const std::vector<uint32_t> &vec,
                                    uint32_t object_idx) {
-    auto it = gen_export_table.find(vec);
-    if (it == gen_export_table.end()) {
-      gen_export_items.push_back(vec);
-      gen_export_table.insert({vec, object_idx});
-      return gen_export_items.size() - 1;
-    } else {
-      return it->second;
+    auto [index, inserted] = gen_export_table.insert(vec);
+    if (inserted) {
+      gen_export_objects.push_back(object_idx);
     }
+    return index;
   }
 
-  uint32_t get_or_add_expr(std::string expr, uint32_t object_idx) {
+  uint32_t get_or_add_expr(std::string_view expr, uint32_t object_idx) {
     std::vector<uint32_t> vec;
     for (auto str : std::views::split(expr, '/')) {
-      std::string foo = std::string(str.begin(), str.end());
-      vec.push_back(get_or_add_tran(foo));
+      vec.push_back(get_or_add_tran(std::string_view(str.begin(), str.end())));
     }
     return get_or_add_expr_indices(vec, object_idx);
   }
 
-  void load_from_ndfbin_stream(std::istream &stream);
-  void load_from_ndfbin(fs::path path);
+  // jobs > 1 decodes the objects on that many threads
+  void load_from_ndfbin_stream(std::istream &stream, unsigned jobs = 1);
+  // the buffer is only used during the call, nothing keeps references into it
+  void load_from_ndfbin_buffer(std::span<const std::byte> data,
+                               unsigned jobs = 1);
+  void load_from_ndfbin(fs::path path, unsigned jobs = 1);
+  // maps the file and only reads the tables and where every object starts.
+  // objects in object_map have their name, class, export path and top
+  // object flag but no properties until get_object decodes them, the file
+  // stays mapped until then. not thread safe, even for reading
+  void load_from_ndfbin_lazy(fs::path path);
+  // decodes every object still pending from a lazy load. saving, renaming
+  // and the reference index do this on their own, code iterating object_map
+  // directly has to call it first
+  void load_lazy_objects();
+  [[nodiscard]] bool has_lazy_objects() const { return !lazy_objects.empty(); }
+  // the stream is only written front to back, pipes work as well
   void save_as_ndfbin_stream(std::ostream &stream);
+  // the whole file in memory, e.g. for an EDat entry
+  std::vector<std::byte> save_as_ndfbin_buffer();
   void save_as_ndfbin(fs::path);
 
   void clear() {
@@ -331,17 +484,19 @@ public:
     property_table.clear();
     tran_table.clear();
     object_map.clear();
-    gen_object_items.clear();
-    gen_string_items.clear();
+    invalidate_reference_index();
+    property_arena->release();
+    worker_arenas.clear();
+    lazy_objects.clear();
+    lazy_file = MappedFile();
+    gen_object_table.clear();
     gen_string_table.clear();
-    gen_clas_items.clear();
     gen_clas_table.clear();
-    gen_tran_items.clear();
     gen_tran_table.clear();
     gen_import_table.clear();
-    gen_import_items.clear();
     gen_export_table.clear();
-    gen_export_items.clear();
+    gen_export_objects.clear();
     gen_property_table.clear();
+    gen_property_items.clear();
   }
 };
@@ -1,22 +1,29 @@
 #include "ndf.hpp"
-#include "utf.hpp"
-
-std::unique_ptr<NDFProperty>
-NDFProperty::get_property_from_ndfbin(uint32_t ndf_type, std::istream &stream) {
-  spdlog::debug("NDFType: {} @0x{:02X}", ndf_type, (uint32_t)stream.tellg());
+#include "utf_transcode.hpp"
+
+// item names of the containers, interned once instead of per item
+static const NDFPropertyName list_item_name("ListItem");
+static const NDFPropertyName map_key_name("Key");
+static const NDFPropertyName map_value_name("Value");
+static const NDFPropertyName pair_first_name("First");
+static const NDFPropertyName pair_second_name("Second");
+
+NDFPropertyPtr
+NDFProperty::get_property_from_ndfbin(uint32_t ndf_type, BinaryCursor &cursor,
+                                      std::pmr::memory_resource *arena) {
+  spdlog::debug("NDFType: {} @0x{:02X}", ndf_type, cursor.tell());
   if (ndf_type == 0x9) {
-    uint32_t reference_type;
-    stream.read(reinterpret_cast<char *>(&reference_type), sizeof(uint32_t));
+    auto reference_type = cursor.read<uint32_t>();
     if (reference_type == ReferenceType::Object) {
-      return std::make_unique<NDFPropertyObjectReference>();
+      return make_ndf_property<NDFPropertyObjectReference>(arena);
     } else if (reference_type == ReferenceType::Import) {
-      return std::make_unique<NDFPropertyImportReference>();
+      return make_ndf_property<NDFPropertyImportReference>(arena);
     } else {
       throw std::runtime_error(
           std::format("Unknown ReferenceType: {}", reference_type));
     }
   }
-  return get_property_from_ndftype(ndf_type);
+  return get_property_from_ndftype(ndf_type, arena);
 }
 
 #pragma pack(push, 1)
@@ -25,9 +32,8 @@ struct NDF_Bool {
 };
 #pragma pack(pop)
 
-void NDFPropertyBool::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Bool ndf_bool;
-  stream.read(reinterpret_cast<char *>(&ndf_bool), sizeof(NDF_Bool));
+void NDFPropertyBool::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_bool = cursor.read<NDF_Bool>();
   value = ndf_bool.value;
 }
 void NDFPropertyBool::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -42,9 +48,8 @@ struct NDF_UInt8 {
 };
 #pragma pack(pop)
 
-void NDFPropertyUInt8::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_UInt8 ndf_int8;
-  stream.read(reinterpret_cast<char *>(&ndf_int8), sizeof(NDF_UInt8));
+void NDFPropertyUInt8::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_int8 = cursor.read<NDF_UInt8>();
   value = ndf_int8.value;
 }
 void NDFPropertyUInt8::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -59,9 +64,8 @@ struct NDF_Int32 {
 };
 #pragma pack(pop)
 
-void NDFPropertyInt32::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Int32 ndf_int32;
-  stream.read(reinterpret_cast<char *>(&ndf_int32), sizeof(NDF_Int32));
+void NDFPropertyInt32::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_int32 = cursor.read<NDF_Int32>();
   value = ndf_int32.value;
 }
 void NDFPropertyInt32::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -76,9 +80,8 @@ struct NDF_UInt32 {
 };
 #pragma pack(pop)
 
-void NDFPropertyUInt32::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_UInt32 ndf_uint32;
-  stream.read(reinterpret_cast<char *>(&ndf_uint32), sizeof(NDF_UInt32));
+void NDFPropertyUInt32::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_uint32 = cursor.read<NDF_UInt32>();
   value = ndf_uint32.value;
 }
 void NDFPropertyUInt32::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -93,9 +96,8 @@ struct NDF_Float32 {
 };
 #pragma pack(pop)
 
-void NDFPropertyFloat32::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Float32 ndf_float32;
-  stream.read(reinterpret_cast<char *>(&ndf_float32), sizeof(NDF_Float32));
+void NDFPropertyFloat32::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_float32 = cursor.read<NDF_Float32>();
   value = ndf_float32.value;
 }
 void NDFPropertyFloat32::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -110,9 +112,8 @@ struct NDF_Float64 {
 };
 #pragma pack(pop)
 
-void NDFPropertyFloat64::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Float64 ndf_float64;
-  stream.read(reinterpret_cast<char *>(&ndf_float64), sizeof(NDF_Float64));
+void NDFPropertyFloat64::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_float64 = cursor.read<NDF_Float64>();
   value = ndf_float64.value;
 }
 void NDFPropertyFloat64::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -127,10 +128,9 @@ struct NDF_String {
 };
 #pragma pack(pop)
 
-void NDFPropertyString::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_String ndf_string;
-  stream.read(reinterpret_cast<char *>(&ndf_string), sizeof(NDF_String));
-  value = root->string_table[ndf_string.string_index];
+void NDFPropertyString::from_ndfbin(NDF *root, BinaryCursor &cursor) {
+  auto ndf_string = cursor.read<NDF_String>();
+  value = root->string_table.at(ndf_string.string_index);
 }
 
 void NDFPropertyString::to_ndfbin(NDF *root, std::ostream &stream) const {
@@ -145,30 +145,23 @@ struct NDF_WideString {
 };
 #pragma pack(pop)
 
-void NDFPropertyWideString::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_WideString ndf_wide_string;
-  stream.read(reinterpret_cast<char *>(&ndf_wide_string),
-              sizeof(NDF_WideString));
-  assert(ndf_wide_string.length % 2 == 0);
-  std::u16string str;
-  for (uint32_t i = 0; i < ndf_wide_string.length / 2; i++) {
-    char16_t c;
-    stream.read(reinterpret_cast<char *>(&c), sizeof(char16_t));
-    str.push_back(c);
-  }
-  // convert to UTF-8
-  value = Utf32To8(Utf16To32(str));
+void NDFPropertyWideString::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_wide_string = cursor.read<NDF_WideString>();
+  // the whole payload in one read, converted to UTF-8 in one pass
+  utf16le_to_utf8(cursor.read_bytes(ndf_wide_string.length), value);
   spdlog::debug("WideString: {}", value);
 }
 
 void NDFPropertyWideString::to_ndfbin(NDF *, std::ostream &stream) const {
+  std::u16string buffer;
+  utf8_to_utf16le(value, buffer);
+  // the length is in bytes of UTF-16
   NDF_WideString ndf_wide_string;
-  ndf_wide_string.length = value.size() * 2;
+  ndf_wide_string.length = buffer.size() * sizeof(char16_t);
   stream.write(reinterpret_cast<char *>(&ndf_wide_string),
                sizeof(NDF_WideString));
-  // convert to UTF-16
-  std::u16string buffer = Utf32To16(Utf8To32(value));
-  stream.write((char *)buffer.data(), buffer.size() * sizeof(char16_t));
+  stream.write(reinterpret_cast<const char *>(buffer.data()),
+               buffer.size() * sizeof(char16_t));
 }
 
 #pragma pack(push, 1)
@@ -179,9 +172,8 @@ struct NDF_F32_vec3 {
 };
 #pragma pack(pop)
 
-void NDFPropertyF32_vec3::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_F32_vec3 ndf_f32_vec3;
-  stream.read(reinterpret_cast<char *>(&ndf_f32_vec3), sizeof(NDF_F32_vec3));
+void NDFPropertyF32_vec3::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_f32_vec3 = cursor.read<NDF_F32_vec3>();
   x = ndf_f32_vec3.x;
   y = ndf_f32_vec3.y;
   z = ndf_f32_vec3.z;
@@ -203,9 +195,8 @@ struct NDF_F32_vec4 {
 };
 #pragma pack(pop)
 
-void NDFPropertyF32_vec4::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_F32_vec4 ndf_f32_vec4;
-  stream.read(reinterpret_cast<char *>(&ndf_f32_vec4), sizeof(NDF_F32_vec4));
+void NDFPropertyF32_vec4::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_f32_vec4 = cursor.read<NDF_F32_vec4>();
   x = ndf_f32_vec4.x;
   y = ndf_f32_vec4.y;
   z = ndf_f32_vec4.z;
@@ -229,9 +220,8 @@ struct NDF_Color {
 };
 #pragma pack(pop)
 
-void NDFPropertyColor::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Color ndf_color;
-  stream.read(reinterpret_cast<char *>(&ndf_color), sizeof(NDF_Color));
+void NDFPropertyColor::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_color = cursor.read<NDF_Color>();
   r = ndf_color.r;
   g = ndf_color.g;
   b = ndf_color.b;
@@ -254,9 +244,8 @@ struct NDF_S32_vec3 {
 };
 #pragma pack(pop)
 
-void NDFPropertyS32_vec3::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_S32_vec3 ndf_s32_vec3;
-  stream.read(reinterpret_cast<char *>(&ndf_s32_vec3), sizeof(NDF_S32_vec3));
+void NDFPropertyS32_vec3::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_s32_vec3 = cursor.read<NDF_S32_vec3>();
   x = ndf_s32_vec3.x;
   y = ndf_s32_vec3.y;
   z = ndf_s32_vec3.z;
@@ -276,10 +265,8 @@ struct NDF_ObjectReference {
 };
 #pragma pack(pop)
 
-void NDFPropertyObjectReference::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_ObjectReference ndf_object_reference;
-  stream.read(reinterpret_cast<char *>(&ndf_object_reference),
-              sizeof(NDF_ObjectReference));
+void NDFPropertyObjectReference::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_object_reference = cursor.read<NDF_ObjectReference>();
   object_name = "Object_" + std::to_string(ndf_object_reference.object_index);
 }
 
@@ -301,11 +288,14 @@ struct NDF_ImportReference {
 };
 #pragma pack(pop)
 
-void NDFPropertyImportReference::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_ImportReference ndf_import_reference;
-  stream.read(reinterpret_cast<char *>(&ndf_import_reference),
-              sizeof(NDF_ImportReference));
-  import_name = root->import_name_table[ndf_import_reference.import_index];
+void NDFPropertyImportReference::from_ndfbin(NDF *root, BinaryCursor &cursor) {
+  auto ndf_import_reference = cursor.read<NDF_ImportReference>();
+  auto it = root->import_name_table.find(ndf_import_reference.import_index);
+  if (it == root->import_name_table.end()) {
+    throw std::runtime_error(std::format("Unknown import index: {}",
+                                         ndf_import_reference.import_index));
+  }
+  import_name = it->second;
 }
 
 void NDFPropertyImportReference::to_ndfbin(NDF *root,
@@ -325,15 +315,16 @@ struct NDF_List {
 };
 #pragma pack(pop)
 
-void NDFPropertyList::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_List ndf_list;
-  stream.read(reinterpret_cast<char *>(&ndf_list), sizeof(NDF_List));
+void NDFPropertyList::from_ndfbin(NDF *root, BinaryCursor &cursor) {
+  auto ndf_list = cursor.read<NDF_List>();
+  // every item takes at least 5 bytes, don't trust the count blindly
+  values.reserve(std::min<size_t>(ndf_list.count, cursor.remaining() / 5));
   for (uint32_t i = 0; i < ndf_list.count; i++) {
-    uint32_t ndf_type = 0xFFFFFFFF;
-    stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    auto property = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-    property->from_ndfbin(root, stream);
-    property->property_name = "ListItem";
+    auto ndf_type = cursor.read<uint32_t>();
+    auto property = NDFProperty::get_property_from_ndfbin(
+        ndf_type, cursor, root->get_property_arena());
+    property->from_ndfbin(root, cursor);
+    property->property_name = list_item_name;
     values.push_back(std::move(property));
   }
 }
@@ -355,19 +346,20 @@ struct NDF_Map {
 };
 #pragma pack(pop)
 
-void NDFPropertyMap::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_Map ndf_map;
-  stream.read(reinterpret_cast<char *>(&ndf_map), sizeof(NDF_Map));
+void NDFPropertyMap::from_ndfbin(NDF *root, BinaryCursor &cursor) {
+  auto ndf_map = cursor.read<NDF_Map>();
+  values.reserve(std::min<size_t>(ndf_map.count, cursor.remaining() / 10));
   for (uint32_t i = 0; i < ndf_map.count; i++) {
-    uint32_t ndf_type = 0xFFFFFFFF;
-    stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    auto key = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-    key->from_ndfbin(root, stream);
-    key->property_name = "Key";
-    stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-    auto value = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-    value->from_ndfbin(root, stream);
-    value->property_name = "Value";
+    auto ndf_type = cursor.read<uint32_t>();
+    auto key = NDFProperty::get_property_from_ndfbin(
+        ndf_type, cursor, root->get_property_arena());
+    key->from_ndfbin(root, cursor);
+    key->property_name = map_key_name;
+    ndf_type = cursor.read<uint32_t>();
+    auto value = NDFProperty::get_property_from_ndfbin(
+        ndf_type, cursor, root->get_property_arena());
+    value->from_ndfbin(root, cursor);
+    value->property_name = map_value_name;
     values.push_back(std::make_pair(std::move(key), std::move(value)));
   }
 }
@@ -392,9 +384,8 @@ struct NDF_Int16 {
 };
 #pragma pack(pop)
 
-void NDFPropertyInt16::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Int16 ndf_s16;
-  stream.read(reinterpret_cast<char *>(&ndf_s16), sizeof(NDF_Int16));
+void NDFPropertyInt16::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_s16 = cursor.read<NDF_Int16>();
   value = ndf_s16.value;
 }
 void NDFPropertyInt16::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -409,9 +400,8 @@ struct NDF_UInt16 {
 };
 #pragma pack(pop)
 
-void NDFPropertyUInt16::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_UInt16 ndf_u16;
-  stream.read(reinterpret_cast<char *>(&ndf_u16), sizeof(NDF_UInt16));
+void NDFPropertyUInt16::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_u16 = cursor.read<NDF_UInt16>();
   value = ndf_u16.value;
 }
 void NDFPropertyUInt16::to_ndfbin(NDF *, std::ostream &stream) const {
@@ -426,9 +416,8 @@ struct NDF_GUID {
 };
 #pragma pack(pop)
 
-void NDFPropertyGUID::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_GUID ndf_guid;
-  stream.read(reinterpret_cast<char *>(&ndf_guid), sizeof(NDF_GUID));
+void NDFPropertyGUID::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_guid = cursor.read<NDF_GUID>();
   guid = "";
   for (auto const &byte : ndf_guid.guid) {
     guid += std::format("{:02X}", byte);
@@ -449,11 +438,9 @@ struct NDF_PathReference {
 };
 #pragma pack(pop)
 
-void NDFPropertyPathReference::from_ndfbin(NDF *root, std::istream &stream) {
-  NDF_PathReference ndf_path_reference;
-  stream.read(reinterpret_cast<char *>(&ndf_path_reference),
-              sizeof(NDF_PathReference));
-  path = root->string_table[ndf_path_reference.path_index];
+void NDFPropertyPathReference::from_ndfbin(NDF *root, BinaryCursor &cursor) {
+  auto ndf_path_reference = cursor.read<NDF_PathReference>();
+  path = root->string_table.at(ndf_path_reference.path_index);
 }
 
 void NDFPropertyPathReference::to_ndfbin(NDF *root,
@@ -470,10 +457,8 @@ struct NDF_LocalisationHash {
 };
 #pragma pack(pop)
 
-void NDFPropertyLocalisationHash::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_LocalisationHash ndf_hash;
-  stream.read(reinterpret_cast<char *>(&ndf_hash),
-              sizeof(NDF_LocalisationHash));
+void NDFPropertyLocalisationHash::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_hash = cursor.read<NDF_LocalisationHash>();
   hash = "";
   for (auto const &byte : ndf_hash.hash) {
     hash += std::format("{:02X}", byte);
@@ -496,9 +481,8 @@ struct NDF_S32_vec2 {
 };
 #pragma pack(pop)
 
-void NDFPropertyS32_vec2::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_S32_vec2 ndf_s32_vec2;
-  stream.read(reinterpret_cast<char *>(&ndf_s32_vec2), sizeof(NDF_S32_vec2));
+void NDFPropertyS32_vec2::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_s32_vec2 = cursor.read<NDF_S32_vec2>();
   x = ndf_s32_vec2.x;
   y = ndf_s32_vec2.y;
 }
@@ -516,9 +500,8 @@ struct NDF_F32_vec2 {
 };
 #pragma pack(pop)
 
-void NDFPropertyF32_vec2::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_F32_vec2 ndf_f32_vec2;
-  stream.read(reinterpret_cast<char *>(&ndf_f32_vec2), sizeof(NDF_F32_vec2));
+void NDFPropertyF32_vec2::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_f32_vec2 = cursor.read<NDF_F32_vec2>();
   x = ndf_f32_vec2.x;
   y = ndf_f32_vec2.y;
 }
@@ -529,16 +512,17 @@ void NDFPropertyF32_vec2::to_ndfbin(NDF *, std::ostream &stream) const {
   stream.write(reinterpret_cast<char *>(&ndf_f32_vec2), sizeof(NDF_F32_vec2));
 }
 
-void NDFPropertyPair::from_ndfbin(NDF *root, std::istream &stream) {
-  uint32_t ndf_type = 0xFFFFFFFF;
-  stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-  first = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-  first->from_ndfbin(root, stream);
-  first->property_name = "First";
-  stream.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-  second = NDFProperty::get_property_from_ndfbin(ndf_type, stream);
-  second->from_ndfbin(root, stream);
-  second->property_name = "Second";
+void NDFPropertyPair::from_ndfbin(NDF *root, BinaryCursor &cursor) {
+  auto ndf_type = cursor.read<uint32_t>();
+  first = NDFProperty::get_property_from_ndfbin(ndf_type, cursor,
+                                                root->get_property_arena());
+  first->from_ndfbin(root, cursor);
+  first->property_name = pair_first_name;
+  ndf_type = cursor.read<uint32_t>();
+  second = NDFProperty::get_property_from_ndfbin(ndf_type, cursor,
+                                                root->get_property_arena());
+  second->from_ndfbin(root, cursor);
+  second->property_name = pair_second_name;
 }
 
 void NDFPropertyPair::to_ndfbin(NDF *root, std::ostream &stream) const {
@@ -556,9 +540,8 @@ struct NDF_Hash {
 };
 #pragma pack(pop)
 
-void NDFPropertyHash::from_ndfbin(NDF *, std::istream &stream) {
-  NDF_Hash ndf_hash;
-  stream.read(reinterpret_cast<char *>(&ndf_hash), sizeof(NDF_Hash));
+void NDFPropertyHash::from_ndfbin(NDF *, BinaryCursor &cursor) {
+  auto ndf_hash = cursor.read<NDF_Hash>();
   hash = "";
   for (auto const &byte : ndf_hash.hash) {
     hash += std::format("{:02X}", byte);
@@ -566,9 +549,112 @@ void NDFPropertyHash::from_ndfbin(NDF *, std::istream &stream) {
 }
 void NDFPropertyHash::to_ndfbin(NDF *, std::ostream &stream) const {
   NDF_Hash ndf_hash;
-  for (uint32_t i = 0; i < 8; i++) {
+  for (uint32_t i = 0; i < 16; i++) {
     std::from_chars(hash.c_str() + i * 2, hash.c_str() + i * 2 + 2,
                     ndf_hash.hash[i], 16);
   }
   stream.write(reinterpret_cast<char *>(&ndf_hash), sizeof(NDF_Hash));
 }
+
+void NDFProperty::skip_ndfbin(uint32_t ndf_type, BinaryCursor &cursor) {
+  // items of containers are prefixed with their type
+  auto skip_item = [&cursor]() {
+    auto item_type = cursor.read<uint32_t>();
+    skip_ndfbin(item_type, cursor);
+  };
+  switch (ndf_type) {
+  case NDFPropertyType::Bool:
+    cursor.skip(sizeof(NDF_Bool));
+    break;
+  case NDFPropertyType::UInt8:
+    cursor.skip(sizeof(NDF_UInt8));
+    break;
+  case NDFPropertyType::Int32:
+    cursor.skip(sizeof(NDF_Int32));
+    break;
+  case NDFPropertyType::UInt32:
+    cursor.skip(sizeof(NDF_UInt32));
+    break;
+  case NDFPropertyType::Float32:
+    cursor.skip(sizeof(NDF_Float32));
+    break;
+  case NDFPropertyType::Float64:
+    cursor.skip(sizeof(NDF_Float64));
+    break;
+  case NDFPropertyType::String:
+    cursor.skip(sizeof(NDF_String));
+    break;
+  case NDFPropertyType::WideString:
+    cursor.skip(cursor.read<NDF_WideString>().length);
+    break;
+  case NDFPropertyType::ObjectReference: {
+    auto reference_type = cursor.read<uint32_t>();
+    if (reference_type == ReferenceType::Object) {
+      cursor.skip(sizeof(NDF_ObjectReference));
+    } else if (reference_type == ReferenceType::Import) {
+      cursor.skip(sizeof(NDF_ImportReference));
+    } else {
+      throw std::runtime_error(
+          std::format("Unknown ReferenceType: {}", reference_type));
+    }
+    break;
+  }
+  case NDFPropertyType::F32_vec3:
+    cursor.skip(sizeof(NDF_F32_vec3));
+    break;
+  case NDFPropertyType::F32_vec4:
+    cursor.skip(sizeof(NDF_F32_vec4));
+    break;
+  case NDFPropertyType::Color:
+    cursor.skip(sizeof(NDF_Color));
+    break;
+  case NDFPropertyType::S32_vec3:
+    cursor.skip(sizeof(NDF_S32_vec3));
+    break;
+  case NDFPropertyType::List: {
+    auto count = cursor.read<NDF_List>().count;
+    for (uint32_t i = 0; i < count; i++) {
+      skip_item();
+    }
+    break;
+  }
+  case NDFPropertyType::Map: {
+    auto count = cursor.read<NDF_Map>().count;
+    for (uint32_t i = 0; i < count; i++) {
+      skip_item();
+      skip_item();
+    }
+    break;
+  }
+  case NDFPropertyType::Int16:
+    cursor.skip(sizeof(NDF_Int16));
+    break;
+  case NDFPropertyType::UInt16:
+    cursor.skip(sizeof(NDF_UInt16));
+    break;
+  case NDFPropertyType::NDFGUID:
+    cursor.skip(sizeof(NDF_GUID));
+    break;
+  case NDFPropertyType::PathReference:
+    cursor.skip(sizeof(NDF_PathReference));
+    break;
+  case NDFPropertyType::LocalisationHash:
+    cursor.skip(sizeof(NDF_LocalisationHash));
+    break;
+  case NDFPropertyType::S32_vec2:
+    cursor.skip(sizeof(NDF_S32_vec2));
+    break;
+  case NDFPropertyType::F32_vec2:
+    cursor.skip(sizeof(NDF_F32_vec2));
+    break;
+  case NDFPropertyType::Pair:
+    skip_item();
+    skip_item();
+    break;
+  case NDFPropertyType::Hash:
+    cursor.skip(sizeof(NDF_Hash));
+    break;
+  default:
+    throw std::runtime_error(std::format("Unknown NDFType: {}", ndf_type));
+  }
+}
@@ -0,0 +1,173 @@
+#include "ndf_columnar.hpp"
+
+#include <stdexcept>
+
+void NDFColumnarStore::clear() {
+  m_object_names.clear();
+  m_object_classes.clear();
+  m_class_names.clear();
+  m_class_ranges.clear();
+  m_object_lookup.clear();
+  m_class_lookup.clear();
+  m_columns.clear();
+  m_column_lookup.clear();
+}
+
+void NDFColumnarStore::load(const NDF &ndf) {
+  if (ndf.has_lazy_objects()) {
+    throw std::runtime_error(
+        "NDFColumnarStore: call load_lazy_objects on lazy loaded NDFs");
+  }
+  clear();
+
+  // group the objects by class, classes in order of their first object and
+  // the objects of a class in file order
+  std::vector<std::vector<const NDFObject *>> classes;
+  std::unordered_map<std::string_view, uint32_t> class_indices;
+  for (const auto &[name, object] : ndf.object_map) {
+    auto [it, inserted] =
+        class_indices.try_emplace(object.class_name, classes.size());
+    if (inserted) {
+      classes.emplace_back();
+      m_class_names.push_back(object.class_name);
+    }
+    classes[it->second].push_back(&object);
+  }
+
+  m_object_names.reserve(ndf.object_map.size());
+  m_object_classes.reserve(ndf.object_map.size());
+  for (const auto &[class_idx, objects] : classes | std::views::enumerate) {
+    uint32_t begin = m_object_names.size();
+    for (const NDFObject *object : objects) {
+      uint32_t object_idx = m_object_names.size();
+      m_object_names.push_back(object->name);
+      m_object_classes.push_back(class_idx);
+      for (const auto &property : object->properties) {
+        add_value(object_idx, *property);
+      }
+    }
+    m_class_ranges.emplace_back(begin, m_object_names.size());
+  }
+
+  // the name vectors don't change anymore, views into them stay valid
+  for (const auto &[idx, name] : m_object_names | std::views::enumerate) {
+    m_object_lookup.emplace(name, idx);
+  }
+  for (const auto &[idx, name] : m_class_names | std::views::enumerate) {
+    m_class_lookup.emplace(name, idx);
+  }
+  spdlog::debug("columnar store: {} objects, {} classes, {} columns",
+                m_object_names.size(), m_class_names.size(), m_columns.size());
+}
+
+// new columns start out with the first alternative, not the one of T
+template <typename T, typename Values>
+static void append_value(Values &values, const T &value) {
+  using Element = ndf_column_element_t<T>;
+  auto *typed = std::get_if<std::vector<Element>>(&values);
+  if (!typed) {
+    typed = &values.template emplace<std::vector<Element>>();
+  }
+  typed->push_back(Element{value});
+}
+
+void NDFColumnarStore::add_value(uint32_t object,
+                                 const NDFProperty &property) {
+  const auto type = property.property_type;
+  switch (type) {
+  case NDFPropertyType::Bool:
+  case NDFPropertyType::UInt8:
+  case NDFPropertyType::Int16:
+  case NDFPropertyType::UInt16:
+  case NDFPropertyType::Int32:
+  case NDFPropertyType::UInt32:
+  case NDFPropertyType::Float32:
+  case NDFPropertyType::Float64:
+    break;
+  default:
+    return;
+  }
+
+  auto &indices = m_column_lookup[property.property_name.str()];
+  Column *column = nullptr;
+  for (uint32_t idx : indices) {
+    if (m_columns[idx].property_type == type) {
+      column = &m_columns[idx];
+      break;
+    }
+  }
+  if (!column) {
+    indices.push_back(m_columns.size());
+    column = &m_columns.emplace_back(
+        Column{property.property_name, type, {}, {}});
+  }
+
+  column->objects.push_back(object);
+  switch (type) {
+  case NDFPropertyType::Bool:
+    append_value(column->values,
+                 static_cast<const NDFPropertyBool &>(property).value);
+    break;
+  case NDFPropertyType::UInt8:
+    append_value(column->values,
+                 static_cast<const NDFPropertyUInt8 &>(property).value);
+    break;
+  case NDFPropertyType::Int16:
+    append_value(column->values,
+                 static_cast<const NDFPropertyInt16 &>(property).value);
+    break;
+  case NDFPropertyType::UInt16:
+    append_value(column->values,
+                 static_cast<const NDFPropertyUInt16 &>(property).value);
+    break;
+  case NDFPropertyType::Int32:
+    append_value(column->values,
+                 static_cast<const NDFPropertyInt32 &>(property).value);
+    break;
+  case NDFPropertyType::UInt32:
+    append_value(column->values,
+                 static_cast<const NDFPropertyUInt32 &>(property).value);
+    break;
+  case NDFPropertyType::Float32:
+    append_value(column->values,
+                 static_cast<const NDFPropertyFloat32 &>(property).value);
+    break;
+  case NDFPropertyType::Float64:
+    append_value(column->values,
+                 static_cast<const NDFPropertyFloat64 &>(property).value);
+    break;
+  }
+}
+
+const NDFColumnarStore::Column *
+NDFColumnarStore::find_column(std::string_view property_name,
+                              uint32_t property_type) const {
+  auto it = m_column_lookup.find(property_name);
+  if (it == m_column_lookup.end()) {
+    return nullptr;
+  }
+  for (uint32_t idx : it->second) {
+    if (m_columns[idx].property_type == property_type) {
+      return &m_columns[idx];
+    }
+  }
+  return nullptr;
+}
+
+std::optional<uint32_t>
+NDFColumnarStore::find_object(std::string_view object_name) const {
+  auto it = m_object_lookup.find(object_name);
+  if (it == m_object_lookup.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::pair<uint32_t, uint32_t>
+NDFColumnarStore::get_class_range(std::string_view class_name) const {
+  auto it = m_class_lookup.find(class_name);
+  if (it == m_class_lookup.end()) {
+    return {0, 0};
+  }
+  return m_class_ranges[it->second];
+}
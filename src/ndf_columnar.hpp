@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ndf.hpp"
+
+// property type that holds values of T in a column
+template <typename T> constexpr uint32_t ndf_column_type = 0xFFFFFFFF;
+template <>
+inline constexpr uint32_t ndf_column_type<bool> = NDFPropertyType::Bool;
+template <>
+inline constexpr uint32_t ndf_column_type<uint8_t> = NDFPropertyType::UInt8;
+template <>
+inline constexpr uint32_t ndf_column_type<int16_t> = NDFPropertyType::Int16;
+template <>
+inline constexpr uint32_t ndf_column_type<uint16_t> = NDFPropertyType::UInt16;
+template <>
+inline constexpr uint32_t ndf_column_type<int32_t> = NDFPropertyType::Int32;
+template <>
+inline constexpr uint32_t ndf_column_type<uint32_t> = NDFPropertyType::UInt32;
+template <>
+inline constexpr uint32_t ndf_column_type<float> = NDFPropertyType::Float32;
+template <>
+inline constexpr uint32_t ndf_column_type<double> = NDFPropertyType::Float64;
+
+template <typename T>
+concept NDFColumnValue = ndf_column_type<T> != 0xFFFFFFFF;
+
+// std::vector<bool> packs its values into bits and has no span, bool columns
+// store this instead
+struct NDFColumnBool {
+  bool value;
+  operator bool() const { return value; }
+};
+
+// element type of the column of T
+template <typename T> struct ndf_column_element {
+  using type = T;
+};
+template <> struct ndf_column_element<bool> {
+  using type = NDFColumnBool;
+};
+template <typename T>
+using ndf_column_element_t = typename ndf_column_element<T>::type;
+
+// values of one property, values[i] belongs to the object objects[i]. object
+// indices are ascending, so the values of a class are contiguous as well
+template <NDFColumnValue T> struct NDFColumnView {
+  std::span<const uint32_t> objects;
+  std::span<const ndf_column_element_t<T>> values;
+
+  [[nodiscard]] size_t size() const { return values.size(); }
+  [[nodiscard]] bool empty() const { return values.empty(); }
+};
+
+// read-only struct-of-arrays copy of the scalar properties of a NDF. every
+// property name and type gets a column with the values of all objects that
+// have it packed into one array, so a scan over e.g. every MaxSpeed of a
+// class touches a single contiguous block instead of one heap allocation per
+// property. objects are grouped by class, a class is a range of indices.
+// strings, references and containers are not part of the store, they have to
+// be read from the NDF
+class NDFColumnarStore {
+private:
+  // the values of a column, the alternative matches its property_type
+  using ColumnValues =
+      std::variant<std::vector<NDFColumnBool>, std::vector<uint8_t>,
+                   std::vector<int16_t>, std::vector<uint16_t>,
+                   std::vector<int32_t>, std::vector<uint32_t>,
+                   std::vector<float>, std::vector<double>>;
+  struct Column {
+    NDFPropertyName name;
+    uint32_t property_type;
+    std::vector<uint32_t> objects;
+    ColumnValues values;
+  };
+
+  std::vector<std::string> m_object_names;
+  std::vector<uint32_t> m_object_classes;
+  std::vector<std::string> m_class_names;
+  // [begin, end) of the objects of every class
+  std::vector<std::pair<uint32_t, uint32_t>> m_class_ranges;
+  std::unordered_map<std::string_view, uint32_t> m_object_lookup;
+  std::unordered_map<std::string_view, uint32_t> m_class_lookup;
+
+  std::vector<Column> m_columns;
+  // a name can have several columns if the type differs between classes. the
+  // keys point into the property name pool
+  std::unordered_map<std::string_view, std::vector<uint32_t>> m_column_lookup;
+
+  [[nodiscard]] const Column *find_column(std::string_view property_name,
+                                          uint32_t property_type) const;
+  void add_value(uint32_t object, const NDFProperty &property);
+
+public:
+  NDFColumnarStore() = default;
+  explicit NDFColumnarStore(const NDF &ndf) { load(ndf); }
+
+  // the lookup tables point into the name vectors, moving keeps their
+  // buffers but a copy would not
+  NDFColumnarStore(const NDFColumnarStore &) = delete;
+  NDFColumnarStore &operator=(const NDFColumnarStore &) = delete;
+  NDFColumnarStore(NDFColumnarStore &&) = default;
+  NDFColumnarStore &operator=(NDFColumnarStore &&) = default;
+
+  void load(const NDF &ndf);
+  void clear();
+
+  [[nodiscard]] size_t object_count() const { return m_object_names.size(); }
+  [[nodiscard]] size_t column_count() const { return m_columns.size(); }
+  [[nodiscard]] const std::string &get_object_name(uint32_t object) const {
+    return m_object_names.at(object);
+  }
+  [[nodiscard]] const std::string &get_class_name(uint32_t object) const {
+    return m_class_names.at(m_object_classes.at(object));
+  }
+  [[nodiscard]] std::optional<uint32_t>
+  find_object(std::string_view object_name) const;
+  // [begin, end) of the objects of the class, empty if there are none
+  [[nodiscard]] std::pair<uint32_t, uint32_t>
+  get_class_range(std::string_view class_name) const;
+
+  // the column of the property, nullopt if no object has it with type T
+  template <NDFColumnValue T>
+  [[nodiscard]] std::optional<NDFColumnView<T>>
+  get_column(std::string_view property_name) const {
+    const Column *column = find_column(property_name, ndf_column_type<T>);
+    if (!column) {
+      return std::nullopt;
+    }
+    return NDFColumnView<T>{
+        column->objects,
+        std::get<std::vector<ndf_column_element_t<T>>>(column->values)};
+  }
+
+  // only the values of the objects of class_name
+  template <NDFColumnValue T>
+  [[nodiscard]] std::optional<NDFColumnView<T>>
+  get_column(std::string_view property_name,
+             std::string_view class_name) const {
+    auto column = get_column<T>(property_name);
+    if (!column) {
+      return std::nullopt;
+    }
+    auto [begin, end] = get_class_range(class_name);
+    auto first = std::ranges::lower_bound(column->objects, begin);
+    auto last = std::ranges::lower_bound(column->objects, end);
+    size_t offset = first - column->objects.begin();
+    size_t count = last - first;
+    return NDFColumnView<T>{column->objects.subspan(offset, count),
+                            column->values.subspan(offset, count)};
+  }
+
+  template <NDFColumnValue T>
+  [[nodiscard]] std::optional<T>
+  get_value(uint32_t object, std::string_view property_name) const {
+    auto column = get_column<T>(property_name);
+    if (!column) {
+      return std::nullopt;
+    }
+    auto it = std::ranges::lower_bound(column->objects, object);
+    if (it == column->objects.end() || *it != object) {
+      return std::nullopt;
+    }
+    return column->values[it - column->objects.begin()];
+  }
+};
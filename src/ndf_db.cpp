@@ -2,6 +2,8 @@
 #include "sqlite_helpers.hpp"
 
 #include <optional>
+#include <span>
+#include <unordered_set>
 #include <spdlog/spdlog.h>
 
 bool create_table(sqlite3 *db, const char *query) {
@@ -13,9 +15,182 @@ bool create_table(sqlite3 *db, const char *query) {
   return true;
 }
 
+// for single use statements without a result, like PRAGMA synchronous=x
+static bool execute_single(sqlite3 *db, const char *query) {
+  SQLStatement<0, 0> stmt;
+  return stmt.init(db, query) && stmt.execute();
+}
+
+// for single use statements returning one value, like PRAGMA journal_mode
+template <typename T>
+static std::optional<T> query_single_value(sqlite3 *db, const char *query) {
+  SQLStatement<0, 1> stmt;
+  if (!stmt.init(db, query)) {
+    return std::nullopt;
+  }
+  return stmt.query_single<T>();
+}
+
+// secondary indices, name and definition. the ndf_object ones are used while
+// inserting (object references are resolved by name), the bulk ones only for
+// reading and can be built after a bulk load
+struct NDFIndex {
+  const char *name;
+  const char *definition;
+};
+static const NDFIndex object_indices[] = {
+    {"ndf_object_ndf_id_idx", "ndf_object(ndf_id, object_name)"},
+    {"ndf_object_name_idx", "ndf_object(object_name)"},
+    {"ndf_object_export_path_idx", "ndf_object(export_path)"},
+};
+static const NDFIndex bulk_indices[] = {
+    {"ndf_property_object_idx",
+     "ndf_property(object_id) WHERE property_index<>-1"},
+    {"ndf_property_object_type_idx", "ndf_property(object_id, type)"},
+    {"ndf_property_parent_idx", "ndf_property(parent, position)"},
+    {"ndf_property_reference_idx",
+     "ndf_property(value, is_import_reference) WHERE type=9"},
+    {"ndf_object_reference_object_idx",
+     "ndf_object_reference(referenced_object)"},
+    {"ndf_object_reference_unresolved_idx",
+     "ndf_object_reference(optional_value) WHERE referenced_object IS NULL"},
+    {"ndf_import_reference_object_idx",
+     "ndf_import_reference(referenced_object)"},
+    {"ndf_import_reference_unresolved_idx",
+     "ndf_import_reference(optional_value) WHERE referenced_object IS NULL"},
+};
+
+static bool create_indices(sqlite3 *db, std::span<const NDFIndex> indices) {
+  for (const auto &index : indices) {
+    auto query = std::format("CREATE INDEX IF NOT EXISTS {} ON {};", index.name,
+                             index.definition);
+    if (!execute_single(db, query.c_str())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool drop_indices(sqlite3 *db, std::span<const NDFIndex> indices) {
+  for (const auto &index : indices) {
+    auto query = std::format("DROP INDEX IF EXISTS {};", index.name);
+    if (!execute_single(db, query.c_str())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// value table of every scalar type, get_object fetches the values of all of
+// them with one UNION ALL query
+struct NDFValueTable {
+  uint32_t type;
+  const char *table;
+  // always 4 numbers and one text
+  const char *columns;
+  const char *join = "";
+  const char *filter = "";
+};
+static const NDFValueTable value_tables[] = {
+    {NDFPropertyType::Bool, "ndf_bool", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::UInt8, "ndf_uint8", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::Int16, "ndf_int16", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::UInt16, "ndf_uint16", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::Int32, "ndf_int32", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::UInt32, "ndf_uint32", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::Float32, "ndf_float32", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::Float64, "ndf_float64", "v.value, 0, 0, 0, ''"},
+    {NDFPropertyType::String, "ndf_string", "0, 0, 0, 0, v.value"},
+    {NDFPropertyType::WideString, "ndf_widestring", "0, 0, 0, 0, v.value"},
+    {NDFPropertyType::F32_vec2, "ndf_F32_vec2",
+     "v.value_x, v.value_y, 0, 0, ''"},
+    {NDFPropertyType::F32_vec3, "ndf_F32_vec3",
+     "v.value_x, v.value_y, v.value_z, 0, ''"},
+    {NDFPropertyType::F32_vec4, "ndf_F32_vec4",
+     "v.value_x, v.value_y, v.value_z, v.value_w, ''"},
+    {NDFPropertyType::Color, "ndf_color",
+     "v.value_r, v.value_g, v.value_b, v.value_a, ''"},
+    {NDFPropertyType::S32_vec2, "ndf_S32_vec2",
+     "v.value_x, v.value_y, 0, 0, ''"},
+    {NDFPropertyType::S32_vec3, "ndf_S32_vec3",
+     "v.value_x, v.value_y, v.value_z, 0, ''"},
+    {NDFPropertyType::ObjectReference, "ndf_object_reference",
+     "0, 0, 0, 0, COALESCE(o.object_name, v.optional_value, '')",
+     " LEFT JOIN ndf_object AS o ON o.id=v.referenced_object",
+     " AND p.is_import_reference=0"},
+    {NDFPropertyType::ImportReference, "ndf_import_reference",
+     "0, 0, 0, 0, COALESCE(o.export_path, v.optional_value, '')",
+     " LEFT JOIN ndf_object AS o ON o.id=v.referenced_object",
+     " AND p.is_import_reference=1"},
+    {NDFPropertyType::NDFGUID, "ndf_GUID", "0, 0, 0, 0, v.value"},
+    {NDFPropertyType::PathReference, "ndf_path_reference",
+     "0, 0, 0, 0, v.value"},
+    {NDFPropertyType::LocalisationHash, "ndf_localisation_hash",
+     "0, 0, 0, 0, v.value"},
+    {NDFPropertyType::Hash, "ndf_hash", "0, 0, 0, 0, v.value"},
+};
+
+static std::string get_object_values_query() {
+  std::string query;
+  for (const auto &table : value_tables) {
+    if (!query.empty()) {
+      query += " UNION ALL ";
+    }
+    query += std::format(
+        "SELECT p.id, {} FROM ndf_property AS p INNER JOIN {} AS v ON "
+        "v.id=p.value{} WHERE p.object_id=?1 AND p.type={}{}",
+        table.columns, table.table, table.join, table.type, table.filter);
+  }
+  return query + ";";
+}
+
+bool NDF_DB::create_bulk_indices() { return create_indices(db, bulk_indices); }
+
+bool NDF_DB::drop_bulk_indices() { return drop_indices(db, bulk_indices); }
+
+std::optional<int> NDF_DB::get_schema_version() {
+  return query_single_value<int>(db, "PRAGMA user_version;");
+}
+
+// migrates older databases step by step, every step runs in its own
+// transaction and bumps PRAGMA user_version
+bool NDF_DB::migrate_schema() {
+  auto version = get_schema_version();
+  if (!version) {
+    return false;
+  }
+  auto migrate = [&](int target, auto &&step) {
+    if (version.value() >= target) {
+      return true;
+    }
+    spdlog::info("Migrating ndf_db schema from version {} to {}",
+                 version.value(), target);
+    auto set_version = std::format("PRAGMA user_version={};", target);
+    if (!execute_single(db, "BEGIN TRANSACTION;") || !step() ||
+        !execute_single(db, set_version.c_str()) ||
+        !execute_single(db, "COMMIT TRANSACTION;")) {
+      spdlog::error("ndf_db schema migration to version {} failed", target);
+      execute_single(db, "ROLLBACK TRANSACTION;");
+      return false;
+    }
+    version = target;
+    return true;
+  };
+
+  // 1: secondary indices for the lookups of get_object and fix_references
+  // 2: ndf_property(object_id, type) for fetching whole objects
+  // the index lists only ever grow, creating all of them covers both steps
+  return migrate(1,
+                 [&]() {
+                   return create_indices(db, object_indices) &&
+                          create_indices(db, bulk_indices);
+                 }) &&
+         migrate(2, [&]() { return create_indices(db, bulk_indices); });
+}
+
 bool NDF_DB::init_statements() {
   create_table(db,
-               R"rstr( CREATE TABLE ndf_file(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_file(
                                             id INTEGER PRIMARY KEY AUTOINCREMENT,
                                             vfs_path TEXT,
                                             dat_path TEXT,
@@ -24,7 +199,7 @@ bool NDF_DB::init_statements() {
                                             is_current BOOLEAN
                                             ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_object(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_object(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           ndf_id INTEGER NOT NULL,
                                           object_name TEXT,
@@ -34,7 +209,7 @@ bool NDF_DB::init_statements() {
                                           FOREIGN KEY (ndf_id) REFERENCES ndf_file(id) ON UPDATE CASCADE ON DELETE CASCADE
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_property(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_property(
                                             id INTEGER PRIMARY KEY AUTOINCREMENT,
                                             object_id INTEGER NOT NULL REFERENCES ndf_object(id) ON UPDATE CASCADE ON DELETE CASCADE,
                                             property_name TEXT,
@@ -47,74 +222,74 @@ bool NDF_DB::init_statements() {
                                             ); )rstr");
 
   create_table(db,
-               R"rstr( CREATE TABLE ndf_bool(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_bool(
                                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                           value BOOLEAN
                                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_int8(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_int8(
                                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                           value INTEGER
                                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_uint8(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_uint8(
                                                            id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                            value INTEGER
                                                            ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_int16(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_int16(
                                                            id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                            value INTEGER
                                                            ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_uint16(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_uint16(
                                    id INTEGER PRIMARY KEY AUTOINCREMENT,
                                    value INTEGER
                                    ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_int32(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_int32(
                                                            id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                            value INTEGER
                                                            ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_uint32(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_uint32(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value INTEGER
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_float32(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_float32(
                                            id INTEGER PRIMARY KEY AUTOINCREMENT,
                                            value REAL
                                            ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_float64(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_float64(
                                            id INTEGER PRIMARY KEY AUTOINCREMENT,
                                            value REAL
                                            ); )rstr");
-  create_table(db, R"rstr( CREATE TABLE ndf_string(
+  create_table(db, R"rstr( CREATE TABLE IF NOT EXISTS ndf_string(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value TEXT
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_widestring(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_widestring(
                                               id INTEGER PRIMARY KEY AUTOINCREMENT,
                                               value TEXT
                                               ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_F32_vec2(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_F32_vec2(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value_x REAL,
                                           value_y REAL
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_F32_vec3(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_F32_vec3(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value_x REAL,
                                           value_y REAL,
                                           value_z REAL
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_F32_vec4(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_F32_vec4(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value_x REAL,
                                           value_y REAL,
@@ -122,20 +297,20 @@ bool NDF_DB::init_statements() {
                                           value_w REAL
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_S32_vec2(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_S32_vec2(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value_x INTEGER,
                                           value_y INTEGER
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_S32_vec3(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_S32_vec3(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value_x INTEGER,
                                           value_y INTEGER,
                                           value_z INTEGER
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_S32_vec4(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_S32_vec4(
                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                           value_x INTEGER,
                                           value_y INTEGER,
@@ -143,7 +318,7 @@ bool NDF_DB::init_statements() {
                                           value_w INTEGER
                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_color(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_color(
                                                            id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                            value_r INTEGER,
                                                            value_g INTEGER,
@@ -151,37 +326,41 @@ bool NDF_DB::init_statements() {
                                                            value_a INTEGER
                                                            ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_object_reference(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_object_reference(
                                          id INTEGER PRIMARY KEY AUTOINCREMENT,
                                          referenced_object INTEGER REFERENCES ndf_object(id) ON UPDATE CASCADE ON DELETE SET NULL,
                                          optional_value TEXT
                                          ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_import_reference(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_import_reference(
                                                     id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                     referenced_object INTEGER REFERENCES ndf_object(id) ON UPDATE CASCADE ON DELETE SET NULL,
                                                     optional_value TEXT
                                                     ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_GUID(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_GUID(
                                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                           value TEXT
                                                           ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_path_reference(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_path_reference(
                                                   id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                   value TEXT
                                                   ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_localisation_hash(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_localisation_hash(
                                                      id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                      value TEXT
                                                      ); )rstr");
   create_table(db,
-               R"rstr( CREATE TABLE ndf_hash(
+               R"rstr( CREATE TABLE IF NOT EXISTS ndf_hash(
                                                           id INTEGER PRIMARY KEY AUTOINCREMENT,
                                                           value TEXT
                                                           ); )rstr");
+  if (!migrate_schema()) {
+    return false;
+  }
+
   // inserters
   stmt_insert_ndf_file.init(
       db,
@@ -243,6 +422,8 @@ bool NDF_DB::init_statements() {
       R"rstr( INSERT INTO ndf_import_reference (referenced_object, optional_value) VALUES (?,?); )rstr");
   stmt_insert_ndf_GUID.init(
       db, R"rstr( INSERT INTO ndf_GUID (value) VALUES (?); )rstr");
+  stmt_insert_ndf_path_reference.init(
+      db, R"rstr( INSERT INTO ndf_path_reference (value) VALUES (?); )rstr");
   stmt_insert_ndf_localisation_hash.init(
       db, R"rstr( INSERT INTO ndf_localisation_hash (value) VALUES (?); )rstr");
   stmt_insert_ndf_hash.init(
@@ -269,14 +450,18 @@ bool NDF_DB::init_statements() {
       R"rstr( SELECT ndf_id, object_name, class_name, export_path, is_top_object FROM ndf_object WHERE id=?; )rstr");
   stmt_get_object_properties.init(
       db,
-      R"rstr( SELECT id FROM ndf_property WHERE object_id=? AND property_index<>-1; )rstr");
+      R"rstr( SELECT id FROM ndf_property WHERE object_id=? AND property_index<>-1 ORDER BY id; )rstr");
   stmt_get_property_names.init(
       db,
-      R"rstr( SELECT property_name FROM ndf_property WHERE object_id=? AND property_index<>-1; )rstr");
+      R"rstr( SELECT property_name FROM ndf_property WHERE object_id=? AND property_index<>-1 ORDER BY id; )rstr");
 
   stmt_get_property.init(
       db,
       R"rstr( SELECT object_id, property_name, property_index, parent, position, type, is_import_reference, value FROM ndf_property WHERE id=?; )rstr");
+  stmt_get_object_property_rows.init(
+      db,
+      R"rstr( SELECT id, property_name, property_index, parent, position, type, is_import_reference FROM ndf_property WHERE object_id=? ORDER BY id; )rstr");
+  stmt_get_object_values.init(db, get_object_values_query().c_str());
 
   // value accessors
   stmt_get_bool_value.init(
@@ -340,10 +525,10 @@ bool NDF_DB::init_statements() {
       R"rstr( SELECT id FROM ndf_property WHERE parent=? ORDER BY position; )rstr");
   stmt_get_objects_referencing.init(
       db,
-      R"rstr( SELECT DISTINCT prop.object_id FROM ndf_object_reference AS ref INNER JOIN ndf_property AS prop ON prop.value_id=ref.id WHERE ref.referenced_object=?; )rstr");
+      R"rstr( SELECT DISTINCT prop.object_id FROM ndf_object_reference AS ref INNER JOIN ndf_property AS prop ON prop.value=ref.id AND prop.type=9 AND prop.is_import_reference=0 WHERE ref.referenced_object=?; )rstr");
   stmt_get_objects_importing.init(
       db,
-      R"rstr( SELECT DISTINCT prop.object_id FROM ndf_import_reference AS ref INNER JOIN ndf_property AS prop ON prop.value_id=ref.id WHERE ref.referenced_object=?; )rstr");
+      R"rstr( SELECT DISTINCT prop.object_id FROM ndf_import_reference AS ref INNER JOIN ndf_property AS prop ON prop.value=ref.id AND prop.type=9 AND prop.is_import_reference=1 WHERE ref.referenced_object=?; )rstr");
 
   // change values
   stmt_set_bool_value.init(
@@ -429,6 +614,11 @@ bool NDF_DB::init_statements() {
   stmt_delete_ndf_file.init(db,
                             R"rstr( DELETE FROM ndf_file WHERE id=?; )rstr");
 
+  // transactions
+  stmt_begin_transaction.init(db, R"rstr( BEGIN TRANSACTION; )rstr");
+  stmt_commit_transaction.init(db, R"rstr( COMMIT TRANSACTION; )rstr");
+  stmt_rollback_transaction.init(db, R"rstr( ROLLBACK TRANSACTION; )rstr");
+
   return true;
 }
 
@@ -475,11 +665,90 @@ std::optional<int> NDF_DB::insert_object(int ndf_idx, const NDFObject &object) {
   }
 
   for (auto &prop : object.properties) {
-    insert_property(*prop, *object_id);
+    if (!insert_property(*prop, *object_id)) {
+      return std::nullopt;
+    }
   }
   return object_id;
 }
 
+std::optional<NDFIngestStats>
+NDF_DB::insert_ndf(int ndf_id, const NDF &ndf,
+                   const NDFIngestOptions &options) {
+  if (ndf.has_lazy_objects()) {
+    spdlog::error("insert_ndf: call load_lazy_objects on lazy loaded NDFs");
+    return std::nullopt;
+  }
+  std::optional<std::string> old_journal_mode;
+  std::optional<int64_t> old_synchronous;
+  if (options.fast_journal) {
+    old_journal_mode =
+        query_single_value<std::string>(db, "PRAGMA journal_mode;");
+    old_synchronous = query_single_value<int64_t>(db, "PRAGMA synchronous;");
+    auto journal_mode =
+        query_single_value<std::string>(db, "PRAGMA journal_mode=WAL;");
+    if (!journal_mode || !execute_single(db, "PRAGMA synchronous=NORMAL;")) {
+      spdlog::warn("Couldn't switch to the WAL journal, using the current one");
+    } else {
+      spdlog::debug("journal_mode {} while ingesting", journal_mode.value());
+    }
+  }
+  // the journal modes can't be changed inside of the transaction
+  auto restore_journal = [&]() {
+    if (old_journal_mode) {
+      auto query =
+          std::format("PRAGMA journal_mode={};", old_journal_mode.value());
+      query_single_value<std::string>(db, query.c_str());
+    }
+    if (old_synchronous) {
+      auto query = std::format("PRAGMA synchronous={};", old_synchronous.value());
+      execute_single(db, query.c_str());
+    }
+  };
+
+  NDFIngestStats stats;
+  auto start = std::chrono::steady_clock::now();
+  int64_t changes = sqlite3_total_changes64(db);
+  if (!stmt_begin_transaction.execute()) {
+    restore_journal();
+    return std::nullopt;
+  }
+
+  bool success = !options.defer_indices || drop_bulk_indices();
+  for (const auto &[_, object] : ndf.object_map) {
+    if (!success) {
+      break;
+    }
+    if (!insert_object(ndf_id, object)) {
+      spdlog::error("Couldn't add object {}", object.name);
+      success = false;
+      break;
+    }
+    stats.objects++;
+  }
+  // fix_references uses the indices of the reference tables
+  if (success && options.defer_indices) {
+    success = create_bulk_indices();
+  }
+  if (success && options.fix_references) {
+    success = fix_references(ndf_id);
+  }
+  if (!success || !stmt_commit_transaction.execute()) {
+    spdlog::error("Ingesting ndf file {} failed, rolling back", ndf_id);
+    stmt_rollback_transaction.execute();
+    restore_journal();
+    return std::nullopt;
+  }
+
+  stats.rows = sqlite3_total_changes64(db) - changes;
+  stats.duration = std::chrono::steady_clock::now() - start;
+  restore_journal();
+  spdlog::info("Ingested {} objects ({} rows) in {:.3f} s, {:.0f} rows/s",
+               stats.objects, stats.rows, stats.duration.count(),
+               stats.rows_per_second());
+  return stats;
+}
+
 bool NDF_DB::insert_property(const NDFProperty &property, int object_id,
                              int parent, int position) {
   return property.to_ndf_db(this, object_id, parent, position);
@@ -499,24 +768,88 @@ std::optional<NDFObject> NDF_DB::get_object(int object_idx) {
   ret.export_path = export_path;
   ret.is_top_object = is_top_object;
 
-  // get list of all properties in this object (only direct properties, not list
-  // items etc.)
-  auto prop_ids_opt = stmt_get_object_properties.query<int>(object_idx);
-  if (!prop_ids_opt) {
+  // all properties of the object in two queries instead of a few per
+  // property: the property rows, then the values of all scalar properties.
+  // parent is NULL (read as 0) for the properties of the object itself
+  auto rows_opt = stmt_get_object_property_rows.query<
+      std::tuple<int, std::string, int, int, int, uint32_t, bool>>(object_idx);
+  if (!rows_opt) {
     return std::nullopt;
   }
-  for (auto prop_id : prop_ids_opt.value()) {
-    auto prop_opt = get_property(prop_id);
-    if (prop_opt) {
-      ret.properties.push_back(std::move(prop_opt.value()));
+  std::unordered_map<int, NDFProperty *> properties;
+  std::vector<NDFPropertyPtr> top_properties;
+  // items of lists, maps and pairs by parent id, with their position
+  std::unordered_map<int, std::vector<std::pair<int, NDFPropertyPtr>>> items;
+  for (auto &[id, name, index, parent, position, type, is_import_reference] :
+       rows_opt.value()) {
+    auto property =
+        NDFProperty::get_property_from_ndf_db(type, is_import_reference);
+    property->property_name = name;
+    property->property_idx = index;
+    properties.insert({id, property.get()});
+    if (parent == 0) {
+      top_properties.push_back(std::move(property));
     } else {
+      items[parent].emplace_back(position, std::move(property));
+    }
+  }
+
+  auto values_opt = stmt_get_object_values.query<
+      std::tuple<int, double, double, double, double, std::string>>(
+      object_idx);
+  if (!values_opt) {
+    return std::nullopt;
+  }
+  NDFDBValue value;
+  std::unordered_set<int> valued;
+  for (auto &[id, n0, n1, n2, n3, text] : values_opt.value()) {
+    value.property_id = id;
+    value.numbers = {n0, n1, n2, n3};
+    value.text = std::move(text);
+    auto it = properties.find(id);
+    if (it == properties.end() || !it->second->from_ndf_db_value(value)) {
+      spdlog::error("Could not set value of property {}", id);
+      return std::nullopt;
+    }
+    valued.insert(id);
+  }
+  // a scalar without value row or a pair without items would be returned
+  // half initialized, lists and maps may be empty
+  for (const auto &[id, property] : properties) {
+    if (property->is_list() || property->is_map()) {
+      continue;
+    }
+    if (property->is_pair() ? !items.contains(id) : !valued.contains(id)) {
+      spdlog::error("Property {} of object {} has no value", id, object_idx);
       return std::nullopt;
     }
   }
+
+  for (auto &[parent, parent_items] : items) {
+    auto it = properties.find(parent);
+    if (it == properties.end()) {
+      spdlog::error("Parent property {} not found", parent);
+      return std::nullopt;
+    }
+    std::ranges::sort(parent_items, {}, &std::pair<int, NDFPropertyPtr>::first);
+    std::vector<NDFPropertyPtr> sorted_items;
+    sorted_items.reserve(parent_items.size());
+    for (auto &item : parent_items) {
+      sorted_items.push_back(std::move(item.second));
+    }
+    if (!it->second->set_ndf_db_items(std::move(sorted_items))) {
+      spdlog::error("Could not set items of property {}", parent);
+      return std::nullopt;
+    }
+  }
+
+  for (auto &property : top_properties) {
+    ret.add_property(std::move(property));
+  }
   return ret;
 }
 
-std::optional<std::unique_ptr<NDFProperty>>
+std::optional<NDFPropertyPtr>
 NDF_DB::get_property(int property_id) {
   // get property type
   auto property = NDFProperty::get_db_property_type(this, property_id);
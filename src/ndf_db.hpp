@@ -3,12 +3,46 @@
 #include "ndf_properties.hpp"
 #include "sqlite3.h"
 #include "sqlite_helpers.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <filesystem>
 
 #include "ndf.hpp"
 
 namespace fs = std::filesystem;
 
+// value columns of a scalar property as fetched by NDF_DB::get_object, numbers
+// holds the integer and real columns, text the text column or the name of a
+// referenced object
+struct NDFDBValue {
+  int property_id = 0;
+  std::array<double, 4> numbers{};
+  std::string text;
+};
+
+struct NDFIngestOptions {
+  // use journal_mode=WAL and synchronous=NORMAL while ingesting, the previous
+  // modes get restored afterwards
+  bool fast_journal = false;
+  // resolve the object and import references inside the same transaction
+  bool fix_references = true;
+  // drop the bulk indices while inserting and rebuild them at the end, faster
+  // when the file makes up a large part of the database
+  bool defer_indices = false;
+};
+
+struct NDFIngestStats {
+  size_t objects = 0;
+  // rows inserted or updated in all tables
+  int64_t rows = 0;
+  std::chrono::duration<double> duration{};
+
+  double rows_per_second() const {
+    return rows / std::max(duration.count(), 1e-9);
+  }
+};
+
 class NDF_DB {
 private:
   sqlite3 *db;
@@ -52,6 +86,9 @@ private:
   SQLStatement<1, 1> stmt_get_object_properties;
   SQLStatement<1, 1> stmt_get_property_names;
   SQLStatement<1, 8> stmt_get_property;
+  // all properties of an object including list items etc., and their values
+  SQLStatement<1, 7> stmt_get_object_property_rows;
+  SQLStatement<1, 6> stmt_get_object_values;
   // accessors for values, should only return a single row each
   SQLStatement<1, 1> stmt_get_bool_value;
   SQLStatement<1, 1> stmt_get_int8_value;
@@ -116,8 +153,13 @@ private:
   SQLStatement<0, 0> stmt_update_import_references;
   // delete statements
   SQLStatement<0, 0> stmt_delete_ndf_file;
+  // transaction statements
+  SQLStatement<0, 0> stmt_begin_transaction;
+  SQLStatement<0, 0> stmt_commit_transaction;
+  SQLStatement<0, 0> stmt_rollback_transaction;
 
   bool init_statements();
+  bool migrate_schema();
 
   friend struct NDFProperty;
   friend struct NDFPropertyBool;
@@ -152,16 +194,28 @@ public:
   bool init(fs::path path);
   ~NDF_DB();
 
+  // PRAGMA user_version, bumped by every schema migration
+  std::optional<int> get_schema_version();
+  // indices on ndf_property and the reference tables, which are not needed
+  // while inserting. when loading many files, drop them first and create them
+  // again afterwards
+  bool drop_bulk_indices();
+  bool create_bulk_indices();
+
   std::optional<int> insert_file(std::string vfs_path, std::string dat_path,
                                  std::string fs_path, std::string version,
                                  bool is_current = true);
   std::optional<int> insert_object(int ndf_idx, const NDFObject &object);
+  // inserts all objects of ndf into the file ndf_id in a single transaction,
+  // nothing is inserted if any of them fails
+  std::optional<NDFIngestStats>
+  insert_ndf(int ndf_id, const NDF &ndf, const NDFIngestOptions &options = {});
   bool insert_property(const NDFProperty &property, int object_idx,
                        int parent = -1, int position = -1);
 
   std::optional<NDFObject> get_object(int object_idx);
   // std::optional<std::vector<NDFObject>> get_objects(int ndf_idx);
-  std::optional<std::unique_ptr<NDFProperty>> get_property(int property_idx);
+  std::optional<NDFPropertyPtr> get_property(int property_idx);
 
   bool change_object_name(int object_idx, std::string new_name);
   bool change_export_path(int object_idx, std::string new_path);
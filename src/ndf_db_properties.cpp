@@ -4,7 +4,7 @@
 
 #include "sqlite_helpers.hpp"
 
-std::unique_ptr<NDFProperty>
+NDFPropertyPtr
 NDFProperty::get_property_from_ndf_db(uint32_t ndf_type,
                                       bool is_import_reference) {
   if (ndf_type == 0x9) {
@@ -17,7 +17,7 @@ NDFProperty::get_property_from_ndf_db(uint32_t ndf_type,
   return get_property_from_ndftype(ndf_type);
 }
 
-std::unique_ptr<NDFProperty>
+NDFPropertyPtr
 NDFProperty::get_db_property_type(NDF_DB *db, int prop_id, int pos) {
   auto prop_opt = db->stmt_get_property.query_single<
       std::tuple<int, std::string, int, int, int, uint32_t, bool, int>>(
@@ -55,25 +55,27 @@ NDFProperty::add_db_property(NDF_DB *db, int object_id, int parent,
                              int position, int value_id,
                              bool is_import_reference) const {
   std::optional<int> prop_id;
+  // stored signed, so that items without a PROP index end up as -1
+  int32_t db_property_idx = static_cast<int32_t>(property_idx);
   if (parent == -1) {
     if (value_id == -1) {
       prop_id = db->stmt_insert_ndf_property.insert(
-          object_id, property_name, property_idx, SQLNULL{}, SQLNULL{},
+          object_id, property_name.str(), db_property_idx, SQLNULL{}, SQLNULL{},
           property_type, is_import_reference, SQLNULL{});
     } else {
 
       prop_id = db->stmt_insert_ndf_property.insert(
-          object_id, property_name, property_idx, SQLNULL{}, SQLNULL{},
+          object_id, property_name.str(), db_property_idx, SQLNULL{}, SQLNULL{},
           property_type, is_import_reference, value_id);
     }
   } else {
     if (value_id == -1) {
       prop_id = db->stmt_insert_ndf_property.insert(
-          object_id, property_name, property_idx, parent, position,
+          object_id, property_name.str(), db_property_idx, parent, position,
           property_type, is_import_reference, SQLNULL{});
     } else {
       prop_id = db->stmt_insert_ndf_property.insert(
-          object_id, property_name, property_idx, parent, position,
+          object_id, property_name.str(), db_property_idx, parent, position,
           property_type, is_import_reference, value_id);
     }
   }
@@ -91,12 +93,17 @@ bool NDFPropertyBool::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyBool::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0] != 0;
+  return true;
+}
+
 bool NDFPropertyBool::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                 int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_bool.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -120,12 +127,17 @@ bool NDFPropertyUInt8::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyUInt8::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyUInt8::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                  int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_uint8.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -149,12 +161,17 @@ bool NDFPropertyUInt16::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyUInt16::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyUInt16::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                   int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_uint16.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
 
   return add_db_property(db, object_id, parent, position, value_id.value())
@@ -179,12 +196,17 @@ bool NDFPropertyInt16::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyInt16::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyInt16::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                  int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_int16.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -208,12 +230,17 @@ bool NDFPropertyUInt32::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyUInt32::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyUInt32::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                   int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_uint32.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -237,12 +264,17 @@ bool NDFPropertyInt32::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyInt32::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyInt32::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                  int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_int32.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -266,12 +298,17 @@ bool NDFPropertyFloat32::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyFloat32::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyFloat32::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                    int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_float32.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -295,12 +332,17 @@ bool NDFPropertyFloat64::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyFloat64::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.numbers[0];
+  return true;
+}
+
 bool NDFPropertyFloat64::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                    int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_float64.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -325,12 +367,17 @@ bool NDFPropertyString::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyString::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.text;
+  return true;
+}
+
 bool NDFPropertyString::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                   int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_string.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -355,12 +402,17 @@ bool NDFPropertyWideString::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyWideString::from_ndf_db_value(const NDFDBValue &row) {
+  value = row.text;
+  return true;
+}
+
 bool NDFPropertyWideString::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                       int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_widestring.insert(this->value);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -387,12 +439,18 @@ bool NDFPropertyF32_vec2::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyF32_vec2::from_ndf_db_value(const NDFDBValue &row) {
+  x = row.numbers[0];
+  y = row.numbers[1];
+  return true;
+}
+
 bool NDFPropertyF32_vec2::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                     int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_F32_vec2.insert(this->x, this->y);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -422,13 +480,20 @@ bool NDFPropertyF32_vec3::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyF32_vec3::from_ndf_db_value(const NDFDBValue &row) {
+  x = row.numbers[0];
+  y = row.numbers[1];
+  z = row.numbers[2];
+  return true;
+}
+
 bool NDFPropertyF32_vec3::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                     int position) const {
   // insert the value in the bool table
   auto value_id =
       db->stmt_insert_ndf_F32_vec3.insert(this->x, this->y, this->z);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -461,13 +526,21 @@ bool NDFPropertyF32_vec4::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyF32_vec4::from_ndf_db_value(const NDFDBValue &row) {
+  x = row.numbers[0];
+  y = row.numbers[1];
+  z = row.numbers[2];
+  w = row.numbers[3];
+  return true;
+}
+
 bool NDFPropertyF32_vec4::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                     int position) const {
   // insert the value in the bool table
   auto value_id =
       db->stmt_insert_ndf_F32_vec4.insert(this->x, this->y, this->z, this->w);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -501,13 +574,21 @@ bool NDFPropertyColor::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyColor::from_ndf_db_value(const NDFDBValue &row) {
+  r = row.numbers[0];
+  g = row.numbers[1];
+  b = row.numbers[2];
+  a = row.numbers[3];
+  return true;
+}
+
 bool NDFPropertyColor::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                  int position) const {
   // insert the value in the bool table
   auto value_id =
       db->stmt_insert_ndf_color.insert(this->r, this->g, this->b, this->a);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -538,12 +619,18 @@ bool NDFPropertyS32_vec2::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyS32_vec2::from_ndf_db_value(const NDFDBValue &row) {
+  x = row.numbers[0];
+  y = row.numbers[1];
+  return true;
+}
+
 bool NDFPropertyS32_vec2::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                     int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_S32_vec2.insert(this->x, this->y);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -564,13 +651,20 @@ bool NDFPropertyS32_vec3::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyS32_vec3::from_ndf_db_value(const NDFDBValue &row) {
+  x = row.numbers[0];
+  y = row.numbers[1];
+  z = row.numbers[2];
+  return true;
+}
+
 bool NDFPropertyS32_vec3::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                     int position) const {
   // insert the value in the bool table
   auto value_id =
       db->stmt_insert_ndf_S32_vec3.insert(this->x, this->y, this->z);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -602,6 +696,12 @@ bool NDFPropertyImportReference::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyImportReference::from_ndf_db_value(const NDFDBValue &row) {
+  // the query already resolved the export path of the referenced object
+  import_name = row.text;
+  return true;
+}
+
 bool NDFPropertyImportReference::to_ndf_db(NDF_DB *db, int object_id,
                                            int parent, int position) const {
   // first try to find the object
@@ -666,6 +766,12 @@ bool NDFPropertyObjectReference::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyObjectReference::from_ndf_db_value(const NDFDBValue &row) {
+  // the query already resolved the name of the referenced object
+  object_name = row.text;
+  return true;
+}
+
 bool NDFPropertyObjectReference::to_ndf_db(NDF_DB *db, int object_id,
                                            int parent, int position) const {
   // first get the object_id from the object_name
@@ -712,11 +818,16 @@ bool NDFPropertyGUID::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyGUID::from_ndf_db_value(const NDFDBValue &row) {
+  guid = row.text;
+  return true;
+}
+
 bool NDFPropertyGUID::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                 int position) const {
   auto value_id = db->stmt_insert_ndf_GUID.insert(guid);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -741,12 +852,17 @@ bool NDFPropertyPathReference::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyPathReference::from_ndf_db_value(const NDFDBValue &row) {
+  path = row.text;
+  return true;
+}
+
 bool NDFPropertyPathReference::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                          int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_path_reference.insert(path);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -771,12 +887,17 @@ bool NDFPropertyLocalisationHash::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyLocalisationHash::from_ndf_db_value(const NDFDBValue &row) {
+  hash = row.text;
+  return true;
+}
+
 bool NDFPropertyLocalisationHash::to_ndf_db(NDF_DB *db, int object_id,
                                             int parent, int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_localisation_hash.insert(hash);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -801,12 +922,17 @@ bool NDFPropertyHash::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyHash::from_ndf_db_value(const NDFDBValue &row) {
+  hash = row.text;
+  return true;
+}
+
 bool NDFPropertyHash::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                 int position) const {
   // insert the value in the bool table
   auto value_id = db->stmt_insert_ndf_hash.insert(hash);
   if (!value_id) {
-    return -1;
+    return false;
   }
   return add_db_property(db, object_id, parent, position, value_id.value())
       .has_value();
@@ -820,22 +946,33 @@ bool NDFPropertyHash::change_value(NDF_DB *db, int property_id,
 }
 
 bool NDFPropertyList::from_ndf_db(NDF_DB *db, int property_id) {
-  // first we need to get the id of the list property
-  auto value_id = get_db_property_value(db, property_id);
-  // now we get all the properties in us
-  auto value_opt = db->stmt_get_list_items.query<int>(value_id);
+  // containers have no value row, this only fills in name and index
+  get_db_property_value(db, property_id);
+  // now we get all the properties in us, their parent is our property id
+  auto value_opt = db->stmt_get_list_items.query<int>(property_id);
   if (!value_opt) {
     return false;
   }
   for (auto [pos, prop_id] : value_opt.value() | std::views::enumerate) {
     // now get the corresponding properties and initialize them
     auto prop = get_db_property_type(db, prop_id, pos);
+    if (!prop) {
+      return false;
+    }
     prop->from_ndf_db(db, prop_id);
     values.push_back(std::move(prop));
   }
   return true;
 }
 
+bool NDFPropertyList::set_ndf_db_items(std::vector<NDFPropertyPtr> items) {
+  values.clear();
+  for (auto &item : items) {
+    values.push_back(std::move(item));
+  }
+  return true;
+}
+
 bool NDFPropertyList::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                 int position) const {
   int pos = 0;
@@ -859,10 +996,10 @@ bool NDFPropertyList::to_ndf_db(NDF_DB *db, int object_id, int parent,
 }
 
 bool NDFPropertyMap::from_ndf_db(NDF_DB *db, int property_id) {
-  // first we need to get the id of the map property
-  auto value_id = get_db_property_value(db, property_id);
-  // now we get all the properties in us
-  auto value_opt = db->stmt_get_list_items.query<int>(value_id);
+  // containers have no value row, this only fills in name and index
+  get_db_property_value(db, property_id);
+  // now we get all the properties in us, their parent is our property id
+  auto value_opt = db->stmt_get_list_items.query<int>(property_id);
   if (!value_opt) {
     return false;
   }
@@ -874,7 +1011,6 @@ bool NDFPropertyMap::from_ndf_db(NDF_DB *db, int property_id) {
     // handle key property
     auto key_prop = get_db_property_type(db, key_prop_id, pos++);
     key_prop->from_ndf_db(db, key_prop_id);
-    pos += 1;
     prop_it++;
     if (prop_it == value.end()) {
       spdlog::error("No value property after key property! @{}", pos);
@@ -885,7 +1021,6 @@ bool NDFPropertyMap::from_ndf_db(NDF_DB *db, int property_id) {
     // now get the corresponding properties and initialize them
     auto value_prop = get_db_property_type(db, value_prop_id, pos++);
     value_prop->from_ndf_db(db, value_prop_id);
-    pos += 1;
     prop_it++;
 
     values.push_back({std::move(key_prop), std::move(value_prop)});
@@ -893,6 +1028,18 @@ bool NDFPropertyMap::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyMap::set_ndf_db_items(std::vector<NDFPropertyPtr> items) {
+  if (items.size() % 2 != 0) {
+    spdlog::error("Map with {} items, expected key value pairs", items.size());
+    return false;
+  }
+  values.clear();
+  for (size_t i = 0; i < items.size(); i += 2) {
+    values.push_back({std::move(items[i]), std::move(items[i + 1])});
+  }
+  return true;
+}
+
 bool NDFPropertyMap::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                int position) const {
   int pos = 0;
@@ -922,16 +1069,20 @@ bool NDFPropertyMap::to_ndf_db(NDF_DB *db, int object_id, int parent,
 }
 
 bool NDFPropertyPair::from_ndf_db(NDF_DB *db, int property_id) {
-  // first we need to get the id of the map property
-  auto value_id = get_db_property_value(db, property_id);
-  // now we get all the properties in us
-  auto value_opt = db->stmt_get_list_items.query<int>(value_id);
+  // containers have no value row, this only fills in name and index
+  get_db_property_value(db, property_id);
+  // now we get all the properties in us, their parent is our property id
+  auto value_opt = db->stmt_get_list_items.query<int>(property_id);
   if (!value_opt) {
     return false;
   }
   int pos = 0;
   auto &value = value_opt.value();
   auto prop_it = value.begin();
+  if (prop_it == value.end()) {
+    spdlog::error("Pair without first property!");
+    return false;
+  }
   auto key_prop_id = *prop_it;
   // handle key property
   auto key_prop = get_db_property_type(db, key_prop_id, pos++);
@@ -941,7 +1092,6 @@ bool NDFPropertyPair::from_ndf_db(NDF_DB *db, int property_id) {
   }
   key_prop->from_ndf_db(db, key_prop_id);
   first = std::move(key_prop);
-  pos += 1;
   prop_it++;
   if (prop_it == value.end()) {
     spdlog::error("No second property after first property!");
@@ -961,6 +1111,16 @@ bool NDFPropertyPair::from_ndf_db(NDF_DB *db, int property_id) {
   return true;
 }
 
+bool NDFPropertyPair::set_ndf_db_items(std::vector<NDFPropertyPtr> items) {
+  if (items.size() != 2) {
+    spdlog::error("Pair with {} items, expected 2", items.size());
+    return false;
+  }
+  first = std::move(items[0]);
+  second = std::move(items[1]);
+  return true;
+}
+
 bool NDFPropertyPair::to_ndf_db(NDF_DB *db, int object_id, int parent,
                                 int position) const {
   int pos = 0;
@@ -0,0 +1,598 @@
+#include "ndf_diff.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+template <typename T>
+static const T &as_property(const NDFProperty &property) {
+  return static_cast<const T &>(property);
+}
+
+// item_hash gives the hashes of the items of lists, maps (key, value) and
+// pairs (first, second), in that order
+template <typename ItemHash>
+static uint64_t property_hash(const NDFProperty &property,
+                              ItemHash &&item_hash) {
+  NDFHasher hasher;
+  hasher.add(property.property_type);
+  switch (property.property_type) {
+  case NDFPropertyType::Bool:
+    hasher.add(as_property<NDFPropertyBool>(property).value);
+    break;
+  case NDFPropertyType::UInt8:
+    hasher.add(as_property<NDFPropertyUInt8>(property).value);
+    break;
+  case NDFPropertyType::Int16:
+    hasher.add(as_property<NDFPropertyInt16>(property).value);
+    break;
+  case NDFPropertyType::UInt16:
+    hasher.add(as_property<NDFPropertyUInt16>(property).value);
+    break;
+  case NDFPropertyType::Int32:
+    hasher.add(as_property<NDFPropertyInt32>(property).value);
+    break;
+  case NDFPropertyType::UInt32:
+    hasher.add(as_property<NDFPropertyUInt32>(property).value);
+    break;
+  case NDFPropertyType::Float32:
+    hasher.add(as_property<NDFPropertyFloat32>(property).value);
+    break;
+  case NDFPropertyType::Float64:
+    hasher.add(as_property<NDFPropertyFloat64>(property).value);
+    break;
+  case NDFPropertyType::String:
+    hasher.add(
+        std::string_view(as_property<NDFPropertyString>(property).value));
+    break;
+  case NDFPropertyType::WideString:
+    hasher.add(
+        std::string_view(as_property<NDFPropertyWideString>(property).value));
+    break;
+  case NDFPropertyType::PathReference:
+    hasher.add(std::string_view(
+        as_property<NDFPropertyPathReference>(property).path));
+    break;
+  case NDFPropertyType::F32_vec2: {
+    const auto &vec = as_property<NDFPropertyF32_vec2>(property);
+    hasher.add(vec.x);
+    hasher.add(vec.y);
+    break;
+  }
+  case NDFPropertyType::F32_vec3: {
+    const auto &vec = as_property<NDFPropertyF32_vec3>(property);
+    hasher.add(vec.x);
+    hasher.add(vec.y);
+    hasher.add(vec.z);
+    break;
+  }
+  case NDFPropertyType::F32_vec4: {
+    const auto &vec = as_property<NDFPropertyF32_vec4>(property);
+    hasher.add(vec.x);
+    hasher.add(vec.y);
+    hasher.add(vec.z);
+    hasher.add(vec.w);
+    break;
+  }
+  case NDFPropertyType::S32_vec2: {
+    const auto &vec = as_property<NDFPropertyS32_vec2>(property);
+    hasher.add(vec.x);
+    hasher.add(vec.y);
+    break;
+  }
+  case NDFPropertyType::S32_vec3: {
+    const auto &vec = as_property<NDFPropertyS32_vec3>(property);
+    hasher.add(vec.x);
+    hasher.add(vec.y);
+    hasher.add(vec.z);
+    break;
+  }
+  case NDFPropertyType::Color: {
+    const auto &color = as_property<NDFPropertyColor>(property);
+    hasher.add(color.b);
+    hasher.add(color.g);
+    hasher.add(color.r);
+    hasher.add(color.a);
+    break;
+  }
+  case NDFPropertyType::NDFGUID:
+    hasher.add(std::string_view(as_property<NDFPropertyGUID>(property).guid));
+    break;
+  case NDFPropertyType::LocalisationHash:
+    hasher.add(std::string_view(
+        as_property<NDFPropertyLocalisationHash>(property).hash));
+    break;
+  case NDFPropertyType::Hash:
+    hasher.add(std::string_view(as_property<NDFPropertyHash>(property).hash));
+    break;
+  case NDFPropertyType::ObjectReference:
+    // both references are type 9, the reference type tells them apart
+    if (const auto *reference =
+            dynamic_cast<const NDFPropertyObjectReference *>(&property)) {
+      hasher.add<uint32_t>(ReferenceType::Object);
+      hasher.add(std::string_view(reference->object_name));
+    } else {
+      hasher.add<uint32_t>(ReferenceType::Import);
+      hasher.add(std::string_view(
+          as_property<NDFPropertyImportReference>(property).import_name));
+    }
+    break;
+  case NDFPropertyType::List: {
+    const auto &list = as_property<NDFPropertyList>(property);
+    hasher.add<uint64_t>(list.values.size());
+    for (const auto &item : list.values) {
+      hasher.add(item_hash(*item));
+    }
+    break;
+  }
+  case NDFPropertyType::Map: {
+    const auto &map = as_property<NDFPropertyMap>(property);
+    hasher.add<uint64_t>(map.values.size());
+    for (const auto &[key, value] : map.values) {
+      hasher.add(item_hash(*key));
+      hasher.add(item_hash(*value));
+    }
+    break;
+  }
+  case NDFPropertyType::Pair: {
+    const auto &pair = as_property<NDFPropertyPair>(property);
+    hasher.add(item_hash(*pair.first));
+    hasher.add(item_hash(*pair.second));
+    break;
+  }
+  default:
+    throw std::runtime_error(
+        std::format("Unknown NDFType: {}", property.property_type));
+  }
+  return hasher.digest();
+}
+
+uint64_t ndf_property_hash(const NDFProperty &property) {
+  return property_hash(property, [](const NDFProperty &item) {
+    return ndf_property_hash(item);
+  });
+}
+
+// the hash of a property and the hashes of everything below it, built bottom
+// up so descending into a changed property does not hash its items again
+struct NDFHashNode {
+  uint64_t hash;
+  // in the order property_hash visits the items
+  std::vector<NDFHashNode> items;
+};
+
+static NDFHashNode hash_node(const NDFProperty &property) {
+  NDFHashNode node;
+  node.hash = property_hash(property, [&node](const NDFProperty &item) {
+    return node.items.emplace_back(hash_node(item)).hash;
+  });
+  return node;
+}
+
+// property_hashes holds ndf_property_hash of every property of object
+static uint64_t object_hash(const NDFObject &object,
+                            const std::vector<uint64_t> &property_hashes) {
+  NDFHasher hasher;
+  hasher.add(std::string_view(object.class_name));
+  hasher.add(std::string_view(object.export_path));
+  hasher.add(object.is_top_object);
+  hasher.add<uint64_t>(object.properties.size());
+  for (size_t i = 0; i < object.properties.size(); i++) {
+    hasher.add(std::string_view(object.properties[i]->property_name));
+    hasher.add(property_hashes[i]);
+  }
+  return hasher.digest();
+}
+
+static std::vector<uint64_t> property_hashes(const NDFObject &object) {
+  std::vector<uint64_t> ret;
+  ret.reserve(object.properties.size());
+  for (const auto &property : object.properties) {
+    ret.push_back(ndf_property_hash(*property));
+  }
+  return ret;
+}
+
+uint64_t ndf_object_hash(const NDFObject &object) {
+  return object_hash(object, property_hashes(object));
+}
+
+std::string NDFPropertyChange::path_string() const {
+  std::string ret = property_name;
+  for (const auto &step : path) {
+    switch (step.kind) {
+    case NDFPropertyPathStep::ListItem:
+      ret += std::format("[{}]", step.index);
+      break;
+    case NDFPropertyPathStep::MapKey:
+      ret += std::format("[{}].Key", step.index);
+      break;
+    case NDFPropertyPathStep::MapValue:
+      ret += std::format("[{}].Value", step.index);
+      break;
+    case NDFPropertyPathStep::PairFirst:
+      ret += ".First";
+      break;
+    case NDFPropertyPathStep::PairSecond:
+      ret += ".Second";
+      break;
+    }
+  }
+  return ret;
+}
+
+// from_node and to_node hold the hashes of from and to
+static void diff_property(NDFProperty &from, const NDFHashNode &from_node,
+                          NDFProperty &to, const NDFHashNode &to_node,
+                          const std::string &name,
+                          std::vector<NDFPropertyPathStep> &path,
+                          std::vector<NDFPropertyChange> &changes);
+
+// descends into the item if it differs
+static void diff_item(NDFProperty &from, const NDFHashNode &from_node,
+                      NDFProperty &to, const NDFHashNode &to_node,
+                      NDFPropertyPathStep step, const std::string &name,
+                      std::vector<NDFPropertyPathStep> &path,
+                      std::vector<NDFPropertyChange> &changes) {
+  if (from_node.hash == to_node.hash) {
+    return;
+  }
+  path.push_back(step);
+  diff_property(from, from_node, to, to_node, name, path, changes);
+  path.pop_back();
+}
+
+// from and to differ, either in an item or as a whole
+static void diff_property(NDFProperty &from, const NDFHashNode &from_node,
+                          NDFProperty &to, const NDFHashNode &to_node,
+                          const std::string &name,
+                          std::vector<NDFPropertyPathStep> &path,
+                          std::vector<NDFPropertyChange> &changes) {
+  if (from.property_type == to.property_type) {
+    if (from.is_list()) {
+      auto &from_list = static_cast<NDFPropertyList &>(from);
+      auto &to_list = static_cast<NDFPropertyList &>(to);
+      if (from_list.values.size() == to_list.values.size()) {
+        for (uint32_t i = 0; i < to_list.values.size(); i++) {
+          diff_item(*from_list.values[i], from_node.items[i],
+                    *to_list.values[i], to_node.items[i],
+                    {NDFPropertyPathStep::ListItem, i}, name, path, changes);
+        }
+        return;
+      }
+    } else if (from.is_map()) {
+      auto &from_map = static_cast<NDFPropertyMap &>(from);
+      auto &to_map = static_cast<NDFPropertyMap &>(to);
+      if (from_map.values.size() == to_map.values.size()) {
+        for (uint32_t i = 0; i < to_map.values.size(); i++) {
+          // the items of a map are key, value, key, ...
+          diff_item(*from_map.values[i].first, from_node.items[2 * i],
+                    *to_map.values[i].first, to_node.items[2 * i],
+                    {NDFPropertyPathStep::MapKey, i}, name, path, changes);
+          diff_item(*from_map.values[i].second, from_node.items[2 * i + 1],
+                    *to_map.values[i].second, to_node.items[2 * i + 1],
+                    {NDFPropertyPathStep::MapValue, i}, name, path, changes);
+        }
+        return;
+      }
+    } else if (from.is_pair()) {
+      auto &from_pair = static_cast<NDFPropertyPair &>(from);
+      auto &to_pair = static_cast<NDFPropertyPair &>(to);
+      diff_item(*from_pair.first, from_node.items[0], *to_pair.first,
+                to_node.items[0], {NDFPropertyPathStep::PairFirst}, name, path,
+                changes);
+      diff_item(*from_pair.second, from_node.items[1], *to_pair.second,
+                to_node.items[1], {NDFPropertyPathStep::PairSecond}, name, path,
+                changes);
+      return;
+    }
+  }
+  changes.push_back({NDFPropertyChange::Changed, name, path, to.get_copy()});
+}
+
+// false if the objects do not differ
+static bool diff_object(NDFObject &from, NDFObject &to,
+                        NDFObjectChange &change) {
+  // every property is hashed once, the object hashes are built from these
+  auto from_hashes = property_hashes(from);
+  auto to_hashes = property_hashes(to);
+  if (object_hash(from, from_hashes) == object_hash(to, to_hashes)) {
+    return false;
+  }
+  change.name = to.name;
+  if (from.class_name != to.class_name ||
+      from.export_path != to.export_path ||
+      from.is_top_object != to.is_top_object) {
+    change.header_changed = true;
+    change.class_name = to.class_name;
+    change.export_path = to.export_path;
+    change.is_top_object = to.is_top_object;
+  }
+
+  // property_map is not kept up to date by everyone who adds properties,
+  // name -> index in properties
+  std::unordered_map<std::string_view, uint32_t> from_properties;
+  std::unordered_set<std::string_view> to_names;
+  for (uint32_t i = 0; i < from.properties.size(); i++) {
+    from_properties.emplace(from.properties[i]->property_name, i);
+  }
+  for (const auto &property : to.properties) {
+    to_names.insert(property->property_name);
+  }
+
+  // the properties both objects have, in the order of each of them
+  std::vector<std::string_view> from_order;
+  std::vector<std::string_view> to_order;
+  for (const auto &property : from.properties) {
+    if (!to_names.contains(property->property_name)) {
+      change.properties.push_back({NDFPropertyChange::Removed,
+                                   property->property_name.str(), {}, nullptr});
+    } else {
+      from_order.push_back(property->property_name);
+    }
+  }
+  std::vector<NDFPropertyPathStep> path;
+  for (uint32_t i = 0; i < to.properties.size(); i++) {
+    auto &property = to.properties[i];
+    const auto &name = property->property_name.str();
+    auto it = from_properties.find(name);
+    if (it == from_properties.end()) {
+      change.properties.push_back(
+          {NDFPropertyChange::Added, name, {}, property->get_copy(), i});
+      continue;
+    }
+    to_order.push_back(name);
+    if (from_hashes[it->second] != to_hashes[i]) {
+      auto &from_property = *from.properties[it->second];
+      diff_property(from_property, hash_node(from_property), *property,
+                    hash_node(*property), name, path, change.properties);
+    }
+  }
+  if (from_order != to_order) {
+    for (const auto &property : to.properties) {
+      change.property_order.push_back(property->property_name.str());
+    }
+  }
+  return change.header_changed || !change.properties.empty() ||
+         !change.property_order.empty();
+}
+
+NDFDiff diff_ndf(NDF &from, NDF &to, unsigned jobs) {
+  from.load_lazy_objects();
+  to.load_lazy_objects();
+
+  NDFDiff diff;
+  for (const auto &[name, object] : from.object_map) {
+    if (!to.object_map.contains(name)) {
+      diff.removed_objects.push_back(name);
+    }
+  }
+  // objects in both, from and to
+  std::vector<std::pair<NDFObject *, NDFObject *>> pairs;
+  pairs.reserve(to.object_map.size());
+  for (auto it = to.object_map.begin(); it != to.object_map.end(); ++it) {
+    auto from_it = from.object_map.find(it->first);
+    if (from_it == from.object_map.end()) {
+      diff.added_objects.push_back(it->second.get_copy());
+    } else {
+      pairs.emplace_back(&from_it.value(), &it.value());
+    }
+  }
+
+  auto diff_range = [&pairs](size_t begin, size_t end,
+                             std::vector<NDFObjectChange> &changes) {
+    for (size_t idx = begin; idx < end; idx++) {
+      NDFObjectChange change;
+      if (diff_object(*pairs[idx].first, *pairs[idx].second, change)) {
+        changes.push_back(std::move(change));
+      }
+    }
+  };
+
+  jobs = std::clamp<unsigned>(jobs, 1, std::max<size_t>(pairs.size(), 1));
+  if (jobs == 1) {
+    diff_range(0, pairs.size(), diff.changed_objects);
+    return diff;
+  }
+
+  // every thread compares a contiguous range of the objects, hashing and
+  // copying only reads both NDFs
+  std::vector<std::vector<NDFObjectChange>> partitions(jobs);
+  std::vector<std::exception_ptr> errors(jobs);
+  size_t chunk = (pairs.size() + jobs - 1) / jobs;
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < jobs; i++) {
+    threads.emplace_back([&, i]() {
+      size_t begin = std::min(pairs.size(), i * chunk);
+      size_t end = std::min(pairs.size(), begin + chunk);
+      try {
+        diff_range(begin, end, partitions[i]);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  for (auto &partition : partitions) {
+    std::move(partition.begin(), partition.end(),
+              std::back_inserter(diff.changed_objects));
+  }
+  return diff;
+}
+
+// the property the path of change leads to, starting at property
+static NDFPropertyPtr &resolve_property_path(NDFPropertyPtr &property,
+                                             const std::string &object_name,
+                                             const NDFPropertyChange &change) {
+  auto missing = [&]() {
+    return std::runtime_error(
+        std::format("apply_ndf_diff: property {} of {} does not exist",
+                    change.path_string(), object_name));
+  };
+  NDFPropertyPtr *slot = &property;
+  for (const auto &step : change.path) {
+    NDFProperty &current = **slot;
+    switch (step.kind) {
+    case NDFPropertyPathStep::ListItem: {
+      if (!current.is_list()) {
+        throw missing();
+      }
+      auto &values = static_cast<NDFPropertyList &>(current).values;
+      if (step.index >= values.size()) {
+        throw missing();
+      }
+      slot = &values[step.index];
+      break;
+    }
+    case NDFPropertyPathStep::MapKey:
+    case NDFPropertyPathStep::MapValue: {
+      if (!current.is_map()) {
+        throw missing();
+      }
+      auto &values = static_cast<NDFPropertyMap &>(current).values;
+      if (step.index >= values.size()) {
+        throw missing();
+      }
+      slot = step.kind == NDFPropertyPathStep::MapKey
+                 ? &values[step.index].first
+                 : &values[step.index].second;
+      break;
+    }
+    case NDFPropertyPathStep::PairFirst:
+    case NDFPropertyPathStep::PairSecond: {
+      if (!current.is_pair()) {
+        throw missing();
+      }
+      auto &pair = static_cast<NDFPropertyPair &>(current);
+      slot = step.kind == NDFPropertyPathStep::PairFirst ? &pair.first
+                                                         : &pair.second;
+      break;
+    }
+    }
+  }
+  return *slot;
+}
+
+static void rebuild_property_map(NDFObject &object) {
+  object.property_map.clear();
+  for (uint32_t i = 0; i < object.properties.size(); i++) {
+    object.property_map.insert({object.properties[i]->property_name.str(), i});
+  }
+}
+
+static void apply_object_change(NDF &ndf, const NDFObjectChange &change) {
+  if (!ndf.object_map.contains(change.name)) {
+    throw std::runtime_error(std::format(
+        "apply_ndf_diff: object {} does not exist", change.name));
+  }
+  auto &object = ndf.get_object(change.name);
+  rebuild_property_map(object);
+  if (change.header_changed) {
+    object.class_name = change.class_name;
+    object.export_path = change.export_path;
+    object.is_top_object = change.is_top_object;
+  }
+
+  auto missing = [&](const NDFPropertyChange &property_change) {
+    return std::runtime_error(
+        std::format("apply_ndf_diff: property {} of {} does not exist",
+                    property_change.property_name, change.name));
+  };
+  // removals, changes and additions in that order, the positions of added
+  // properties are the ones in the final object
+  for (const auto &property_change : change.properties) {
+    if (property_change.kind != NDFPropertyChange::Removed) {
+      continue;
+    }
+    auto it = object.property_map.find(property_change.property_name);
+    if (it == object.property_map.end()) {
+      throw missing(property_change);
+    }
+    object.properties.erase(object.properties.begin() + it->second);
+    rebuild_property_map(object);
+  }
+  for (const auto &property_change : change.properties) {
+    if (property_change.kind != NDFPropertyChange::Changed) {
+      continue;
+    }
+    auto it = object.property_map.find(property_change.property_name);
+    if (it == object.property_map.end()) {
+      throw missing(property_change);
+    }
+    auto &slot = resolve_property_path(object.properties[it->second],
+                                       change.name, property_change);
+    slot = property_change.value->get_copy();
+  }
+  bool added = false;
+  for (const auto &property_change : change.properties) {
+    if (property_change.kind != NDFPropertyChange::Added) {
+      continue;
+    }
+    auto position =
+        std::min<size_t>(property_change.position, object.properties.size());
+    object.properties.insert(object.properties.begin() + position,
+                             property_change.value->get_copy());
+    added = true;
+  }
+  if (added) {
+    rebuild_property_map(object);
+  }
+
+  if (!change.property_order.empty()) {
+    if (change.property_order.size() != object.properties.size()) {
+      throw std::runtime_error(std::format(
+          "apply_ndf_diff: properties of {} do not match its order",
+          change.name));
+    }
+    decltype(object.properties) ordered(object.properties.get_allocator());
+    ordered.reserve(object.properties.size());
+    for (const auto &name : change.property_order) {
+      auto it = object.property_map.find(name);
+      if (it == object.property_map.end() || !object.properties[it->second]) {
+        throw std::runtime_error(std::format(
+            "apply_ndf_diff: properties of {} do not match its order",
+            change.name));
+      }
+      ordered.push_back(std::move(object.properties[it->second]));
+    }
+    object.properties = std::move(ordered);
+    rebuild_property_map(object);
+  }
+}
+
+void apply_ndf_diff(NDF &ndf, const NDFDiff &diff) {
+  for (const auto &name : diff.removed_objects) {
+    if (!ndf.remove_object(name)) {
+      throw std::runtime_error(
+          std::format("apply_ndf_diff: object {} does not exist", name));
+    }
+  }
+  bool properties_changed = false;
+  for (const auto &change : diff.changed_objects) {
+    apply_object_change(ndf, change);
+    properties_changed |= !change.properties.empty();
+  }
+  // the reference index does not know the replaced properties
+  if (properties_changed) {
+    ndf.invalidate_reference_index();
+  }
+  for (const auto &object : diff.added_objects) {
+    if (ndf.object_map.contains(object.name)) {
+      throw std::runtime_error(std::format(
+          "apply_ndf_diff: object {} does already exist", object.name));
+    }
+    ndf.add_object(object.get_copy());
+  }
+}
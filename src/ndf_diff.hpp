@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "ndf.hpp"
+
+// FNV-1a with a final mix, stable across runs unlike std::hash
+class NDFHasher {
+private:
+  uint64_t m_state = 0xcbf29ce484222325;
+
+public:
+  void add_bytes(const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+      m_state = (m_state ^ bytes[i]) * 0x100000001b3;
+    }
+  }
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void add(const T &value) {
+    add_bytes(&value, sizeof(T));
+  }
+  // the size goes in first, "ab" + "c" and "a" + "bc" differ
+  void add(std::string_view str) {
+    add<uint64_t>(str.size());
+    add_bytes(str.data(), str.size());
+  }
+  [[nodiscard]] uint64_t digest() const {
+    uint64_t hash = m_state;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53;
+    hash ^= hash >> 33;
+    return hash;
+  }
+};
+
+// hash of a property tree, items of lists, maps and pairs go in through their
+// own hashes. the name of the property is not part of it
+uint64_t ndf_property_hash(const NDFProperty &property);
+// class, export path, top object flag and the named properties in order, but
+// not the name of the object. reordered properties change the hash, diff_ndf
+// reports the new order
+uint64_t ndf_object_hash(const NDFObject &object);
+
+// one step from a container property to one of its items
+struct NDFPropertyPathStep {
+  enum Kind : uint8_t { ListItem, MapKey, MapValue, PairFirst, PairSecond };
+  Kind kind;
+  // entry of lists and maps
+  uint32_t index = 0;
+};
+
+struct NDFPropertyChange {
+  enum Kind : uint8_t { Added, Removed, Changed };
+  Kind kind;
+  std::string property_name;
+  // items below the property, empty if the whole property changed
+  std::vector<NDFPropertyPathStep> path;
+  // the new value, nullptr for removed properties
+  NDFPropertyPtr value;
+  // index of an added property in the properties of the object
+  uint32_t position = 0;
+
+  // Name, Name[2], Name[2].Key, Name.First, ...
+  [[nodiscard]] std::string path_string() const;
+};
+
+struct NDFObjectChange {
+  std::string name;
+  // class_name, export_path and is_top_object are only used if set
+  bool header_changed = false;
+  std::string class_name;
+  std::string export_path;
+  bool is_top_object = false;
+  std::vector<NDFPropertyChange> properties;
+  // names of all properties of the changed object in their order, only set if
+  // the properties that were kept are in a different order. applied last
+  std::vector<std::string> property_order;
+};
+
+// changes that turn one NDF into another, objects are matched by name. the
+// objects and values are copies, the diff does not refer to either NDF
+struct NDFDiff {
+  std::vector<NDFObject> added_objects;
+  std::vector<std::string> removed_objects;
+  std::vector<NDFObjectChange> changed_objects;
+
+  [[nodiscard]] bool empty() const {
+    return added_objects.empty() && removed_objects.empty() &&
+           changed_objects.empty();
+  }
+};
+
+// objects with the same hash are skipped, the others are compared property by
+// property, only descending into items whose hashes differ. the item hashes
+// of a changed property are computed once, bottom up. lists and maps that
+// changed their size are replaced as a whole. jobs > 1 compares the
+// objects on that many threads. pending objects of lazy loads get decoded
+NDFDiff diff_ndf(NDF &from, NDF &to, unsigned jobs = 1);
+// turns ndf into the to of diff_ndf, ndf has to have the objects of its from.
+// only the objects in diff are touched, pending objects of a lazy load stay
+// pending otherwise. throws std::runtime_error if an object or property of
+// the diff does not exist, the changes before it are applied already
+void apply_ndf_diff(NDF &ndf, const NDFDiff &diff);
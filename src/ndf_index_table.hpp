@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// hashes for the keys of NDFIndexTable. strings can be looked up by
+// std::string_view without building a std::string
+struct NDFIndexHash {
+  uint64_t operator()(std::string_view str) const {
+    return std::hash<std::string_view>{}(str);
+  }
+  uint64_t operator()(std::span<const uint32_t> path) const {
+    // FNV-1a over the indices, finished with a multiply so the low bits used
+    // for the slot depend on every index
+    uint64_t hash = 0xCBF29CE484222325;
+    for (uint32_t idx : path) {
+      hash = (hash ^ idx) * 0x100000001B3;
+    }
+    return hash * 0x9E3779B97F4A7C15;
+  }
+};
+
+// table of unique keys, each gets a dense index in order of insertion. used
+// for the string, tran, class, object, import and export tables written by
+// save_as_ndfbin_stream.
+// open addressing with linear probing, every slot keeps the upper bits of
+// the key hash next to the index, so a probe only compares keys when those
+// match. the hashes of the items are kept as well, growing never hashes a
+// key again
+template <typename Key, typename Hash = NDFIndexHash> class NDFIndexTable {
+private:
+  struct Slot {
+    uint32_t hash_tag;
+    // index + 1, 0 is an empty slot
+    uint32_t index;
+  };
+
+  std::vector<Slot> m_slots;
+  std::vector<Key> m_items;
+  std::vector<uint64_t> m_hashes;
+
+  static uint32_t hash_tag(uint64_t hash) { return uint32_t(hash >> 32); }
+
+  size_t slot_mask() const { return m_slots.size() - 1; }
+
+  // the slot of the key, or the empty slot it would go into
+  template <typename K> size_t find_slot(const K &key, uint64_t hash) const {
+    size_t slot = hash & slot_mask();
+    uint32_t tag = hash_tag(hash);
+    while (m_slots[slot].index != 0) {
+      if (m_slots[slot].hash_tag == tag &&
+          equal(m_items[m_slots[slot].index - 1], key)) {
+        return slot;
+      }
+      slot = (slot + 1) & slot_mask();
+    }
+    return slot;
+  }
+
+  template <typename K> static bool equal(const Key &item, const K &key) {
+    if constexpr (std::is_convertible_v<const K &, std::string_view>) {
+      return std::string_view(item) == std::string_view(key);
+    } else {
+      return std::ranges::equal(item, key);
+    }
+  }
+
+  void rehash(size_t slot_count) {
+    m_slots.assign(slot_count, {0, 0});
+    for (uint32_t idx = 0; idx < m_items.size(); idx++) {
+      size_t slot = m_hashes[idx] & slot_mask();
+      while (m_slots[slot].index != 0) {
+        slot = (slot + 1) & slot_mask();
+      }
+      m_slots[slot] = {hash_tag(m_hashes[idx]), idx + 1};
+    }
+  }
+
+  // keeps the load factor below 3/4
+  static size_t slot_count_for(size_t count) {
+    return std::bit_ceil(std::max<size_t>(16, count + count / 3 + 1));
+  }
+
+public:
+  NDFIndexTable() = default;
+
+  void reserve(size_t count) {
+    m_items.reserve(count);
+    m_hashes.reserve(count);
+    if (slot_count_for(count) > m_slots.size()) {
+      rehash(slot_count_for(count));
+    }
+  }
+  void clear() {
+    m_slots.clear();
+    m_items.clear();
+    m_hashes.clear();
+  }
+
+  [[nodiscard]] size_t size() const { return m_items.size(); }
+  [[nodiscard]] bool empty() const { return m_items.empty(); }
+  [[nodiscard]] const std::vector<Key> &items() const { return m_items; }
+  [[nodiscard]] const Key &operator[](uint32_t index) const {
+    return m_items[index];
+  }
+  [[nodiscard]] const Key &at(uint32_t index) const {
+    return m_items.at(index);
+  }
+  auto begin() const { return m_items.begin(); }
+  auto end() const { return m_items.end(); }
+
+  // index of the key, the key is appended if it is not in the table yet.
+  // second is true if it got added
+  template <typename K> std::pair<uint32_t, bool> insert(const K &key) {
+    if (slot_count_for(m_items.size() + 1) > m_slots.size()) {
+      rehash(slot_count_for(m_items.size() + 1));
+    }
+    uint64_t hash = Hash{}(key);
+    size_t slot = find_slot(key, hash);
+    if (m_slots[slot].index != 0) {
+      return {m_slots[slot].index - 1, false};
+    }
+    uint32_t index = m_items.size();
+    m_items.emplace_back(Key(std::begin(key), std::end(key)));
+    m_hashes.push_back(hash);
+    m_slots[slot] = {hash_tag(hash), index + 1};
+    return {index, true};
+  }
+
+  template <typename K>
+  [[nodiscard]] std::optional<uint32_t> find(const K &key) const {
+    if (m_slots.empty()) {
+      return std::nullopt;
+    }
+    size_t slot = find_slot(key, Hash{}(key));
+    if (m_slots[slot].index == 0) {
+      return std::nullopt;
+    }
+    return m_slots[slot].index - 1;
+  }
+  template <typename K> [[nodiscard]] bool contains(const K &key) const {
+    return find(key).has_value();
+  }
+};
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "binary_cursor.hpp"
+#include "ndf_property_name.hpp"
 #include "spdlog/spdlog.h"
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <pugixml.hpp>
 #include <string>
 #include <unordered_map>
@@ -9,6 +13,7 @@
 #include <vector>
 
 class NDF;
+class NDFXmlWriter;
 
 enum NDFPropertyType : uint32_t {
   Bool = 0x0,
@@ -42,28 +47,74 @@ enum NDFPropertyType : uint32_t {
 };
 
 class NDF_DB;
+struct NDFDBValue;
+
+struct NDFProperty;
+struct NDFPropertyObjectReference;
+
+// deleter of NDFPropertyPtr, properties living in an arena only get destroyed,
+// their memory is released together with the arena
+struct NDFPropertyDeleter {
+  std::pmr::memory_resource *arena = nullptr;
+
+  NDFPropertyDeleter() = default;
+  explicit NDFPropertyDeleter(std::pmr::memory_resource *arena)
+      : arena(arena) {}
+  // allows moving a std::unique_ptr<NDFPropertyXXX> into a NDFPropertyPtr
+  template <typename T>
+  NDFPropertyDeleter(const std::default_delete<T> &) {}
+
+  void operator()(NDFProperty *property) const;
+};
+using NDFPropertyPtr = std::unique_ptr<NDFProperty, NDFPropertyDeleter>;
+
+// allocates the property in arena, or on the heap if arena is nullptr
+template <typename T>
+NDFPropertyPtr make_ndf_property(std::pmr::memory_resource *arena = nullptr) {
+  if (!arena) {
+    return NDFPropertyPtr(new T());
+  }
+  void *mem = arena->allocate(sizeof(T), alignof(T));
+  // containers keep their items in the same arena
+  if constexpr (std::is_constructible_v<T, std::pmr::memory_resource *>) {
+    return NDFPropertyPtr(new (mem) T(arena), NDFPropertyDeleter(arena));
+  } else {
+    return NDFPropertyPtr(new (mem) T(), NDFPropertyDeleter(arena));
+  }
+}
 
 struct NDFProperty {
-  uint32_t property_idx;
+  // index into the PROP table, items of lists, maps and pairs have none (-1
+  // in ndf_db)
+  uint32_t property_idx = 4294967295;
   uint32_t property_type;
-  std::string property_name;
+  NDFPropertyName property_name;
   NDFProperty() = default;
   virtual ~NDFProperty() = default;
-  static std::unique_ptr<NDFProperty>
-  get_property_from_ndftype(uint32_t ndf_type);
-  static std::unique_ptr<NDFProperty>
+  static NDFPropertyPtr
+  get_property_from_ndftype(uint32_t ndf_type,
+                            std::pmr::memory_resource *arena = nullptr);
+  static NDFPropertyPtr
   get_property_from_ndf_xml(uint32_t ndf_type, const pugi::xml_node &ndf_node);
-  static std::unique_ptr<NDFProperty>
+  static NDFPropertyPtr
   get_property_from_ndf_db(uint32_t ndf_type, bool is_import_reference);
-  static std::unique_ptr<NDFProperty>
-  get_property_from_ndfbin(uint32_t ndf_type, std::istream &stream);
+  static NDFPropertyPtr
+  get_property_from_ndfbin(uint32_t ndf_type, BinaryCursor &cursor,
+                           std::pmr::memory_resource *arena = nullptr);
+  // moves the cursor past a value of ndf_type without decoding it, only the
+  // sizes of wide strings and containers are read
+  static void skip_ndfbin(uint32_t ndf_type, BinaryCursor &cursor);
   virtual void to_ndf_xml(pugi::xml_node &) const {
     throw std::runtime_error("Not implemented");
   }
+  // streaming variant, writes the same xml as the one above
+  virtual void to_ndf_xml(NDFXmlWriter &) const {
+    throw std::runtime_error("Not implemented");
+  }
   virtual void from_ndf_xml(const pugi::xml_node &) {
     throw std::runtime_error("Not implemented");
   }
-  virtual void from_ndfbin(NDF *, std::istream &) {
+  virtual void from_ndfbin(NDF *, BinaryCursor &) {
     throw std::runtime_error("Not implemented");
   }
   virtual void to_ndfbin(NDF *, std::ostream &) const {
@@ -80,39 +131,57 @@ struct NDFProperty {
   virtual bool is_list() { return false; }
   virtual bool is_map() { return false; }
   virtual bool is_pair() { return false; }
-  virtual std::unique_ptr<NDFProperty> get_copy() = 0;
+  virtual NDFPropertyPtr get_copy() = 0;
   virtual void fix_references(const std::string &, const std::string &) {}
   virtual void
   fix_references(const std::unordered_map<std::string, std::string> &) {}
   virtual std::string as_string() = 0;
   virtual std::unordered_set<std::string> get_object_references() { return {}; }
   virtual std::unordered_set<std::string> get_import_references() { return {}; }
+  // appends the object reference properties of this property tree, used by
+  // the reverse reference index of NDF
+  virtual void get_object_reference_properties(
+      std::vector<NDFPropertyObjectReference *> &) {}
 
   // used by ndf_db
   int get_db_property_value(NDF_DB *db, int property_id);
-  static std::unique_ptr<NDFProperty>
+  static NDFPropertyPtr
   get_db_property_type(NDF_DB *db, int prop_id, int pos = -1);
   std::optional<int> add_db_property(NDF_DB *db, int object_id, int parent,
                                      int position, int value_id,
                                      bool is_import_reference = false) const;
+  // used by NDF_DB::get_object, which fetches all rows of an object at once.
+  // scalars take their value from the row, containers their sorted items
+  virtual bool from_ndf_db_value(const NDFDBValue &) { return false; }
+  virtual bool set_ndf_db_items(std::vector<NDFPropertyPtr>) { return false; }
 };
 
+inline void NDFPropertyDeleter::operator()(NDFProperty *property) const {
+  if (arena) {
+    std::destroy_at(property);
+  } else {
+    delete property;
+  }
+}
+
 struct NDFPropertyBool : NDFProperty {
   bool value;
   NDFPropertyBool() { property_type = NDFPropertyType::Bool; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, bool new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyBool>(*this);
   }
   std::string as_string() override { return value ? "true" : "false"; }
@@ -122,17 +191,19 @@ struct NDFPropertyUInt8 : NDFProperty {
   uint8_t value;
   NDFPropertyUInt8() { property_type = NDFPropertyType::UInt8; }
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, uint8_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyUInt8>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -143,17 +214,19 @@ struct NDFPropertyInt16 : NDFProperty {
   NDFPropertyInt16() { property_type = NDFPropertyType::Int16; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, int16_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyInt16>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -164,17 +237,19 @@ struct NDFPropertyUInt16 : NDFProperty {
   NDFPropertyUInt16() { property_type = NDFPropertyType::UInt16; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, uint16_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyUInt16>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -185,17 +260,19 @@ struct NDFPropertyInt32 : NDFProperty {
   NDFPropertyInt32() { property_type = NDFPropertyType::Int32; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, int32_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyInt32>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -206,17 +283,19 @@ struct NDFPropertyUInt32 : NDFProperty {
   NDFPropertyUInt32() { property_type = NDFPropertyType::UInt32; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, uint32_t new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyUInt32>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -227,17 +306,19 @@ struct NDFPropertyFloat32 : NDFProperty {
   NDFPropertyFloat32() { property_type = NDFPropertyType::Float32; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, float new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyFloat32>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -248,17 +329,19 @@ struct NDFPropertyFloat64 : NDFProperty {
   NDFPropertyFloat64() { property_type = NDFPropertyType::Float64; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, double new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyFloat64>(*this);
   }
   std::string as_string() override { return std::to_string(value); }
@@ -269,17 +352,19 @@ struct NDFPropertyString : NDFProperty {
   NDFPropertyString() { property_type = NDFPropertyType::String; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
+  void from_ndfbin(NDF *root, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *root, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyString>(*this);
   }
   std::string as_string() override { return value; }
@@ -289,17 +374,19 @@ struct NDFPropertyWideString : NDFProperty {
   std::string value;
   NDFPropertyWideString() { property_type = NDFPropertyType::WideString; }
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
+  void from_ndfbin(NDF *root, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *root, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyWideString>(*this);
   }
   std::string as_string() override { return value; }
@@ -311,18 +398,20 @@ struct NDFPropertyF32_vec2 : NDFProperty {
   NDFPropertyF32_vec2() { property_type = NDFPropertyType::F32_vec2; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, float new_value_x,
                     float new_value_y);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyF32_vec2>(*this);
   }
   std::string as_string() override { return fmt::format("({}, {})", x, y); }
@@ -335,18 +424,20 @@ struct NDFPropertyF32_vec3 : NDFProperty {
   NDFPropertyF32_vec3() { property_type = NDFPropertyType::F32_vec3; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, float new_value_x,
                     float new_value_y, float new_value_z);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyF32_vec3>(*this);
   }
   std::string as_string() override {
@@ -362,18 +453,20 @@ struct NDFPropertyF32_vec4 : NDFProperty {
   NDFPropertyF32_vec4() { property_type = NDFPropertyType::F32_vec4; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, float new_value_x,
                     float new_value_y, float new_value_z, float new_value_w);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyF32_vec4>(*this);
   }
   std::string as_string() override {
@@ -389,19 +482,21 @@ struct NDFPropertyColor : NDFProperty {
   NDFPropertyColor() { property_type = NDFPropertyType::Color; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, uint8_t new_value_r,
                     uint8_t new_value_g, uint8_t new_value_b,
                     uint8_t new_value_a);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyColor>(*this);
   }
   std::string as_string() override {
@@ -415,18 +510,20 @@ struct NDFPropertyS32_vec2 : NDFProperty {
   NDFPropertyS32_vec2() { property_type = NDFPropertyType::S32_vec2; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, int32_t new_value_x,
                     int32_t new_value_y);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyS32_vec2>(*this);
   }
   std::string as_string() override { return fmt::format("({}, {})", x, y); }
@@ -439,18 +536,20 @@ struct NDFPropertyS32_vec3 : NDFProperty {
   NDFPropertyS32_vec3() { property_type = NDFPropertyType::S32_vec3; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, int32_t new_value_x,
                     int32_t new_value_y, int32_t new_value_z);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyS32_vec3>(*this);
   }
   std::string as_string() override {
@@ -467,6 +566,7 @@ struct NDFPropertyObjectReference : NDFProperty {
   }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_object_reference() override { return true; }
@@ -485,16 +585,21 @@ struct NDFPropertyObjectReference : NDFProperty {
   std::unordered_set<std::string> get_object_references() override {
     return {object_name};
   }
+  void get_object_reference_properties(
+      std::vector<NDFPropertyObjectReference *> &ret) override {
+    ret.push_back(this);
+  }
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
+  void from_ndfbin(NDF *root, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *root, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyObjectReference>(*this);
   }
   std::string as_string() override { return object_name; }
@@ -507,6 +612,7 @@ struct NDFPropertyImportReference : NDFProperty {
   }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_import_reference() override { return true; }
@@ -514,25 +620,30 @@ struct NDFPropertyImportReference : NDFProperty {
     return {import_name};
   }
 
-  void from_ndfbin(NDF *root, std::istream &stream) override;
+  void from_ndfbin(NDF *root, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *root, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyImportReference>(*this);
   }
   std::string as_string() override { return import_name; }
 };
 
 struct NDFPropertyList : NDFProperty {
-  std::vector<std::unique_ptr<NDFProperty>> values;
+  std::pmr::vector<NDFPropertyPtr> values;
   NDFPropertyList() { property_type = NDFPropertyType::List; }
+  explicit NDFPropertyList(std::pmr::memory_resource *arena) : values(arena) {
+    property_type = NDFPropertyType::List;
+  }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_list() override { return true; }
@@ -556,6 +667,12 @@ struct NDFPropertyList : NDFProperty {
     }
     return ret;
   }
+  void get_object_reference_properties(
+      std::vector<NDFPropertyObjectReference *> &ret) override {
+    for (auto const &value : values) {
+      value->get_object_reference_properties(ret);
+    }
+  }
   std::unordered_set<std::string> get_import_references() override {
     std::unordered_set<std::string> ret;
     for (auto const &value : values) {
@@ -565,14 +682,15 @@ struct NDFPropertyList : NDFProperty {
     return ret;
   }
 
-  void from_ndfbin(NDF *, std::istream &) override;
+  void from_ndfbin(NDF *, BinaryCursor &) override;
   void to_ndfbin(NDF *, std::ostream &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool set_ndf_db_items(std::vector<NDFPropertyPtr> items) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     auto ret = std::make_unique<NDFPropertyList>();
     for (auto const &value : values) {
       ret->values.push_back(value->get_copy());
@@ -588,12 +706,14 @@ struct NDFPropertyList : NDFProperty {
 };
 
 struct NDFPropertyMap : NDFProperty {
-  std::vector<
-      std::pair<std::unique_ptr<NDFProperty>, std::unique_ptr<NDFProperty>>>
-      values;
+  std::pmr::vector<std::pair<NDFPropertyPtr, NDFPropertyPtr>> values;
   NDFPropertyMap() { property_type = NDFPropertyType::Map; }
+  explicit NDFPropertyMap(std::pmr::memory_resource *arena) : values(arena) {
+    property_type = NDFPropertyType::Map;
+  }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_map() override { return true; }
@@ -621,6 +741,13 @@ struct NDFPropertyMap : NDFProperty {
     }
     return ret;
   }
+  void get_object_reference_properties(
+      std::vector<NDFPropertyObjectReference *> &ret) override {
+    for (auto const &[key, value] : values) {
+      key->get_object_reference_properties(ret);
+      value->get_object_reference_properties(ret);
+    }
+  }
   std::unordered_set<std::string> get_import_references() override {
     std::unordered_set<std::string> ret;
     for (auto const &[key, value] : values) {
@@ -632,14 +759,15 @@ struct NDFPropertyMap : NDFProperty {
     return ret;
   }
 
-  void from_ndfbin(NDF *, std::istream &) override;
+  void from_ndfbin(NDF *, BinaryCursor &) override;
   void to_ndfbin(NDF *, std::ostream &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool set_ndf_db_items(std::vector<NDFPropertyPtr> items) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     auto ret = std::make_unique<NDFPropertyMap>();
     for (auto const &[key, value] : values) {
       ret->values.push_back({key->get_copy(), value->get_copy()});
@@ -660,17 +788,19 @@ struct NDFPropertyGUID : NDFProperty {
   NDFPropertyGUID() { property_type = NDFPropertyType::NDFGUID; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyGUID>(*this);
   }
   std::string as_string() override { return guid; }
@@ -681,17 +811,19 @@ struct NDFPropertyPathReference : NDFProperty {
   NDFPropertyPathReference() { property_type = NDFPropertyType::PathReference; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &) override;
+  void from_ndfbin(NDF *, BinaryCursor &) override;
   void to_ndfbin(NDF *, std::ostream &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyPathReference>(*this);
   }
   std::string as_string() override { return path; }
@@ -705,17 +837,19 @@ struct NDFPropertyLocalisationHash : NDFProperty {
   }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyLocalisationHash>(*this);
   }
   std::string as_string() override { return hash; }
@@ -727,28 +861,31 @@ struct NDFPropertyHash : NDFProperty {
   NDFPropertyHash() { property_type = NDFPropertyType::Hash; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
-  void from_ndfbin(NDF *, std::istream &stream) override;
+  void from_ndfbin(NDF *, BinaryCursor &cursor) override;
   void to_ndfbin(NDF *, std::ostream &stream) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool from_ndf_db_value(const NDFDBValue &row) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
   bool change_value(NDF_DB *db, int property_id, std::string new_value);
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     return std::make_unique<NDFPropertyHash>(*this);
   }
   std::string as_string() override { return hash; }
 };
 
 struct NDFPropertyPair : NDFProperty {
-  std::unique_ptr<NDFProperty> first;
-  std::unique_ptr<NDFProperty> second;
+  NDFPropertyPtr first;
+  NDFPropertyPtr second;
   NDFPropertyPair() { property_type = NDFPropertyType::Pair; }
 
   void to_ndf_xml(pugi::xml_node &node) const override;
+  void to_ndf_xml(NDFXmlWriter &writer) const override;
   void from_ndf_xml(const pugi::xml_node &node) override;
 
   bool is_pair() override { return true; }
@@ -770,6 +907,11 @@ struct NDFPropertyPair : NDFProperty {
     ret.insert(second_refs.begin(), second_refs.end());
     return ret;
   }
+  void get_object_reference_properties(
+      std::vector<NDFPropertyObjectReference *> &ret) override {
+    first->get_object_reference_properties(ret);
+    second->get_object_reference_properties(ret);
+  }
   std::unordered_set<std::string> get_import_references() override {
     std::unordered_set<std::string> ret;
     auto first_refs = first->get_import_references();
@@ -779,14 +921,15 @@ struct NDFPropertyPair : NDFProperty {
     return ret;
   }
 
-  void from_ndfbin(NDF *, std::istream &) override;
+  void from_ndfbin(NDF *, BinaryCursor &) override;
   void to_ndfbin(NDF *, std::ostream &) const override;
 
   bool from_ndf_db(NDF_DB *db, int property_id) override;
+  bool set_ndf_db_items(std::vector<NDFPropertyPtr> items) override;
   bool to_ndf_db(NDF_DB *db, int object_id, int parent = -1,
                  int position = -1) const override;
 
-  std::unique_ptr<NDFProperty> get_copy() override {
+  NDFPropertyPtr get_copy() override {
     auto ret = std::make_unique<NDFPropertyPair>();
     ret->first = first->get_copy();
     ret->second = second->get_copy();
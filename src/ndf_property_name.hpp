@@ -0,0 +1,114 @@
+#pragma once
+
+#include "spdlog/spdlog.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// interned property names. every distinct name is stored once and gets a
+// dense id, so comparing, copying and hashing names is a pointer operation.
+// the pool is process wide and append-only: properties get copied between
+// NDFs (and created without any NDF by the xml and db loaders), a handle has
+// to stay valid no matter which NDF it ends up in
+struct NDFPropertyNameEntry {
+  std::string name;
+  uint32_t id;
+};
+
+class NDFPropertyNamePool {
+private:
+  std::mutex m_mutex;
+  // deque keeps the entries at a fixed address
+  std::deque<NDFPropertyNameEntry> m_entries;
+  std::unordered_map<std::string_view, const NDFPropertyNameEntry *> m_lookup;
+  // interned once, default constructed names copy it without the lock
+  const NDFPropertyNameEntry *m_empty;
+
+  NDFPropertyNamePool() : m_empty(intern("")) {}
+
+public:
+  static NDFPropertyNamePool &instance() {
+    static NDFPropertyNamePool pool;
+    return pool;
+  }
+
+  const NDFPropertyNameEntry *intern(std::string_view name) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_lookup.find(name);
+    if (it != m_lookup.end()) {
+      return it->second;
+    }
+    auto &entry = m_entries.emplace_back(std::string(name),
+                                         static_cast<uint32_t>(m_entries.size()));
+    m_lookup.emplace(entry.name, &entry);
+    return &entry;
+  }
+
+  size_t size() {
+    std::lock_guard lock(m_mutex);
+    return m_entries.size();
+  }
+
+  [[nodiscard]] const NDFPropertyNameEntry *empty() const { return m_empty; }
+};
+
+class NDFPropertyName {
+private:
+  const NDFPropertyNameEntry *m_entry;
+
+public:
+  NDFPropertyName() : m_entry(NDFPropertyNamePool::instance().empty()) {}
+  NDFPropertyName(std::string_view name)
+      : m_entry(NDFPropertyNamePool::instance().intern(name)) {}
+  NDFPropertyName(const std::string &name)
+      : NDFPropertyName(std::string_view(name)) {}
+  NDFPropertyName(const char *name) : NDFPropertyName(std::string_view(name)) {}
+
+  [[nodiscard]] const std::string &str() const { return m_entry->name; }
+  [[nodiscard]] const char *c_str() const { return m_entry->name.c_str(); }
+  [[nodiscard]] size_t size() const { return m_entry->name.size(); }
+  [[nodiscard]] bool empty() const { return m_entry->name.empty(); }
+  // dense index into the pool, usable as a key instead of the string
+  [[nodiscard]] uint32_t id() const { return m_entry->id; }
+
+  operator const std::string &() const { return m_entry->name; }
+  operator std::string_view() const { return m_entry->name; }
+
+  bool operator==(const NDFPropertyName &other) const {
+    return m_entry == other.m_entry;
+  }
+  bool operator==(std::string_view other) const {
+    return m_entry->name == other;
+  }
+  bool operator==(const char *other) const { return m_entry->name == other; }
+  bool operator==(const std::string &other) const {
+    return m_entry->name == other;
+  }
+};
+
+template <> struct std::hash<NDFPropertyName> {
+  size_t operator()(const NDFPropertyName &name) const noexcept {
+    return std::hash<uint32_t>{}(name.id());
+  }
+};
+
+template <>
+struct fmt::formatter<NDFPropertyName> : fmt::formatter<std::string_view> {
+  auto format(const NDFPropertyName &name, fmt::format_context &ctx) const {
+    return fmt::formatter<std::string_view>::format(name.str(), ctx);
+  }
+};
+
+#ifdef __cpp_lib_format
+template <>
+struct std::formatter<NDFPropertyName> : std::formatter<std::string_view> {
+  auto format(const NDFPropertyName &name, std::format_context &ctx) const {
+    return std::formatter<std::string_view>::format(name.str(), ctx);
+  }
+};
+#endif
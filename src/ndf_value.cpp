@@ -0,0 +1,491 @@
+#include "ndf_value.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <stdexcept>
+
+#include "ndf.hpp"
+#include "utf_transcode.hpp"
+
+// same names the ndfbin loader gives the items of containers
+static const NDFPropertyName list_item_name("ListItem");
+static const NDFPropertyName map_key_name("Key");
+static const NDFPropertyName map_value_name("Value");
+static const NDFPropertyName pair_first_name("First");
+static const NDFPropertyName pair_second_name("Second");
+
+template <size_t N>
+static std::string bytes_to_hex(const std::array<uint8_t, N> &bytes) {
+  std::string hex;
+  hex.reserve(N * 2);
+  for (uint8_t byte : bytes) {
+    hex += std::format("{:02X}", byte);
+  }
+  return hex;
+}
+
+// missing digits stay zero
+template <size_t N>
+static std::array<uint8_t, N> hex_to_bytes(const std::string &hex) {
+  std::array<uint8_t, N> bytes{};
+  for (size_t i = 0; i < N && i * 2 + 2 <= hex.size(); i++) {
+    std::from_chars(hex.data() + i * 2, hex.data() + i * 2 + 2, bytes[i], 16);
+  }
+  return bytes;
+}
+
+// scalars and vectors are stored in the file exactly like in the payload
+template <typename Payload>
+static Payload read_payload(BinaryCursor &cursor) {
+  return Payload{cursor.read<decltype(Payload::value)>()};
+}
+
+NDFValue NDFValue::from_ndfbin(uint32_t ndf_type, BinaryCursor &cursor,
+                               const NDF &root) {
+  switch (ndf_type) {
+  case NDFPropertyType::Bool:
+    return NDFBoolValue{cursor.read<uint8_t>() != 0};
+  case NDFPropertyType::UInt8:
+    return read_payload<NDFUInt8Value>(cursor);
+  case NDFPropertyType::Int16:
+    return read_payload<NDFInt16Value>(cursor);
+  case NDFPropertyType::UInt16:
+    return read_payload<NDFUInt16Value>(cursor);
+  case NDFPropertyType::Int32:
+    return read_payload<NDFInt32Value>(cursor);
+  case NDFPropertyType::UInt32:
+    return read_payload<NDFUInt32Value>(cursor);
+  case NDFPropertyType::Float32:
+    return read_payload<NDFFloat32Value>(cursor);
+  case NDFPropertyType::Float64:
+    return read_payload<NDFFloat64Value>(cursor);
+  case NDFPropertyType::String:
+    return NDFStringValue{root.string_table.at(cursor.read<uint32_t>())};
+  case NDFPropertyType::PathReference:
+    return NDFPathReferenceValue{
+        root.string_table.at(cursor.read<uint32_t>())};
+  case NDFPropertyType::WideString: {
+    auto length = cursor.read<uint32_t>();
+    NDFWideStringValue str;
+    utf16le_to_utf8(cursor.read_bytes(length), str.value);
+    return str;
+  }
+  case NDFPropertyType::F32_vec2:
+    return read_payload<NDFF32Vec2Value>(cursor);
+  case NDFPropertyType::F32_vec3:
+    return read_payload<NDFF32Vec3Value>(cursor);
+  case NDFPropertyType::F32_vec4:
+    return read_payload<NDFF32Vec4Value>(cursor);
+  case NDFPropertyType::S32_vec2:
+    return read_payload<NDFS32Vec2Value>(cursor);
+  case NDFPropertyType::S32_vec3:
+    return read_payload<NDFS32Vec3Value>(cursor);
+  case NDFPropertyType::Color:
+    return read_payload<NDFColorValue>(cursor);
+  case NDFPropertyType::NDFGUID:
+    return read_payload<NDFGUIDValue>(cursor);
+  case NDFPropertyType::LocalisationHash:
+    return read_payload<NDFLocalisationHashValue>(cursor);
+  case NDFPropertyType::Hash:
+    return read_payload<NDFHashValue>(cursor);
+  case NDFPropertyType::ObjectReference: {
+    auto reference_type = cursor.read<uint32_t>();
+    if (reference_type == ReferenceType::Object) {
+      auto object_index = cursor.read<uint32_t>();
+      // class index, the object has its class already
+      cursor.skip(sizeof(uint32_t));
+      return NDFObjectReferenceValue{"Object_" +
+                                     std::to_string(object_index)};
+    }
+    if (reference_type == ReferenceType::Import) {
+      auto import_index = cursor.read<uint32_t>();
+      auto it = root.import_name_table.find(import_index);
+      if (it == root.import_name_table.end()) {
+        throw std::runtime_error(
+            std::format("Unknown import index: {}", import_index));
+      }
+      return NDFImportReferenceValue{it->second};
+    }
+    throw std::runtime_error(
+        std::format("Unknown ReferenceType: {}", reference_type));
+  }
+  case NDFPropertyType::List: {
+    auto count = cursor.read<uint32_t>();
+    NDFListValue list;
+    // every item takes at least 5 bytes, don't trust the count blindly
+    list.values.reserve(std::min<size_t>(count, cursor.remaining() / 5));
+    for (uint32_t i = 0; i < count; i++) {
+      auto item_type = cursor.read<uint32_t>();
+      list.values.push_back(from_ndfbin(item_type, cursor, root));
+    }
+    return list;
+  }
+  case NDFPropertyType::Map: {
+    auto count = cursor.read<uint32_t>();
+    NDFMapValue map;
+    map.values.reserve(std::min<size_t>(count, cursor.remaining() / 10));
+    for (uint32_t i = 0; i < count; i++) {
+      auto key_type = cursor.read<uint32_t>();
+      auto key = from_ndfbin(key_type, cursor, root);
+      auto value_type = cursor.read<uint32_t>();
+      map.values.emplace_back(std::move(key),
+                              from_ndfbin(value_type, cursor, root));
+    }
+    return map;
+  }
+  case NDFPropertyType::Pair: {
+    auto first_type = cursor.read<uint32_t>();
+    auto first = from_ndfbin(first_type, cursor, root);
+    auto second_type = cursor.read<uint32_t>();
+    return NDFPairValue(std::move(first),
+                        from_ndfbin(second_type, cursor, root));
+  }
+  default:
+    throw std::runtime_error(std::format("Unknown NDFType: {}", ndf_type));
+  }
+}
+
+void NDFValue::to_ndfbin(NDF &root, BinaryWriter &writer) const {
+  std::visit(
+      [&](const auto &payload) {
+        using P = std::decay_t<decltype(payload)>;
+        if constexpr (std::is_same_v<P, NDFBoolValue>) {
+          writer.write<uint8_t>(payload.value);
+        } else if constexpr (std::is_same_v<P, NDFStringValue> ||
+                             std::is_same_v<P, NDFPathReferenceValue>) {
+          writer.write(root.get_or_add_string(payload.value));
+        } else if constexpr (std::is_same_v<P, NDFWideStringValue>) {
+          // the length is in bytes of utf-16
+          std::u16string str;
+          utf8_to_utf16le(payload.value, str);
+          writer.write<uint32_t>(str.size() * sizeof(char16_t));
+          writer.write_bytes(std::as_bytes(std::span(str)));
+        } else if constexpr (std::is_same_v<P, NDFObjectReferenceValue>) {
+          writer.write<uint32_t>(ReferenceType::Object);
+          writer.write(root.get_object_index(payload.object_name));
+          writer.write(root.get_class_of_object(payload.object_name));
+        } else if constexpr (std::is_same_v<P, NDFImportReferenceValue>) {
+          writer.write<uint32_t>(ReferenceType::Import);
+          writer.write(root.get_or_add_impr(payload.import_name));
+        } else if constexpr (std::is_same_v<P, NDFListValue>) {
+          writer.write<uint32_t>(payload.values.size());
+          for (const auto &value : payload.values) {
+            writer.write(value.ndf_type());
+            value.to_ndfbin(root, writer);
+          }
+        } else if constexpr (std::is_same_v<P, NDFMapValue>) {
+          writer.write<uint32_t>(payload.values.size());
+          for (const auto &[key, value] : payload.values) {
+            writer.write(key.ndf_type());
+            key.to_ndfbin(root, writer);
+            writer.write(value.ndf_type());
+            value.to_ndfbin(root, writer);
+          }
+        } else if constexpr (std::is_same_v<P, NDFPairValue>) {
+          writer.write(payload.first->ndf_type());
+          payload.first->to_ndfbin(root, writer);
+          writer.write(payload.second->ndf_type());
+          payload.second->to_ndfbin(root, writer);
+        } else {
+          writer.write(payload.value);
+        }
+      },
+      data);
+}
+
+std::string NDFValue::as_string() const {
+  return std::visit(
+      [](const auto &payload) -> std::string {
+        using P = std::decay_t<decltype(payload)>;
+        if constexpr (std::is_same_v<P, NDFBoolValue>) {
+          return payload.value ? "true" : "false";
+        } else if constexpr (std::is_same_v<P, NDFStringValue> ||
+                             std::is_same_v<P, NDFPathReferenceValue> ||
+                             std::is_same_v<P, NDFWideStringValue>) {
+          return payload.value;
+        } else if constexpr (std::is_same_v<P, NDFF32Vec2Value> ||
+                             std::is_same_v<P, NDFS32Vec2Value>) {
+          return std::format("({}, {})", payload.value[0], payload.value[1]);
+        } else if constexpr (std::is_same_v<P, NDFF32Vec3Value> ||
+                             std::is_same_v<P, NDFS32Vec3Value>) {
+          return std::format("({}, {}, {})", payload.value[0],
+                             payload.value[1], payload.value[2]);
+        } else if constexpr (std::is_same_v<P, NDFF32Vec4Value>) {
+          return std::format("({}, {}, {}, {})", payload.value[0],
+                             payload.value[1], payload.value[2],
+                             payload.value[3]);
+        } else if constexpr (std::is_same_v<P, NDFColorValue>) {
+          return std::format("({}, {}, {}, {})", payload.value[2],
+                             payload.value[1], payload.value[0],
+                             payload.value[3]);
+        } else if constexpr (std::is_same_v<P, NDFGUIDValue> ||
+                             std::is_same_v<P, NDFLocalisationHashValue> ||
+                             std::is_same_v<P, NDFHashValue>) {
+          return bytes_to_hex(payload.value);
+        } else if constexpr (std::is_same_v<P, NDFObjectReferenceValue>) {
+          return payload.object_name;
+        } else if constexpr (std::is_same_v<P, NDFImportReferenceValue>) {
+          return payload.import_name;
+        } else if constexpr (std::is_same_v<P, NDFListValue> ||
+                             std::is_same_v<P, NDFMapValue>) {
+          return "size " + std::to_string(payload.values.size());
+        } else if constexpr (std::is_same_v<P, NDFPairValue>) {
+          return std::format("({}, {})", payload.first->as_string(),
+                             payload.second->as_string());
+        } else {
+          return std::to_string(payload.value);
+        }
+      },
+      data);
+}
+
+NDFValue NDFValue::from_property(const NDFProperty &property) {
+  switch (property.property_type) {
+  case NDFPropertyType::Bool:
+    return NDFBoolValue{static_cast<const NDFPropertyBool &>(property).value};
+  case NDFPropertyType::UInt8:
+    return NDFUInt8Value{
+        static_cast<const NDFPropertyUInt8 &>(property).value};
+  case NDFPropertyType::Int16:
+    return NDFInt16Value{
+        static_cast<const NDFPropertyInt16 &>(property).value};
+  case NDFPropertyType::UInt16:
+    return NDFUInt16Value{
+        static_cast<const NDFPropertyUInt16 &>(property).value};
+  case NDFPropertyType::Int32:
+    return NDFInt32Value{
+        static_cast<const NDFPropertyInt32 &>(property).value};
+  case NDFPropertyType::UInt32:
+    return NDFUInt32Value{
+        static_cast<const NDFPropertyUInt32 &>(property).value};
+  case NDFPropertyType::Float32:
+    return NDFFloat32Value{
+        static_cast<const NDFPropertyFloat32 &>(property).value};
+  case NDFPropertyType::Float64:
+    return NDFFloat64Value{
+        static_cast<const NDFPropertyFloat64 &>(property).value};
+  case NDFPropertyType::String:
+    return NDFStringValue{
+        static_cast<const NDFPropertyString &>(property).value};
+  case NDFPropertyType::PathReference:
+    return NDFPathReferenceValue{
+        static_cast<const NDFPropertyPathReference &>(property).path};
+  case NDFPropertyType::WideString:
+    return NDFWideStringValue{
+        static_cast<const NDFPropertyWideString &>(property).value};
+  case NDFPropertyType::F32_vec2: {
+    const auto &vec = static_cast<const NDFPropertyF32_vec2 &>(property);
+    return NDFF32Vec2Value{{vec.x, vec.y}};
+  }
+  case NDFPropertyType::F32_vec3: {
+    const auto &vec = static_cast<const NDFPropertyF32_vec3 &>(property);
+    return NDFF32Vec3Value{{vec.x, vec.y, vec.z}};
+  }
+  case NDFPropertyType::F32_vec4: {
+    const auto &vec = static_cast<const NDFPropertyF32_vec4 &>(property);
+    return NDFF32Vec4Value{{vec.x, vec.y, vec.z, vec.w}};
+  }
+  case NDFPropertyType::S32_vec2: {
+    const auto &vec = static_cast<const NDFPropertyS32_vec2 &>(property);
+    return NDFS32Vec2Value{{vec.x, vec.y}};
+  }
+  case NDFPropertyType::S32_vec3: {
+    const auto &vec = static_cast<const NDFPropertyS32_vec3 &>(property);
+    return NDFS32Vec3Value{{vec.x, vec.y, vec.z}};
+  }
+  case NDFPropertyType::Color: {
+    const auto &color = static_cast<const NDFPropertyColor &>(property);
+    return NDFColorValue{{color.b, color.g, color.r, color.a}};
+  }
+  case NDFPropertyType::NDFGUID:
+    return NDFGUIDValue{hex_to_bytes<16>(
+        static_cast<const NDFPropertyGUID &>(property).guid)};
+  case NDFPropertyType::LocalisationHash:
+    return NDFLocalisationHashValue{hex_to_bytes<8>(
+        static_cast<const NDFPropertyLocalisationHash &>(property).hash)};
+  case NDFPropertyType::Hash:
+    return NDFHashValue{hex_to_bytes<16>(
+        static_cast<const NDFPropertyHash &>(property).hash)};
+  case NDFPropertyType::ObjectReference: {
+    if (const auto *reference =
+            dynamic_cast<const NDFPropertyObjectReference *>(&property)) {
+      return NDFObjectReferenceValue{reference->object_name};
+    }
+    return NDFImportReferenceValue{
+        static_cast<const NDFPropertyImportReference &>(property).import_name};
+  }
+  case NDFPropertyType::List: {
+    NDFListValue list;
+    const auto &items = static_cast<const NDFPropertyList &>(property).values;
+    list.values.reserve(items.size());
+    for (const auto &item : items) {
+      list.values.push_back(from_property(*item));
+    }
+    return list;
+  }
+  case NDFPropertyType::Map: {
+    NDFMapValue map;
+    const auto &items = static_cast<const NDFPropertyMap &>(property).values;
+    map.values.reserve(items.size());
+    for (const auto &[key, value] : items) {
+      map.values.emplace_back(from_property(*key), from_property(*value));
+    }
+    return map;
+  }
+  case NDFPropertyType::Pair: {
+    const auto &pair = static_cast<const NDFPropertyPair &>(property);
+    return NDFPairValue(from_property(*pair.first),
+                        from_property(*pair.second));
+  }
+  default:
+    throw std::runtime_error(
+        std::format("Unknown NDFType: {}", property.property_type));
+  }
+}
+
+// property of class T holding value
+template <typename T, typename V>
+static NDFPropertyPtr make_value_property(const V &value,
+                                          std::pmr::memory_resource *arena) {
+  auto property = make_ndf_property<T>(arena);
+  static_cast<T &>(*property).value = value;
+  return property;
+}
+
+// item of a container with the name the ndfbin loader gives it
+static NDFPropertyPtr make_item_property(const NDFValue &value,
+                                         const NDFPropertyName &name,
+                                         std::pmr::memory_resource *arena) {
+  auto property = value.to_property(arena);
+  property->property_name = name;
+  return property;
+}
+
+NDFPropertyPtr
+NDFValue::to_property(std::pmr::memory_resource *arena) const {
+  return std::visit(
+      [arena](const auto &payload) -> NDFPropertyPtr {
+        using P = std::decay_t<decltype(payload)>;
+        const auto &v = payload;
+        if constexpr (std::is_same_v<P, NDFBoolValue>) {
+          return make_value_property<NDFPropertyBool>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFUInt8Value>) {
+          return make_value_property<NDFPropertyUInt8>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFInt16Value>) {
+          return make_value_property<NDFPropertyInt16>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFUInt16Value>) {
+          return make_value_property<NDFPropertyUInt16>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFInt32Value>) {
+          return make_value_property<NDFPropertyInt32>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFUInt32Value>) {
+          return make_value_property<NDFPropertyUInt32>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFFloat32Value>) {
+          return make_value_property<NDFPropertyFloat32>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFFloat64Value>) {
+          return make_value_property<NDFPropertyFloat64>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFStringValue>) {
+          return make_value_property<NDFPropertyString>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFWideStringValue>) {
+          return make_value_property<NDFPropertyWideString>(v.value, arena);
+        } else if constexpr (std::is_same_v<P, NDFPathReferenceValue>) {
+          auto property = make_ndf_property<NDFPropertyPathReference>(arena);
+          static_cast<NDFPropertyPathReference &>(*property).path = v.value;
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFF32Vec2Value>) {
+          auto property = make_ndf_property<NDFPropertyF32_vec2>(arena);
+          auto &vec = static_cast<NDFPropertyF32_vec2 &>(*property);
+          vec.x = v.value[0];
+          vec.y = v.value[1];
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFF32Vec3Value>) {
+          auto property = make_ndf_property<NDFPropertyF32_vec3>(arena);
+          auto &vec = static_cast<NDFPropertyF32_vec3 &>(*property);
+          vec.x = v.value[0];
+          vec.y = v.value[1];
+          vec.z = v.value[2];
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFF32Vec4Value>) {
+          auto property = make_ndf_property<NDFPropertyF32_vec4>(arena);
+          auto &vec = static_cast<NDFPropertyF32_vec4 &>(*property);
+          vec.x = v.value[0];
+          vec.y = v.value[1];
+          vec.z = v.value[2];
+          vec.w = v.value[3];
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFS32Vec2Value>) {
+          auto property = make_ndf_property<NDFPropertyS32_vec2>(arena);
+          auto &vec = static_cast<NDFPropertyS32_vec2 &>(*property);
+          vec.x = v.value[0];
+          vec.y = v.value[1];
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFS32Vec3Value>) {
+          auto property = make_ndf_property<NDFPropertyS32_vec3>(arena);
+          auto &vec = static_cast<NDFPropertyS32_vec3 &>(*property);
+          vec.x = v.value[0];
+          vec.y = v.value[1];
+          vec.z = v.value[2];
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFColorValue>) {
+          auto property = make_ndf_property<NDFPropertyColor>(arena);
+          auto &color = static_cast<NDFPropertyColor &>(*property);
+          color.b = v.value[0];
+          color.g = v.value[1];
+          color.r = v.value[2];
+          color.a = v.value[3];
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFGUIDValue>) {
+          auto property = make_ndf_property<NDFPropertyGUID>(arena);
+          static_cast<NDFPropertyGUID &>(*property).guid =
+              bytes_to_hex(v.value);
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFLocalisationHashValue>) {
+          auto property = make_ndf_property<NDFPropertyLocalisationHash>(arena);
+          static_cast<NDFPropertyLocalisationHash &>(*property).hash =
+              bytes_to_hex(v.value);
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFHashValue>) {
+          auto property = make_ndf_property<NDFPropertyHash>(arena);
+          static_cast<NDFPropertyHash &>(*property).hash =
+              bytes_to_hex(v.value);
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFObjectReferenceValue>) {
+          auto property = make_ndf_property<NDFPropertyObjectReference>(arena);
+          static_cast<NDFPropertyObjectReference &>(*property).object_name =
+              v.object_name;
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFImportReferenceValue>) {
+          auto property = make_ndf_property<NDFPropertyImportReference>(arena);
+          static_cast<NDFPropertyImportReference &>(*property).import_name =
+              v.import_name;
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFListValue>) {
+          auto property = make_ndf_property<NDFPropertyList>(arena);
+          auto &list = static_cast<NDFPropertyList &>(*property);
+          list.values.reserve(v.values.size());
+          for (const auto &value : v.values) {
+            list.values.push_back(
+                make_item_property(value, list_item_name, arena));
+          }
+          return property;
+        } else if constexpr (std::is_same_v<P, NDFMapValue>) {
+          auto property = make_ndf_property<NDFPropertyMap>(arena);
+          auto &map = static_cast<NDFPropertyMap &>(*property);
+          map.values.reserve(v.values.size());
+          for (const auto &[key, value] : v.values) {
+            map.values.emplace_back(
+                make_item_property(key, map_key_name, arena),
+                make_item_property(value, map_value_name, arena));
+          }
+          return property;
+        } else {
+          static_assert(std::is_same_v<P, NDFPairValue>);
+          auto property = make_ndf_property<NDFPropertyPair>(arena);
+          auto &pair = static_cast<NDFPropertyPair &>(*property);
+          pair.first = make_item_property(*v.first, pair_first_name, arena);
+          pair.second = make_item_property(*v.second, pair_second_name, arena);
+          return property;
+        }
+      },
+      data);
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "binary_cursor.hpp"
+#include "binary_writer.hpp"
+#include "ndf_properties.hpp"
+
+struct NDF;
+struct NDFValue;
+
+// payloads of NDFValue, every payload knows the ndf type it stands for. the
+// alternatives of NDFValue::Storage are the type table the codecs and
+// visitors dispatch on, scalars and vectors are stored inline
+template <uint32_t Type, typename T> struct NDFScalarValue {
+  static constexpr uint32_t ndf_type = Type;
+  T value{};
+
+  bool operator==(const NDFScalarValue &) const = default;
+};
+
+using NDFBoolValue = NDFScalarValue<NDFPropertyType::Bool, bool>;
+using NDFUInt8Value = NDFScalarValue<NDFPropertyType::UInt8, uint8_t>;
+using NDFInt16Value = NDFScalarValue<NDFPropertyType::Int16, int16_t>;
+using NDFUInt16Value = NDFScalarValue<NDFPropertyType::UInt16, uint16_t>;
+using NDFInt32Value = NDFScalarValue<NDFPropertyType::Int32, int32_t>;
+using NDFUInt32Value = NDFScalarValue<NDFPropertyType::UInt32, uint32_t>;
+using NDFFloat32Value = NDFScalarValue<NDFPropertyType::Float32, float>;
+using NDFFloat64Value = NDFScalarValue<NDFPropertyType::Float64, double>;
+// entries of the string table
+using NDFStringValue = NDFScalarValue<NDFPropertyType::String, std::string>;
+using NDFPathReferenceValue =
+    NDFScalarValue<NDFPropertyType::PathReference, std::string>;
+// utf-8, utf-16 in the file
+using NDFWideStringValue =
+    NDFScalarValue<NDFPropertyType::WideString, std::string>;
+using NDFF32Vec2Value =
+    NDFScalarValue<NDFPropertyType::F32_vec2, std::array<float, 2>>;
+using NDFF32Vec3Value =
+    NDFScalarValue<NDFPropertyType::F32_vec3, std::array<float, 3>>;
+using NDFF32Vec4Value =
+    NDFScalarValue<NDFPropertyType::F32_vec4, std::array<float, 4>>;
+using NDFS32Vec2Value =
+    NDFScalarValue<NDFPropertyType::S32_vec2, std::array<int32_t, 2>>;
+using NDFS32Vec3Value =
+    NDFScalarValue<NDFPropertyType::S32_vec3, std::array<int32_t, 3>>;
+// b, g, r, a like in the file
+using NDFColorValue =
+    NDFScalarValue<NDFPropertyType::Color, std::array<uint8_t, 4>>;
+// raw bytes, the property classes keep them as hex strings
+using NDFGUIDValue =
+    NDFScalarValue<NDFPropertyType::NDFGUID, std::array<uint8_t, 16>>;
+using NDFLocalisationHashValue =
+    NDFScalarValue<NDFPropertyType::LocalisationHash, std::array<uint8_t, 8>>;
+using NDFHashValue =
+    NDFScalarValue<NDFPropertyType::Hash, std::array<uint8_t, 16>>;
+
+// both references are ndf type 9, the reference type tells them apart
+struct NDFObjectReferenceValue {
+  static constexpr uint32_t ndf_type = NDFPropertyType::ObjectReference;
+  std::string object_name;
+
+  bool operator==(const NDFObjectReferenceValue &) const = default;
+};
+
+struct NDFImportReferenceValue {
+  static constexpr uint32_t ndf_type = NDFPropertyType::ImportReference;
+  std::string import_name;
+
+  bool operator==(const NDFImportReferenceValue &) const = default;
+};
+
+struct NDFListValue {
+  static constexpr uint32_t ndf_type = NDFPropertyType::List;
+  std::vector<NDFValue> values;
+
+  bool operator==(const NDFListValue &) const = default;
+};
+
+struct NDFMapValue {
+  static constexpr uint32_t ndf_type = NDFPropertyType::Map;
+  std::vector<std::pair<NDFValue, NDFValue>> values;
+
+  bool operator==(const NDFMapValue &) const = default;
+};
+
+// the items are boxed, a pair can't hold NDFValue inline
+struct NDFPairValue {
+  static constexpr uint32_t ndf_type = NDFPropertyType::Pair;
+  std::unique_ptr<NDFValue> first;
+  std::unique_ptr<NDFValue> second;
+
+  NDFPairValue();
+  NDFPairValue(NDFValue first, NDFValue second);
+  NDFPairValue(const NDFPairValue &other);
+  NDFPairValue &operator=(const NDFPairValue &other);
+  NDFPairValue(NDFPairValue &&) noexcept = default;
+  NDFPairValue &operator=(NDFPairValue &&) noexcept = default;
+  ~NDFPairValue();
+
+  bool operator==(const NDFPairValue &other) const;
+};
+
+// value of a property without the class hierarchy: a tagged union that
+// dispatches with a switch over its alternatives instead of virtual calls,
+// and decodes without allocating per scalar. NDFProperty trees convert to
+// and from it, the property name and index stay with the caller
+struct NDFValue {
+  using Storage =
+      std::variant<NDFBoolValue, NDFUInt8Value, NDFInt16Value, NDFUInt16Value,
+                   NDFInt32Value, NDFUInt32Value, NDFFloat32Value,
+                   NDFFloat64Value, NDFStringValue, NDFPathReferenceValue,
+                   NDFWideStringValue, NDFF32Vec2Value, NDFF32Vec3Value,
+                   NDFF32Vec4Value, NDFS32Vec2Value, NDFS32Vec3Value,
+                   NDFColorValue, NDFGUIDValue, NDFLocalisationHashValue,
+                   NDFHashValue, NDFObjectReferenceValue,
+                   NDFImportReferenceValue, NDFListValue, NDFMapValue,
+                   NDFPairValue>;
+  Storage data;
+
+  NDFValue() = default;
+  template <typename T>
+    requires(!std::is_same_v<std::decay_t<T>, NDFValue> &&
+             std::is_constructible_v<Storage, T &&>)
+  NDFValue(T &&payload) : data(std::forward<T>(payload)) {}
+
+  [[nodiscard]] uint32_t ndf_type() const {
+    return std::visit([](const auto &payload) { return payload.ndf_type; },
+                      data);
+  }
+  template <typename T> [[nodiscard]] bool is() const {
+    return std::holds_alternative<T>(data);
+  }
+  template <typename T> [[nodiscard]] T &get() { return std::get<T>(data); }
+  template <typename T> [[nodiscard]] const T &get() const {
+    return std::get<T>(data);
+  }
+  template <typename T> [[nodiscard]] T *get_if() {
+    return std::get_if<T>(&data);
+  }
+  template <typename T> [[nodiscard]] const T *get_if() const {
+    return std::get_if<T>(&data);
+  }
+
+  // the value of ndf_type at the cursor, the type itself has been read
+  static NDFValue from_ndfbin(uint32_t ndf_type, BinaryCursor &cursor,
+                              const NDF &root);
+  // writes the value without its type, like NDFProperty::to_ndfbin
+  void to_ndfbin(NDF &root, BinaryWriter &writer) const;
+  // same text as NDFProperty::as_string
+  [[nodiscard]] std::string as_string() const;
+
+  static NDFValue from_property(const NDFProperty &property);
+  // items of containers get the names the ndfbin loader gives them
+  [[nodiscard]] NDFPropertyPtr
+  to_property(std::pmr::memory_resource *arena = nullptr) const;
+
+  // calls f with the name of every object reference in this value tree
+  template <typename F> void for_each_object_reference(F &&f) {
+    for_each<NDFObjectReferenceValue>(
+        [&](NDFObjectReferenceValue &ref) { f(ref.object_name); });
+  }
+  template <typename F> void for_each_import_reference(F &&f) {
+    for_each<NDFImportReferenceValue>(
+        [&](NDFImportReferenceValue &ref) { f(ref.import_name); });
+  }
+
+  // calls f with every payload of type T in this value tree
+  template <typename T, typename F> void for_each(F &&f) {
+    std::visit(
+        [&](auto &payload) {
+          using P = std::decay_t<decltype(payload)>;
+          if constexpr (std::is_same_v<P, T>) {
+            f(payload);
+          }
+          if constexpr (std::is_same_v<P, NDFListValue>) {
+            for (auto &value : payload.values) {
+              value.template for_each<T>(f);
+            }
+          } else if constexpr (std::is_same_v<P, NDFMapValue>) {
+            for (auto &[key, value] : payload.values) {
+              key.template for_each<T>(f);
+              value.template for_each<T>(f);
+            }
+          } else if constexpr (std::is_same_v<P, NDFPairValue>) {
+            payload.first->template for_each<T>(f);
+            payload.second->template for_each<T>(f);
+          }
+        },
+        data);
+  }
+
+  bool operator==(const NDFValue &) const = default;
+};
+
+inline NDFPairValue::NDFPairValue()
+    : first(std::make_unique<NDFValue>()),
+      second(std::make_unique<NDFValue>()) {}
+inline NDFPairValue::NDFPairValue(NDFValue first, NDFValue second)
+    : first(std::make_unique<NDFValue>(std::move(first))),
+      second(std::make_unique<NDFValue>(std::move(second))) {}
+inline NDFPairValue::NDFPairValue(const NDFPairValue &other)
+    : first(std::make_unique<NDFValue>(*other.first)),
+      second(std::make_unique<NDFValue>(*other.second)) {}
+inline NDFPairValue &NDFPairValue::operator=(const NDFPairValue &other) {
+  if (this != &other) {
+    first = std::make_unique<NDFValue>(*other.first);
+    second = std::make_unique<NDFValue>(*other.second);
+  }
+  return *this;
+}
+inline NDFPairValue::~NDFPairValue() = default;
+inline bool NDFPairValue::operator==(const NDFPairValue &other) const {
+  return *first == *other.first && *second == *other.second;
+}
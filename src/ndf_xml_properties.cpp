@@ -1,77 +1,79 @@
 #include "ndf.hpp"
+#include "ndf_xml_writer.hpp"
 #include "utf.hpp"
 
-std::unique_ptr<NDFProperty>
-NDFProperty::get_property_from_ndftype(uint32_t ndf_type) {
+NDFPropertyPtr
+NDFProperty::get_property_from_ndftype(uint32_t ndf_type,
+                                       std::pmr::memory_resource *arena) {
   switch (ndf_type) {
   case 0x0: {
-    return std::make_unique<NDFPropertyBool>();
+    return make_ndf_property<NDFPropertyBool>(arena);
   }
   case 0x1: {
-    return std::make_unique<NDFPropertyUInt8>();
+    return make_ndf_property<NDFPropertyUInt8>(arena);
   }
   case 0x2: {
-    return std::make_unique<NDFPropertyInt32>();
+    return make_ndf_property<NDFPropertyInt32>(arena);
   }
   case 0x3: {
-    return std::make_unique<NDFPropertyUInt32>();
+    return make_ndf_property<NDFPropertyUInt32>(arena);
   }
   case 0x5: {
-    return std::make_unique<NDFPropertyFloat32>();
+    return make_ndf_property<NDFPropertyFloat32>(arena);
   }
   case 0x6: {
-    return std::make_unique<NDFPropertyFloat64>();
+    return make_ndf_property<NDFPropertyFloat64>(arena);
   }
   case 0x7: {
-    return std::make_unique<NDFPropertyString>();
+    return make_ndf_property<NDFPropertyString>(arena);
   }
   case 0x8: {
-    return std::make_unique<NDFPropertyWideString>();
+    return make_ndf_property<NDFPropertyWideString>(arena);
   }
   case 0xB: {
-    return std::make_unique<NDFPropertyF32_vec3>();
+    return make_ndf_property<NDFPropertyF32_vec3>(arena);
   }
   case 0xC: {
-    return std::make_unique<NDFPropertyF32_vec4>();
+    return make_ndf_property<NDFPropertyF32_vec4>(arena);
   }
   case 0xD: {
-    return std::make_unique<NDFPropertyColor>();
+    return make_ndf_property<NDFPropertyColor>(arena);
   }
   case 0xE: {
-    return std::make_unique<NDFPropertyS32_vec3>();
+    return make_ndf_property<NDFPropertyS32_vec3>(arena);
   }
   case 0x11: {
-    return std::make_unique<NDFPropertyList>();
+    return make_ndf_property<NDFPropertyList>(arena);
   }
   case 0x12: {
-    return std::make_unique<NDFPropertyMap>();
+    return make_ndf_property<NDFPropertyMap>(arena);
   }
   case 0x18: {
-    return std::make_unique<NDFPropertyInt16>();
+    return make_ndf_property<NDFPropertyInt16>(arena);
   }
   case 0x19: {
-    return std::make_unique<NDFPropertyUInt16>();
+    return make_ndf_property<NDFPropertyUInt16>(arena);
   }
   case 0x1A: {
-    return std::make_unique<NDFPropertyGUID>();
+    return make_ndf_property<NDFPropertyGUID>(arena);
   }
   case 0x1C: {
-    return std::make_unique<NDFPropertyPathReference>();
+    return make_ndf_property<NDFPropertyPathReference>(arena);
   }
   case 0x1D: {
-    return std::make_unique<NDFPropertyLocalisationHash>();
+    return make_ndf_property<NDFPropertyLocalisationHash>(arena);
   }
   case 0x1F: {
-    return std::make_unique<NDFPropertyS32_vec2>();
+    return make_ndf_property<NDFPropertyS32_vec2>(arena);
   }
   case 0x21: {
-    return std::make_unique<NDFPropertyF32_vec2>();
+    return make_ndf_property<NDFPropertyF32_vec2>(arena);
   }
   case 0x22: {
-    return std::make_unique<NDFPropertyPair>();
+    return make_ndf_property<NDFPropertyPair>(arena);
   }
   case 0x25: {
-    return std::make_unique<NDFPropertyHash>();
+    return make_ndf_property<NDFPropertyHash>(arena);
   }
   default: {
     throw std::runtime_error(std::format("Unknown NDFType: {}", ndf_type));
@@ -79,7 +81,7 @@ NDFProperty::get_property_from_ndftype(uint32_t ndf_type) {
   }
 }
 
-std::unique_ptr<NDFProperty>
+NDFPropertyPtr
 NDFProperty::get_property_from_ndf_xml(uint32_t ndf_type,
                                        const pugi::xml_node &ndf_node) {
   if (ndf_type == 0x9) {
@@ -102,6 +104,12 @@ void NDFPropertyBool::to_ndf_xml(pugi::xml_node &node) const {
   bool_node.append_attribute("value").set_value(value);
   bool_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyBool::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyBool::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_bool();
@@ -113,6 +121,12 @@ void NDFPropertyUInt8::to_ndf_xml(pugi::xml_node &node) const {
   int8_node.append_attribute("value").set_value(value);
   int8_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyUInt8::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyUInt8::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_int();
@@ -124,6 +138,12 @@ void NDFPropertyInt32::to_ndf_xml(pugi::xml_node &node) const {
   int32_node.append_attribute("value").set_value(value);
   int32_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyInt32::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyInt32::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_int();
@@ -135,6 +155,12 @@ void NDFPropertyUInt32::to_ndf_xml(pugi::xml_node &node) const {
   uint32_node.append_attribute("value").set_value(value);
   uint32_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyUInt32::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyUInt32::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_uint();
@@ -146,6 +172,12 @@ void NDFPropertyFloat32::to_ndf_xml(pugi::xml_node &node) const {
   float32_node.append_attribute("value").set_value(value);
   float32_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyFloat32::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyFloat32::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_float();
@@ -157,6 +189,12 @@ void NDFPropertyFloat64::to_ndf_xml(pugi::xml_node &node) const {
   float64_node.append_attribute("value").set_value(value);
   float64_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyFloat64::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyFloat64::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_double();
@@ -168,6 +206,12 @@ void NDFPropertyString::to_ndf_xml(pugi::xml_node &node) const {
   string_node.append_attribute("value").set_value(value.c_str());
   string_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyString::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyString::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_string();
@@ -179,6 +223,12 @@ void NDFPropertyWideString::to_ndf_xml(pugi::xml_node &node) const {
   wide_string_node.append_attribute("str").set_value(value.c_str());
   wide_string_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyWideString::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("str", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyWideString::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("str").as_string();
@@ -192,6 +242,14 @@ void NDFPropertyF32_vec3::to_ndf_xml(pugi::xml_node &node) const {
   f32_vec3_node.append_attribute("z").set_value(z);
   f32_vec3_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyF32_vec3::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("x", x);
+  writer.attribute("y", y);
+  writer.attribute("z", z);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyF32_vec3::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   x = node.attribute("x").as_float();
@@ -208,6 +266,15 @@ void NDFPropertyF32_vec4::to_ndf_xml(pugi::xml_node &node) const {
   f32_vec4_node.append_attribute("w").set_value(w);
   f32_vec4_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyF32_vec4::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("x", x);
+  writer.attribute("y", y);
+  writer.attribute("z", z);
+  writer.attribute("w", w);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyF32_vec4::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   x = node.attribute("x").as_float();
@@ -225,6 +292,15 @@ void NDFPropertyColor::to_ndf_xml(pugi::xml_node &node) const {
   color_node.append_attribute("a").set_value(a);
   color_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyColor::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("r", r);
+  writer.attribute("g", g);
+  writer.attribute("b", b);
+  writer.attribute("a", a);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyColor::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   r = node.attribute("r").as_uint();
@@ -241,6 +317,14 @@ void NDFPropertyS32_vec3::to_ndf_xml(pugi::xml_node &node) const {
   s32_vec3_node.append_attribute("z").set_value(z);
   s32_vec3_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyS32_vec3::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("x", x);
+  writer.attribute("y", y);
+  writer.attribute("z", z);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyS32_vec3::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   x = node.attribute("x").as_int();
@@ -255,6 +339,13 @@ void NDFPropertyObjectReference::to_ndf_xml(pugi::xml_node &node) const {
   reference_node.append_attribute("typeId").set_value(property_type);
   reference_node.append_attribute("referenceType").set_value("object");
 }
+void NDFPropertyObjectReference::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("object", object_name);
+  writer.attribute("typeId", property_type);
+  writer.attribute("referenceType", "object");
+  writer.end_element();
+}
 void NDFPropertyObjectReference::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   object_name = node.attribute("object").as_string();
@@ -268,6 +359,13 @@ void NDFPropertyImportReference::to_ndf_xml(pugi::xml_node &node) const {
   reference_node.append_attribute("typeId").set_value(property_type);
   reference_node.append_attribute("referenceType").set_value("import");
 }
+void NDFPropertyImportReference::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("import", import_name);
+  writer.attribute("typeId", property_type);
+  writer.attribute("referenceType", "import");
+  writer.end_element();
+}
 void NDFPropertyImportReference::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   import_name = node.attribute("import").as_string();
@@ -282,6 +380,14 @@ void NDFPropertyList::to_ndf_xml(pugi::xml_node &node) const {
     value->to_ndf_xml(list_node);
   }
 }
+void NDFPropertyList::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("typeId", property_type);
+  for (auto const &value : values) {
+    value->to_ndf_xml(writer);
+  }
+  writer.end_element();
+}
 void NDFPropertyList::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   for (auto const &value_node : node.children()) {
@@ -300,6 +406,17 @@ void NDFPropertyMap::to_ndf_xml(pugi::xml_node &node) const {
     value->to_ndf_xml(map_items_node);
   }
 }
+void NDFPropertyMap::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("typeId", property_type);
+  for (auto const &[key, value] : values) {
+    writer.start_element("MapItem");
+    key->to_ndf_xml(writer);
+    value->to_ndf_xml(writer);
+    writer.end_element();
+  }
+  writer.end_element();
+}
 void NDFPropertyMap::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   for (auto const &map_item_node : node.children()) {
@@ -323,6 +440,12 @@ void NDFPropertyInt16::to_ndf_xml(pugi::xml_node &node) const {
   s16_node.append_attribute("value").set_value(value);
   s16_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyInt16::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyInt16::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_int();
@@ -334,6 +457,12 @@ void NDFPropertyUInt16::to_ndf_xml(pugi::xml_node &node) const {
   u16_node.append_attribute("value").set_value(value);
   u16_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyUInt16::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("value", value);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyUInt16::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   value = node.attribute("value").as_uint();
@@ -345,6 +474,12 @@ void NDFPropertyGUID::to_ndf_xml(pugi::xml_node &node) const {
   guid_node.append_attribute("guid").set_value(guid.c_str());
   guid_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyGUID::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("guid", guid);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyGUID::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   guid = node.attribute("guid").as_string();
@@ -356,6 +491,12 @@ void NDFPropertyPathReference::to_ndf_xml(pugi::xml_node &node) const {
   path_node.append_attribute("typeId").set_value(property_type);
   path_node.append_attribute("path").set_value(path.c_str());
 }
+void NDFPropertyPathReference::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("typeId", property_type);
+  writer.attribute("path", path);
+  writer.end_element();
+}
 void NDFPropertyPathReference::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   path = node.attribute("path").as_string();
@@ -367,6 +508,12 @@ void NDFPropertyLocalisationHash::to_ndf_xml(pugi::xml_node &node) const {
   hash_node.append_attribute("hash").set_value(hash.c_str());
   hash_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyLocalisationHash::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("hash", hash);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyLocalisationHash::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   hash = node.attribute("hash").as_string();
@@ -379,6 +526,13 @@ void NDFPropertyS32_vec2::to_ndf_xml(pugi::xml_node &node) const {
   s32_vec2_node.append_attribute("y").set_value(y);
   s32_vec2_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyS32_vec2::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("x", x);
+  writer.attribute("y", y);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyS32_vec2::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   x = node.attribute("x").as_int();
@@ -392,6 +546,13 @@ void NDFPropertyF32_vec2::to_ndf_xml(pugi::xml_node &node) const {
   f32_vec2_node.append_attribute("y").set_value(y);
   f32_vec2_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyF32_vec2::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("x", x);
+  writer.attribute("y", y);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyF32_vec2::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   x = node.attribute("x").as_float();
@@ -405,6 +566,13 @@ void NDFPropertyPair::to_ndf_xml(pugi::xml_node &node) const {
   first->to_ndf_xml(pair_node);
   second->to_ndf_xml(pair_node);
 }
+void NDFPropertyPair::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("typeId", property_type);
+  first->to_ndf_xml(writer);
+  second->to_ndf_xml(writer);
+  writer.end_element();
+}
 void NDFPropertyPair::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   assert(node.attribute("typeId").as_uint() == property_type);
@@ -425,6 +593,12 @@ void NDFPropertyHash::to_ndf_xml(pugi::xml_node &node) const {
   hash_node.append_attribute("hash").set_value(hash.c_str());
   hash_node.append_attribute("typeId").set_value(property_type);
 }
+void NDFPropertyHash::to_ndf_xml(NDFXmlWriter &writer) const {
+  writer.start_element(property_name.str());
+  writer.attribute("hash", hash);
+  writer.attribute("typeId", property_type);
+  writer.end_element();
+}
 void NDFPropertyHash::from_ndf_xml(const pugi::xml_node &node) {
   property_name = node.name();
   hash = node.attribute("hash").as_string();
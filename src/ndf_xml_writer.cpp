@@ -0,0 +1,122 @@
+#include "ndf_xml_writer.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+NDFXmlWriter::NDFXmlWriter(std::ostream &stream) : m_stream(stream) {
+  m_buffer.reserve(flush_size + 4096);
+  m_buffer.append("<?xml version=\"1.0\"?>\n");
+}
+
+NDFXmlWriter::~NDFXmlWriter() {
+  try {
+    finish();
+  } catch (...) {
+    // destructors must not throw, call finish to see errors
+  }
+}
+
+// escapes like pugixml does for attribute values: &, < and " as entities,
+// control characters as numeric references, everything else is kept
+void NDFXmlWriter::write_escaped(std::string_view value) {
+  size_t start = 0;
+  for (size_t i = 0; i < value.size(); i++) {
+    unsigned char c = value[i];
+    if (c >= 32 && c != '&' && c != '<' && c != '"') {
+      continue;
+    }
+    m_buffer.append(value.substr(start, i - start));
+    start = i + 1;
+    switch (c) {
+    case '&':
+      m_buffer.append("&amp;");
+      break;
+    case '<':
+      m_buffer.append("&lt;");
+      break;
+    case '"':
+      m_buffer.append("&quot;");
+      break;
+    default:
+      m_buffer.append("&#");
+      m_buffer.push_back(char('0' + c / 10));
+      m_buffer.push_back(char('0' + c % 10));
+      m_buffer.push_back(';');
+      break;
+    }
+  }
+  m_buffer.append(value.substr(start));
+}
+
+void NDFXmlWriter::close_start_tag() {
+  if (m_in_start_tag) {
+    m_buffer.append(">\n");
+    m_in_start_tag = false;
+  }
+}
+
+void NDFXmlWriter::start_element(std::string_view name) {
+  close_start_tag();
+  flush_if_full();
+  write_indent(m_open_elements.size());
+  m_buffer.push_back('<');
+  // pugixml writes nodes without a name as :anonymous
+  m_open_elements.emplace_back(name.empty() ? ":anonymous" : name);
+  m_buffer.append(m_open_elements.back());
+  m_in_start_tag = true;
+}
+
+void NDFXmlWriter::end_element() {
+  if (m_open_elements.empty()) {
+    throw std::runtime_error("NDFXmlWriter: no element to end");
+  }
+  if (m_in_start_tag) {
+    m_buffer.append(" />\n");
+    m_in_start_tag = false;
+  } else {
+    write_indent(m_open_elements.size() - 1);
+    m_buffer.append("</");
+    m_buffer.append(m_open_elements.back());
+    m_buffer.append(">\n");
+  }
+  m_open_elements.pop_back();
+}
+
+void NDFXmlWriter::attribute(std::string_view name, std::string_view value) {
+  if (!m_in_start_tag) {
+    throw std::runtime_error(
+        "NDFXmlWriter: attributes have to follow start_element");
+  }
+  m_buffer.push_back(' ');
+  m_buffer.append(name);
+  m_buffer.append("=\"");
+  write_escaped(value);
+  m_buffer.push_back('"');
+}
+
+void NDFXmlWriter::attribute(std::string_view name, float value) {
+  char buf[128];
+  std::snprintf(buf, sizeof(buf), "%.*g", 9, double(value));
+  attribute(name, std::string_view(buf));
+}
+
+void NDFXmlWriter::attribute(std::string_view name, double value) {
+  char buf[128];
+  std::snprintf(buf, sizeof(buf), "%.*g", 17, value);
+  attribute(name, std::string_view(buf));
+}
+
+void NDFXmlWriter::finish() {
+  while (!m_open_elements.empty()) {
+    end_element();
+  }
+  flush();
+}
+
+void NDFXmlWriter::flush() {
+  m_stream.write(m_buffer.data(), m_buffer.size());
+  m_buffer.clear();
+  if (!m_stream) {
+    throw std::runtime_error("NDFXmlWriter: failed to write");
+  }
+}
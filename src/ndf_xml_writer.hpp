@@ -0,0 +1,68 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// streaming writer for the ndf xml format. writes the same bytes as
+// pugi::xml_document::save with the default flags (tab indentation, no BOM),
+// but only ever holds a small buffer and the names of the open elements
+// instead of the whole document
+class NDFXmlWriter {
+private:
+  std::ostream &m_stream;
+  std::string m_buffer;
+  std::vector<std::string> m_open_elements;
+  // the start tag of the innermost element is not closed yet, attributes can
+  // still be added
+  bool m_in_start_tag = false;
+
+  static constexpr size_t flush_size = 1 << 16;
+
+  void write_escaped(std::string_view value);
+  void write_indent(size_t depth) { m_buffer.append(depth, '\t'); }
+  void close_start_tag();
+  void flush_if_full() {
+    if (m_buffer.size() >= flush_size) {
+      flush();
+    }
+  }
+
+public:
+  // writes the xml declaration
+  explicit NDFXmlWriter(std::ostream &stream);
+  ~NDFXmlWriter();
+
+  NDFXmlWriter(const NDFXmlWriter &) = delete;
+  NDFXmlWriter &operator=(const NDFXmlWriter &) = delete;
+
+  void start_element(std::string_view name);
+  void end_element();
+
+  void attribute(std::string_view name, std::string_view value);
+  void attribute(std::string_view name, const char *value) {
+    attribute(name, std::string_view(value));
+  }
+  void attribute(std::string_view name, const std::string &value) {
+    attribute(name, std::string_view(value));
+  }
+  template <std::integral T> void attribute(std::string_view name, T value) {
+    if constexpr (std::same_as<T, bool>) {
+      attribute(name, std::string_view(value ? "true" : "false"));
+    } else if constexpr (std::is_signed_v<T>) {
+      attribute(name, std::to_string(int64_t(value)));
+    } else {
+      attribute(name, std::to_string(uint64_t(value)));
+    }
+  }
+  // same precision as pugixml, 9 digits for float and 17 for double
+  void attribute(std::string_view name, float value);
+  void attribute(std::string_view name, double value);
+
+  // closes all open elements and writes the buffer to the stream
+  void finish();
+  void flush();
+};
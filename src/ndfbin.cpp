@@ -1,12 +1,19 @@
 #include "ndf.hpp"
 
-#include <set>
-
+#include "binary_cursor.hpp"
+#include "binary_writer.hpp"
+#include "mapped_file.hpp"
+#include "positional_file.hpp"
 #include "utf.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 #pragma pack(push, 1)
 struct NDFBinHeader {
@@ -58,17 +65,179 @@ struct NDF_Type {
 };
 #pragma pack(pop)
 
-void NDF::load_from_ndfbin(fs::path path) {
-  std::ifstream file(path, std::ios::binary | std::ios::in);
-  if (!file.is_open()) {
-    throw std::runtime_error("Failed to open file");
+void NDF::load_from_ndfbin(fs::path path, unsigned jobs) {
+  MappedFile file(path);
+  load_from_ndfbin_buffer(file.data(), jobs);
+}
+
+void NDF::load_from_ndfbin_stream(std::istream &stream, unsigned jobs) {
+  // slurp the stream and hand it to the buffer loader, offsets inside the
+  // ndfbin are relative to the current stream position
+  std::vector<std::byte> buffer;
+  constexpr size_t chunk_size = 1 << 16;
+  while (stream) {
+    size_t old_size = buffer.size();
+    buffer.resize(old_size + chunk_size);
+    stream.read(reinterpret_cast<char *>(buffer.data() + old_size),
+                chunk_size);
+    buffer.resize(old_size + stream.gcount());
   }
-  load_from_ndfbin_stream(file);
+  load_from_ndfbin_buffer(buffer, jobs);
 }
 
-void NDF::load_from_ndfbin_stream(std::istream &file) {
-  NDFBinHeader header;
-  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+NDFObject NDF::object_from_ndfbin(BinaryCursor &file, size_t object_idx) {
+  auto obj = file.read<NDF_Object>();
+
+  NDFObject object(get_property_arena());
+  object.name = "Object_" + std::to_string(object_idx);
+  object.class_name = class_table.at(obj.classIndex);
+
+  spdlog::debug("0x{:02X} Object: {} ({})", file.tell(), object.name,
+                object.class_name);
+
+  properties_from_ndfbin(file, object);
+  return object;
+}
+
+void NDF::properties_from_ndfbin(BinaryCursor &file, NDFObject &object) {
+  while (true) {
+    auto prop = file.read<NDF_Property>();
+    if (prop.propertyIndex == 2880154539) {
+      break;
+    }
+    auto ndf_type = file.read<NDF_Type>().typeIndex;
+
+    auto property = NDFProperty::get_property_from_ndfbin(
+        ndf_type, file, get_property_arena());
+    property->from_ndfbin(this, file);
+    property->property_name = property_table.at(prop.propertyIndex).first;
+    property->property_idx = prop.propertyIndex;
+
+    object.add_property(std::move(property));
+  }
+}
+
+// skips the properties of an object, only reads types and sizes
+static void skip_ndfbin_properties(BinaryCursor &cursor) {
+  while (cursor.read<NDF_Property>().propertyIndex != 2880154539) {
+    NDFProperty::skip_ndfbin(cursor.read<NDF_Type>().typeIndex, cursor);
+  }
+}
+
+void NDF::load_ndfbin_objects_parallel(BinaryCursor &file, size_t end_offset,
+                                       unsigned jobs) {
+  // objects only end at their terminator, so a first pass skips over the
+  // properties reading nothing but types and sizes to find where every
+  // object starts
+  std::vector<size_t> starts;
+  BinaryCursor scan = file;
+  while (scan.tell() < end_offset) {
+    starts.push_back(scan.tell());
+    scan.skip(sizeof(NDF_Object));
+    skip_ndfbin_properties(scan);
+  }
+  size_t object_count = starts.size();
+  starts.push_back(scan.tell());
+
+  // every thread decodes a contiguous range of the objects into its own
+  // vector with its own arena. decoding only reads the string, import,
+  // class and property tables, they are complete at this point
+  jobs = std::clamp<unsigned>(jobs, 1, std::max<size_t>(object_count, 1));
+  std::vector<std::vector<NDFObject>> partitions(jobs);
+  std::vector<std::exception_ptr> errors(jobs);
+  size_t first_object = object_map.size();
+  size_t chunk = (object_count + jobs - 1) / jobs;
+  for (unsigned i = 0; i < jobs; i++) {
+    worker_arenas.push_back(
+        std::make_unique<std::pmr::monotonic_buffer_resource>());
+  }
+  std::span arenas(worker_arenas.end() - jobs, worker_arenas.end());
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < jobs; i++) {
+    threads.emplace_back([&, i]() {
+      size_t begin = std::min(object_count, i * chunk);
+      size_t end = std::min(object_count, begin + chunk);
+      thread_property_arena = arenas[i].get();
+      try {
+        BinaryCursor cursor = file;
+        cursor.seek(starts[begin]);
+        partitions[i].reserve(end - begin);
+        for (size_t idx = begin; idx < end; idx++) {
+          partitions[i].push_back(
+              object_from_ndfbin(cursor, first_object + idx));
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+      thread_property_arena = nullptr;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  object_map.reserve(first_object + object_count);
+  for (auto &partition : partitions) {
+    for (auto &object : partition) {
+      add_object(std::move(object));
+    }
+  }
+  file.seek(starts.back());
+}
+
+void NDF::load_from_ndfbin_buffer(std::span<const std::byte> data,
+                                  unsigned jobs) {
+  load_ndfbin(data, jobs, false);
+}
+
+void NDF::load_from_ndfbin_lazy(fs::path path) {
+  // pending objects point into the current mapping
+  load_lazy_objects();
+  invalidate_reference_index();
+  lazy_file = MappedFile(path);
+  load_ndfbin(lazy_file.data(), 1, true);
+  if (lazy_objects.empty()) {
+    lazy_file = MappedFile();
+  }
+}
+
+void NDF::decode_lazy_object(NDFObject &object) {
+  auto it = lazy_objects.find(object.name);
+  if (it == lazy_objects.end()) {
+    return;
+  }
+  BinaryCursor cursor(lazy_file.data());
+  cursor.seek(it->second);
+  try {
+    properties_from_ndfbin(cursor, object);
+  } catch (...) {
+    // the object stays pending without the properties decoded so far
+    object.properties.clear();
+    object.property_map.clear();
+    throw;
+  }
+  lazy_objects.erase(it);
+  if (lazy_objects.empty()) {
+    lazy_file = MappedFile();
+  }
+}
+
+void NDF::load_lazy_objects() {
+  // decode_lazy_object erases from lazy_objects
+  while (!lazy_objects.empty()) {
+    decode_lazy_object(object_map.at(lazy_objects.begin()->first));
+  }
+}
+
+void NDF::load_ndfbin(std::span<const std::byte> data, unsigned jobs,
+                      bool lazy) {
+  BinaryCursor file(data);
+  auto header = file.read<NDFBinHeader>();
 
   if (header.magic[0] != 'E' || header.magic[1] != 'U' ||
       header.magic[2] != 'G' || header.magic[3] != '0') {
@@ -84,9 +253,8 @@ void NDF::load_from_ndfbin_stream(std::istream &file) {
     throw std::runtime_error("Invalid header size");
   }
 
-  TOCTable toc;
-  file.seekg(header.toc0offset);
-  file.read(reinterpret_cast<char *>(&toc), sizeof(toc));
+  file.seek(header.toc0offset);
+  auto toc = file.read<TOCTable>();
 
   if (toc.magic[0] != 'T' || toc.magic[1] != 'O' || toc.magic[2] != 'C' ||
       toc.magic[3] != '0') {
@@ -97,375 +265,297 @@ void NDF::load_from_ndfbin_stream(std::istream &file) {
     throw std::runtime_error("Invalid TOC count");
   }
 
+  // positions the cursor at the start of the section and returns its end
+  auto seek_section = [&](const TOCTableEntry &entry) -> size_t {
+    size_t end_offset = (size_t)entry.offset + entry.size;
+    if (end_offset > data.size()) {
+      throw std::runtime_error(std::format(
+          "Invalid TOC entry {}: 0x{:02X}+0x{:02X} past end of file",
+          std::string_view(entry.magic, 4), entry.offset, entry.size));
+    }
+    file.seek(entry.offset);
+    return end_offset;
+  };
+
   // load class names
-  file.seekg(toc.CLAS.offset);
-  uint32_t clas_endoffset = toc.CLAS.offset + toc.CLAS.size;
-  while ((uint32_t)file.tellg() < clas_endoffset) {
-    uint32_t length;
-    file.read(reinterpret_cast<char *>(&length), sizeof(length));
-    std::string class_name;
-    class_name.resize(length);
-    file.read(class_name.data(), length * sizeof(char));
-    class_table.push_back(class_name);
+  size_t clas_endoffset = seek_section(toc.CLAS);
+  while (file.tell() < clas_endoffset) {
+    auto length = file.read<uint32_t>();
+    auto &class_name = class_table.emplace_back(file.read_string(length));
     spdlog::debug("Class: {}", class_name);
   }
 
   // load strings
-  file.seekg(toc.STRG.offset);
-  uint32_t strg_endoffset = toc.STRG.offset + toc.STRG.size;
-  while ((uint32_t)file.tellg() < strg_endoffset) {
-    uint32_t length;
-    file.read(reinterpret_cast<char *>(&length), sizeof(length));
-    std::string string;
-    string.resize(length);
-    file.read(string.data(), length * sizeof(char));
-    string_table.push_back(string);
+  size_t strg_endoffset = seek_section(toc.STRG);
+  while (file.tell() < strg_endoffset) {
+    auto length = file.read<uint32_t>();
+    auto &string = string_table.emplace_back(file.read_string(length));
     spdlog::debug("String: {}", string);
   }
 
   // load tran table
-  file.seekg(toc.TRAN.offset);
-  uint32_t tran_endoffset = toc.TRAN.offset + toc.TRAN.size;
-  while ((uint32_t)file.tellg() < tran_endoffset) {
-    uint32_t length;
-    file.read(reinterpret_cast<char *>(&length), sizeof(length));
-    std::string string;
-    string.resize(length);
-    file.read(string.data(), length * sizeof(char));
+  size_t tran_endoffset = seek_section(toc.TRAN);
+  while (file.tell() < tran_endoffset) {
+    auto length = file.read<uint32_t>();
+    auto &string = tran_table.emplace_back(file.read_string(length));
     spdlog::debug("Tran: {}", string);
-    tran_table.push_back(string);
   }
 
   // load properties
-  file.seekg(toc.PROP.offset);
-  uint32_t prop_endoffset = toc.PROP.offset + toc.PROP.size;
-  while ((uint32_t)file.tellg() < prop_endoffset) {
-    uint32_t str_len;
-    file.read(reinterpret_cast<char *>(&str_len), sizeof(str_len));
-    std::string prop_name;
-    prop_name.resize(str_len);
-    file.read(prop_name.data(), str_len * sizeof(char));
-    uint32_t class_idx;
-    file.read(reinterpret_cast<char *>(&class_idx), sizeof(class_idx));
+  size_t prop_endoffset = seek_section(toc.PROP);
+  while (file.tell() < prop_endoffset) {
+    auto str_len = file.read<uint32_t>();
+    NDFPropertyName prop_name(file.read_string(str_len));
+    auto class_idx = file.read<uint32_t>();
     spdlog::debug("Property: {} {}", prop_name, class_idx);
     property_table.emplace_back(prop_name, class_idx);
   }
 
   // load imports
-  file.seekg(toc.IMPR.offset);
-  uint32_t impr_endoffset = toc.IMPR.offset + toc.IMPR.size;
-  while ((uint32_t)file.tellg() < impr_endoffset) {
+  size_t impr_endoffset = seek_section(toc.IMPR);
+  while (file.tell() < impr_endoffset) {
     load_imprs(file, {});
   }
 
   // load objects
-  file.seekg(toc.OBJE.offset);
-  spdlog::debug("0x{:02X} Object Table", (uint32_t)file.tellg());
-  uint32_t obje_endoffset = toc.OBJE.offset + toc.OBJE.size;
-  while ((uint32_t)file.tellg() < obje_endoffset) {
-    NDF_Object obj;
-    file.read(reinterpret_cast<char *>(&obj), sizeof(obj));
-
-    NDFObject object;
-    object.name = "Object_" + std::to_string(object_map.size());
-    obj.classIndex = obj.classIndex;
-    object.class_name = class_table[obj.classIndex];
-
-    spdlog::debug("0x{:02X} Object: {} ({})", (uint32_t)file.tellg(),
-                  object.name, object.class_name);
-
-    // load properties
-    NDF_Property prop{0};
-    while (prop.propertyIndex != 2880154539) {
-      file.read(reinterpret_cast<char *>(&prop), sizeof(prop));
-      if (prop.propertyIndex == 2880154539) {
-        break;
-      }
-      uint32_t ndf_type = 0xFFFFFFFF;
-      file.read(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-
-      auto property = NDFProperty::get_property_from_ndfbin(ndf_type, file);
-      property->from_ndfbin(this, file);
-      property->property_name = property_table[prop.propertyIndex].first;
-
-      object.add_property(std::move(property));
+  size_t obje_endoffset = seek_section(toc.OBJE);
+  spdlog::debug("0x{:02X} Object Table", file.tell());
+  if (lazy) {
+    // only the class index is read, the properties wait for get_object
+    while (file.tell() < obje_endoffset) {
+      auto obj = file.read<NDF_Object>();
+      NDFObject object(get_property_arena());
+      object.name = "Object_" + std::to_string(object_map.size());
+      object.class_name = class_table.at(obj.classIndex);
+      lazy_objects.emplace(object.name, file.tell());
+      skip_ndfbin_properties(file);
+      add_object(std::move(object));
+    }
+  } else if (jobs > 1) {
+    load_ndfbin_objects_parallel(file, obje_endoffset, jobs);
+  } else {
+    while (file.tell() < obje_endoffset) {
+      add_object(object_from_ndfbin(file, object_map.size()));
     }
-    add_object(std::move(object));
   }
 
   fill_gen_object();
 
   // load exports
-  file.seekg(toc.EXPR.offset);
-  uint32_t expr_endoffset = toc.EXPR.offset + toc.EXPR.size;
-  while ((uint32_t)file.tellg() < expr_endoffset) {
+  size_t expr_endoffset = seek_section(toc.EXPR);
+  while (file.tell() < expr_endoffset) {
     load_exprs(file, {});
   }
 
   // load TOPO
-  file.seekg(toc.TOPO.offset);
-  uint32_t topo_endoffset = toc.TOPO.offset + toc.TOPO.size;
-  while ((uint32_t)file.tellg() < topo_endoffset) {
-    uint32_t object_index;
-    file.read(reinterpret_cast<char *>(&object_index), sizeof(object_index));
-    object_map[gen_object_items[object_index]].is_top_object = true;
+  size_t topo_endoffset = seek_section(toc.TOPO);
+  while (file.tell() < topo_endoffset) {
+    auto object_index = file.read<uint32_t>();
+    object_map[gen_object_table.at(object_index)].is_top_object = true;
   }
 }
 
 void NDF::save_ndfbin_imprs(
-    const std::map<std::vector<uint32_t>, uint32_t> &gen_table,
-    std::ostream &stream) {
-  // we need for every node the count of the children of this node
-  std::map<std::vector<uint32_t>, uint32_t> count_table;
-  {
-    std::set<std::vector<uint32_t>> visited_subpaths;
-    for (const auto &[k, v] : gen_table) {
-      {
-        std::string key_str = "";
-        for (auto const &foo : k) {
-          key_str += gen_tran_table[foo] + "/";
-        }
-        spdlog::debug("count_table: {}", key_str);
-      }
-      std::vector<uint32_t> current_part = {k[0]};
-      for (const auto &i :
-           k | std::views::drop(1) | std::views::take(k.size() - 1)) {
-        std::vector<uint32_t> sub_part = current_part;
-        current_part.push_back(i);
-
-        if (visited_subpaths.find(current_part) == visited_subpaths.end()) {
-          if (count_table.find(sub_part) == count_table.end()) {
-            count_table[sub_part] = 1;
-          } else {
-            count_table[sub_part] += 1;
-          }
-          visited_subpaths.insert(current_part);
-        }
-        {
-          std::string key_str = "";
-          for (auto const &foo : sub_part) {
-            key_str += gen_tran_table[foo] + "/";
-          }
-          spdlog::debug("count_table import: {} -> {}", key_str,
-                        count_table[sub_part]);
-        }
-      }
-    }
+    const NDFIndexTable<std::vector<uint32_t>> &gen_table,
+    std::span<const uint32_t> values, BinaryWriter &writer) {
+  // the format needs the paths in sorted order, the table keeps them in order
+  // of first use
+  std::vector<std::pair<const std::vector<uint32_t> *, uint32_t>> sorted;
+  sorted.reserve(gen_table.size());
+  for (uint32_t idx = 0; idx < gen_table.size(); idx++) {
+    sorted.emplace_back(&gen_table[idx], values.empty() ? idx : values[idx]);
   }
-
-  std::vector<uint32_t> previous_import_path = {};
-  std::vector<std::pair<uint32_t, std::vector<uint32_t>>> previous_offsets = {};
-  for (const auto &[k, v] : gen_table) {
-    {
-      std::string key_str = "";
-      for (auto const &foo : k) {
-        key_str += gen_tran_table[foo] + "/";
-      }
-      spdlog::debug("Import: {} -> {}", key_str, v);
+  std::ranges::sort(sorted, [](const auto &a, const auto &b) {
+    return *a.first < *b.first;
+  });
+
+  // build the tree of the paths first. sorted paths create the nodes in the
+  // order they get written, every node before its children
+  struct Node {
+    uint32_t tran_index;
+    uint32_t index = 4294967295;
+    std::vector<uint32_t> children = {};
+    // bytes of the node and all of its children
+    uint32_t size = 0;
+  };
+  std::vector<Node> nodes;
+  // node of every element of the previous path
+  std::vector<uint32_t> stack;
+  std::span<const uint32_t> previous_path;
+  for (const auto &[path, v] : sorted) {
+    const auto &k = *path;
+    if (k.empty()) {
+      continue;
     }
-
-    // first we get the diff to the last run
-    int diff_point = 0;
-    std::vector<uint32_t> current_path;
-    for (unsigned int x = 0; x < k.size(); x++) {
-      if (x >= previous_import_path.size()) {
-        diff_point = x;
-        // spdlog::debug("diff_point size: {} {}", previous_import_path.size(),
-        // x);
-        break;
-      }
-      if (previous_import_path[x] != k[x]) {
-        diff_point = x;
-        // spdlog::debug("diff_point diff {} {}", previous_import_path[x],
-        // k[x]);
-        break;
-      }
-      // we do not add the item that differs
-      current_path.push_back(k[x]);
+    size_t common = 0;
+    while (common < k.size() && common < previous_path.size() &&
+           previous_path[common] == k[common]) {
+      common++;
     }
-    // now shorten the previous import_path and import xml nodes to the diff
-    // point
-    // spdlog::debug("diff_point: {}", diff_point);
-    {
-      std::string key_str = "";
-      for (auto const &foo : previous_import_path) {
-        key_str += gen_tran_table[foo] + "/";
+    stack.resize(common);
+    for (size_t x = common; x < k.size(); x++) {
+      uint32_t node = nodes.size();
+      nodes.push_back({k[x]});
+      if (!stack.empty()) {
+        nodes[stack.back()].children.push_back(node);
       }
-      spdlog::debug("before shorten prev Import path: {} -> {}", key_str, v);
+      stack.push_back(node);
     }
-    int diff = previous_offsets.size() - diff_point;
-    for (int x = 0; x < diff; x++) {
-      // fix previously empty offsets
-      auto &[offset, offsets] = previous_offsets.back();
-      uint32_t prev_loc = stream.tellp();
-      stream.seekp(offset);
-      stream.write(reinterpret_cast<char *>(offsets.data()),
-                   offsets.size() * sizeof(uint32_t));
-
-      {
-        std::string key_str = "";
-        for (auto const &foo : previous_import_path) {
-          key_str += gen_tran_table[foo] + "/";
-        }
-        // spdlog::debug("IMPORT: {} -> {}", key_str, v);
-      }
-
-      size_t count = count_table[previous_import_path];
-      spdlog::debug("COUNT {} {}", count, offsets.size());
-      assert(count == offsets.size());
-
-      spdlog::debug("WRITE offsets {} {} @0x{:02X}", previous_offsets.size(),
-                    previous_offsets.back().second.size(), (uint32_t)offset);
+    nodes[stack.back()].index = v;
+    previous_path = k;
+  }
 
-      stream.seekp(prev_loc);
-      previous_import_path.pop_back();
-      previous_offsets.pop_back();
-    }
-    {
-      std::string key_str = "";
-      for (auto const &foo : previous_import_path) {
-        key_str += gen_tran_table[foo] + "/";
-      }
-      // spdlog::debug("after shorten prev Import path: {} -> {}", key_str, v);
+  // children come after their parent, so going backwards every child size
+  // is known when the parent needs it
+  for (auto &node : nodes | std::views::reverse) {
+    node.size = 3 * sizeof(uint32_t) + node.children.size() * sizeof(uint32_t);
+    for (uint32_t child : node.children) {
+      node.size += nodes[child].size;
     }
-    assert(previous_offsets.size() == previous_import_path.size());
-
-    for (unsigned int x = diff_point; x < k.size(); x++) {
-      // if not first node, add offset to the offsets array
-      if (previous_offsets.size() != 0) {
-        auto &[offset, offsets] = previous_offsets.back();
-        offsets.push_back((uint32_t)stream.tellp() - offset);
-        spdlog::debug(
-            "ADD OFFSET prev_offsets @0x{:02X} {} offsets {} 0x{:02X}", offset,
-            previous_offsets.size(), offsets.size(), offsets.back());
-      }
+  }
 
-      // we now update the current_path and search for a possible import
-      current_path.push_back(k[x]);
-
-      // same layer -> add new node
-      // write tranIndex, index and count
-      uint32_t tranIndex = k[x];
-      uint32_t index = 4294967295;
-      // search for import
-      auto impr_index_it = gen_table.find(current_path);
-      if (impr_index_it != gen_table.end()) {
-        index = impr_index_it->second;
-      }
-      uint32_t count = count_table[current_path];
-
-      stream.write(reinterpret_cast<char *>(&tranIndex), sizeof(tranIndex));
-      stream.write(reinterpret_cast<char *>(&index), sizeof(index));
-      stream.write(reinterpret_cast<char *>(&count), sizeof(count));
-
-      // create offsets table
-      previous_offsets.push_back({stream.tellp(), {}});
-      spdlog::debug("ARRAY @0x{:02X} count {}", (uint32_t)stream.tellp(),
-                    count);
-      // write table with wrong info
-      std::vector<uint32_t> offsets;
-      offsets.resize(count);
-      stream.write(reinterpret_cast<char *>(offsets.data()),
-                   offsets.size() * sizeof(uint32_t));
-
-      {
-        std::string key_str = "";
-        for (auto const &foo : current_path) {
-          key_str += gen_tran_table[foo] + "/";
-        }
-        spdlog::debug("ARRAY IMPORT: {} -> {}", key_str, v);
-      }
+  // node: tranIndex, index, count and the offsets of the children, relative
+  // to the start of the offsets
+  for (const auto &node : nodes) {
+    writer.write(node.tran_index);
+    writer.write(node.index);
+    writer.write<uint32_t>(node.children.size());
+    uint32_t offset = node.children.size() * sizeof(uint32_t);
+    for (uint32_t child : node.children) {
+      writer.write(offset);
+      offset += nodes[child].size;
     }
+  }
+}
 
-    previous_import_path = current_path;
+struct NDFBinImage {
+  NDFBinHeader header;
+  BinaryWriter obje;
+  BinaryWriter topo;
+  BinaryWriter chnk;
+  BinaryWriter clas;
+  BinaryWriter prop;
+  BinaryWriter strg;
+  BinaryWriter tran;
+  BinaryWriter impr;
+  BinaryWriter expr;
+  TOCTable toc_table;
+
+  // header, sections and TOC in file order
+  [[nodiscard]] std::array<std::span<const std::byte>, 11> pieces() const {
+    return {std::as_bytes(std::span(&header, 1)),
+            obje.data(),
+            topo.data(),
+            chnk.data(),
+            clas.data(),
+            prop.data(),
+            strg.data(),
+            tran.data(),
+            impr.data(),
+            expr.data(),
+            std::as_bytes(std::span(&toc_table, 1))};
   }
-  int s = previous_offsets.size();
-  for (int x = 0; x < s; x++) {
-    spdlog::debug("SIZE {} {}", x, previous_offsets.size());
-    // fix previously empty offsets
-    auto &[offset, offsets] = previous_offsets.back();
-    uint32_t prev_loc = stream.tellp();
-    stream.seekp(offset);
-    stream.write(reinterpret_cast<char *>(offsets.data()),
-                 offsets.size() * sizeof(uint32_t));
 
-    size_t count = count_table[previous_import_path];
-    spdlog::debug("COUNT {} {}", count, offsets.size());
-    assert(count == offsets.size());
+  // fills the TOC and header from the section sizes, the sections follow the
+  // header back to back with the TOC at the end
+  void finish() {
+    uint32_t offset = sizeof(NDFBinHeader);
+    auto place = [&offset](TOCTableEntry &entry, const char *magic,
+                           const BinaryWriter &section) {
+      std::memcpy(entry.magic, magic, sizeof(entry.magic));
+      entry.offset = offset;
+      entry.size = section.size();
+      offset += section.size();
+    };
+    place(toc_table.OBJE, "OBJE", obje);
+    place(toc_table.TOPO, "TOPO", topo);
+    place(toc_table.CHNK, "CHNK", chnk);
+    place(toc_table.CLAS, "CLAS", clas);
+    place(toc_table.PROP, "PROP", prop);
+    place(toc_table.STRG, "STRG", strg);
+    place(toc_table.TRAN, "TRAN", tran);
+    place(toc_table.IMPR, "IMPR", impr);
+    place(toc_table.EXPR, "EXPR", expr);
+    header.toc0offset = offset;
+    header.size = offset + sizeof(TOCTable) - sizeof(NDFBinHeader);
+  }
 
-    spdlog::debug("WRITE offsets {} {} @0x{:02X}", previous_offsets.size(),
-                  previous_offsets.back().second.size(), (uint32_t)offset);
+  [[nodiscard]] size_t size() const {
+    return header.size + sizeof(NDFBinHeader);
+  }
+};
 
-    stream.seekp(prev_loc);
-    previous_import_path.pop_back();
-    previous_offsets.pop_back();
+void NDF::save_as_ndfbin(fs::path path) {
+  NDFBinImage image;
+  build_ndfbin(image);
+  if (path.has_parent_path()) {
+    fs::create_directories(path.parent_path());
   }
+  auto pieces = image.pieces();
+  PositionalFile file(path, PositionalFile::Mode::write);
+  file.write_vectored_at(0, pieces);
 }
 
-void NDF::save_as_ndfbin(fs::path path) {
-  fs::create_directories(path.parent_path());
-  std::fstream ofs(path, std::fstream::in | std::fstream::out |
-                             std::fstream::binary | std::fstream::trunc);
-  if (!ofs.is_open()) {
-    throw std::runtime_error("Failed to open file " + path.string());
+void NDF::save_as_ndfbin_stream(std::ostream &stream) {
+  NDFBinImage image;
+  build_ndfbin(image);
+  for (auto piece : image.pieces()) {
+    stream.write(reinterpret_cast<const char *>(piece.data()), piece.size());
+  }
+  if (!stream) {
+    throw std::runtime_error("Failed to write ndfbin");
   }
-  save_as_ndfbin_stream(ofs);
 }
 
-void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
-  gen_object_items.clear();
+std::vector<std::byte> NDF::save_as_ndfbin_buffer() {
+  NDFBinImage image;
+  build_ndfbin(image);
+  std::vector<std::byte> data;
+  data.reserve(image.size());
+  for (auto piece : image.pieces()) {
+    data.insert(data.end(), piece.begin(), piece.end());
+  }
+  return data;
+}
+
+void NDF::build_ndfbin(NDFBinImage &image) {
+  load_lazy_objects();
   gen_object_table.clear();
-  gen_string_items.clear();
   gen_string_table.clear();
-  gen_clas_items.clear();
   gen_clas_table.clear();
   gen_topo_table.clear();
-  gen_tran_items.clear();
   gen_tran_table.clear();
   gen_import_table.clear();
-  gen_import_items.clear();
   gen_export_table.clear();
-  gen_export_items.clear();
+  gen_export_objects.clear();
   gen_property_table.clear();
+  gen_property_items.clear();
+  // tables of a loaded file are a good guess for the sizes
+  gen_string_table.reserve(string_table.size());
+  gen_clas_table.reserve(class_table.size());
+  gen_tran_table.reserve(tran_table.size());
+  gen_import_table.reserve(import_name_table.size());
+  gen_export_table.reserve(object_map.size());
 
   fill_gen_object();
 
-  NDFBinHeader header;
-  TOCTable toc_table;
-
-  ofs.write(reinterpret_cast<char *>(&header), sizeof(header));
-
-  toc_table.OBJE.magic[0] = 'O';
-  toc_table.OBJE.magic[1] = 'B';
-  toc_table.OBJE.magic[2] = 'J';
-  toc_table.OBJE.magic[3] = 'E';
-
-  toc_table.OBJE.offset = ofs.tellp();
-
   {
     // fill class and property tables
     // iterating object_map here works, because std::map is ordered by key
+    // names of every class, in order of first use
+    std::vector<std::vector<NDFPropertyName>> clas_properties;
     for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
       const auto &obj = it.second;
-      auto clas_it = gen_clas_items.find(obj.class_name);
-      if (clas_it == gen_clas_items.end()) {
-        gen_clas_table.push_back(obj.class_name);
-        gen_clas_items.insert({obj.class_name, gen_clas_table.size() - 1});
-        uint32_t class_idx = gen_clas_table.size() - 1;
-        gen_property_table.emplace_back();
-        for (auto &property : obj.properties) {
-          gen_property_table[class_idx].properties.insert(
-              {property->property_name, 0});
-          gen_property_set.insert({property->property_name, class_idx});
-        }
-      } else {
-        for (auto &property : obj.properties) {
-          if (!gen_property_set.contains(
-                  {property->property_name, clas_it->second})) {
-            gen_property_set.insert({property->property_name, clas_it->second});
-            gen_property_table[clas_it->second].properties.insert(
-                {property->property_name, 0});
-          }
+      auto [class_idx, clas_inserted] = gen_clas_table.insert(obj.class_name);
+      if (clas_inserted) {
+        clas_properties.emplace_back();
+      }
+      for (auto &property : obj.properties) {
+        if (gen_property_table
+                .try_emplace(
+                    gen_property_key(class_idx, property->property_name), 0)
+                .second) {
+          clas_properties[class_idx].push_back(property->property_name);
         }
       }
 
@@ -477,177 +567,71 @@ void NDF::save_as_ndfbin_stream(std::ostream &ofs) {
         get_or_add_expr(obj.export_path, obj_idx);
       }
     }
-    // now generate property indices
-    for (auto &&[clas_idx, clas] : gen_property_table | std::views::enumerate) {
-      for (auto &[prop_name, prop_idx] : clas.properties) {
-        gen_property_items.push_back({prop_name, clas_idx});
-        prop_idx = gen_property_items.size() - 1;
+    // now generate property indices, sorted by name within every class
+    for (auto &&[clas_idx, names] : clas_properties | std::views::enumerate) {
+      std::ranges::sort(names, {}, &NDFPropertyName::str);
+      for (const auto &name : names) {
+        gen_property_table[gen_property_key(clas_idx, name)] =
+            gen_property_items.size();
+        gen_property_items.emplace_back(name, clas_idx);
       }
     }
   }
 
   // write OBJE
   // writing the properties also fills the string table
-  spdlog::debug("writing objects @0x{:02X}", (uint32_t)ofs.tellp());
+  BinaryWriter &obje = image.obje;
   for (const auto &[obj_idx, it] : object_map | std::views::enumerate) {
     const auto &obj = it.second;
-    uint32_t class_idx = gen_clas_items[obj.class_name];
-    spdlog::debug("writing classidx @0x{:02X} {}", (uint32_t)ofs.tellp(),
-                  class_idx);
-    ofs.write(reinterpret_cast<char *>(&class_idx), sizeof(class_idx));
+    uint32_t class_idx = *gen_clas_table.find(obj.class_name);
+    spdlog::debug("writing classidx @0x{:02X} {}", obje.size(), class_idx);
+    obje.write(class_idx);
 
     for (auto &property : obj.properties) {
-      uint32_t property_idx = gen_property_table[gen_clas_items[obj.class_name]]
-                                  .properties[property->property_name];
+      uint32_t property_idx = gen_property_table.at(
+          gen_property_key(class_idx, property->property_name));
       property->property_idx = property_idx;
-      spdlog::debug("writing propidx @0x{:02X} {}", (uint32_t)ofs.tellp(),
-                    property_idx);
-      ofs.write(reinterpret_cast<char *>(&property_idx), sizeof(property_idx));
-      uint32_t ndf_type = property->property_type;
-      spdlog::debug("writing ndf_type @0x{:02X} {}", (uint32_t)ofs.tellp(),
-                    ndf_type);
-      ofs.write(reinterpret_cast<char *>(&ndf_type), sizeof(ndf_type));
-      property->to_ndfbin(this, ofs);
+      obje.write(property_idx);
+      obje.write<uint32_t>(property->property_type);
+      property->to_ndfbin(this, obje.stream());
     }
     // write last property
-    uint32_t property_idx = 2880154539;
-    ofs.write(reinterpret_cast<char *>(&property_idx), sizeof(property_idx));
+    obje.write<uint32_t>(2880154539);
   }
 
-  toc_table.OBJE.size = (uint32_t)ofs.tellp() - toc_table.OBJE.offset;
-
   // write TOPO
-  toc_table.TOPO.magic[0] = 'T';
-  toc_table.TOPO.magic[1] = 'O';
-  toc_table.TOPO.magic[2] = 'P';
-  toc_table.TOPO.magic[3] = 'O';
-
-  toc_table.TOPO.offset = ofs.tellp();
-
-  spdlog::debug("writing topo @0x{:02X}", (uint32_t)ofs.tellp());
   for (uint32_t obj_idx : gen_topo_table) {
-    ofs.write(reinterpret_cast<char *>(&obj_idx), sizeof(obj_idx));
+    image.topo.write(obj_idx);
   }
 
-  toc_table.TOPO.size = (uint32_t)ofs.tellp() - toc_table.TOPO.offset;
-
   // write CHNK
-  toc_table.CHNK.magic[0] = 'C';
-  toc_table.CHNK.magic[1] = 'H';
-  toc_table.CHNK.magic[2] = 'N';
-  toc_table.CHNK.magic[3] = 'K';
-
-  toc_table.CHNK.offset = ofs.tellp();
-
-  spdlog::debug("writing chunk @0x{:02X}", (uint32_t)ofs.tellp());
-
-  uint32_t object_count = object_map.size();
-  ofs.write(reinterpret_cast<char *>(&object_count), sizeof(object_count));
-
-  toc_table.CHNK.size = (uint32_t)ofs.tellp() - toc_table.CHNK.offset;
+  image.chnk.write<uint32_t>(object_map.size());
 
   // write CLAS
-  toc_table.CLAS.magic[0] = 'C';
-  toc_table.CLAS.magic[1] = 'L';
-  toc_table.CLAS.magic[2] = 'A';
-  toc_table.CLAS.magic[3] = 'S';
-
-  toc_table.CLAS.offset = ofs.tellp();
-
   for (const auto &clas : gen_clas_table) {
-    uint32_t length = clas.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(clas.data(), length * sizeof(char));
+    image.clas.write_string(clas);
   }
 
-  toc_table.CLAS.size = (uint32_t)ofs.tellp() - toc_table.CLAS.offset;
-
   // write PROP
-  toc_table.PROP.magic[0] = 'P';
-  toc_table.PROP.magic[1] = 'R';
-  toc_table.PROP.magic[2] = 'O';
-  toc_table.PROP.magic[3] = 'P';
-
-  toc_table.PROP.offset = ofs.tellp();
-
-  spdlog::debug("writing properties @0x{:02X}", (uint32_t)ofs.tellp());
   for (const auto &[prop_name, class_idx] : gen_property_items) {
-    uint32_t length = prop_name.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(prop_name.data(), length * sizeof(char));
-    uint32_t class_index = class_idx;
-    ofs.write(reinterpret_cast<char *>(&class_index), sizeof(class_index));
-    spdlog::debug("writing prop {} {}", prop_name, class_index);
+    image.prop.write_string(prop_name.str());
+    image.prop.write(class_idx);
+    spdlog::debug("writing prop {} {}", prop_name, class_idx);
   }
 
-  toc_table.PROP.size = (uint32_t)ofs.tellp() - toc_table.PROP.offset;
-
   // write STRG
-  toc_table.STRG.magic[0] = 'S';
-  toc_table.STRG.magic[1] = 'T';
-  toc_table.STRG.magic[2] = 'R';
-  toc_table.STRG.magic[3] = 'G';
-
-  toc_table.STRG.offset = ofs.tellp();
-
-  spdlog::debug("writing strings @0x{:02X}", (uint32_t)ofs.tellp());
-  for (const auto &str : gen_string_items) {
-    uint32_t length = str.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(str.data(), length * sizeof(char));
+  for (const auto &str : gen_string_table) {
+    image.strg.write_string(str);
   }
 
-  toc_table.STRG.size = (uint32_t)ofs.tellp() - toc_table.STRG.offset;
-
   // write TRAN
-  toc_table.TRAN.magic[0] = 'T';
-  toc_table.TRAN.magic[1] = 'R';
-  toc_table.TRAN.magic[2] = 'A';
-  toc_table.TRAN.magic[3] = 'N';
-
-  toc_table.TRAN.offset = ofs.tellp();
-
-  spdlog::debug("writing tran @0x{:02X}", (uint32_t)ofs.tellp());
   for (const auto &tran : gen_tran_table) {
-    uint32_t length = tran.size();
-    ofs.write(reinterpret_cast<char *>(&length), sizeof(length));
-    ofs.write(tran.data(), length * sizeof(char));
+    image.tran.write_string(tran);
   }
 
-  toc_table.TRAN.size = (uint32_t)ofs.tellp() - toc_table.TRAN.offset;
-
-  // write IMPR
-  toc_table.IMPR.magic[0] = 'I';
-  toc_table.IMPR.magic[1] = 'M';
-  toc_table.IMPR.magic[2] = 'P';
-  toc_table.IMPR.magic[3] = 'R';
-
-  toc_table.IMPR.offset = ofs.tellp();
-
-  spdlog::debug("writing impr @0x{:02X}", (uint32_t)ofs.tellp());
-  save_ndfbin_imprs(gen_import_table, ofs);
-
-  toc_table.IMPR.size = (uint32_t)ofs.tellp() - toc_table.IMPR.offset;
-
-  // write EXPR
-  toc_table.EXPR.magic[0] = 'E';
-  toc_table.EXPR.magic[1] = 'X';
-  toc_table.EXPR.magic[2] = 'P';
-  toc_table.EXPR.magic[3] = 'R';
-
-  toc_table.EXPR.offset = ofs.tellp();
-
-  spdlog::debug("writing expr @0x{:02X}", (uint32_t)ofs.tellp());
-  save_ndfbin_imprs(gen_export_table, ofs);
-
-  toc_table.EXPR.size = (uint32_t)ofs.tellp() - toc_table.EXPR.offset;
-
-  // write TOC0 Header
-  header.toc0offset = (uint32_t)ofs.tellp();
-  ofs.write(reinterpret_cast<char *>(&toc_table), sizeof(toc_table));
+  // write IMPR and EXPR
+  save_ndfbin_imprs(gen_import_table, {}, image.impr);
+  save_ndfbin_imprs(gen_export_table, gen_export_objects, image.expr);
 
-  // rewrite header
-  header.size = (uint32_t)ofs.tellp() - 40;
-  ofs.seekp(0);
-  ofs.write(reinterpret_cast<char *>(&header), sizeof(header));
+  image.finish();
 }
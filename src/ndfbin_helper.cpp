@@ -1,17 +1,134 @@
 #include "argparse/argparse.hpp"
 
+#include "edat_reader.hpp"
 #include "ndf.hpp"
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include <filesystem>
 namespace fs = std::filesystem;
 
 #include "pugixml.hpp"
 
+struct ConversionResult {
+  fs::path input;
+  uintmax_t input_size = 0;
+  std::chrono::duration<double> duration{};
+  std::string error;
+};
+
+// converts a single file into output_folder, the output file keeps the input
+// name with the extension swapped. jobs threads are used to decode the
+// objects of the input file
+static void convert_file(const fs::path &input, const fs::path &output_folder,
+                         bool pack, unsigned jobs = 1) {
+  NDF ndf;
+  fs::path out_filename = input.filename();
+  if (!pack) {
+    ndf.load_from_ndfbin(input, jobs);
+    out_filename.replace_extension(".xml");
+    ndf.save_as_ndf_xml(output_folder / out_filename);
+  } else {
+    ndf.load_from_ndf_xml(input, jobs);
+    out_filename.replace_extension(".ndfbin");
+    ndf.save_as_ndfbin(output_folder / out_filename);
+  }
+}
+
+// walks the input tree and converts every matching file on a pool of jobs
+// threads, the directory layout below input is kept in output
+static int convert_directory(const fs::path &input, const fs::path &output,
+                             bool pack, unsigned jobs, bool all_timings) {
+  const std::string extension = pack ? ".xml" : ".ndfbin";
+  std::vector<ConversionResult> results;
+  for (const auto &entry : fs::recursive_directory_iterator(input)) {
+    if (entry.is_regular_file() && entry.path().extension() == extension) {
+      results.push_back({entry.path(), entry.file_size(), {}, {}});
+    }
+  }
+
+  std::atomic<size_t> next_file = 0;
+  auto worker = [&]() {
+    while (true) {
+      size_t idx = next_file++;
+      if (idx >= results.size()) {
+        return;
+      }
+      auto &result = results[idx];
+      fs::path output_folder =
+          output / result.input.lexically_relative(input).parent_path();
+      auto start = std::chrono::steady_clock::now();
+      try {
+        convert_file(result.input, output_folder, pack);
+      } catch (const std::exception &e) {
+        result.error = e.what();
+        spdlog::error("{}: {}", result.input.string(), e.what());
+      }
+      result.duration = std::chrono::steady_clock::now() - start;
+    }
+  };
+
+  jobs = std::clamp<unsigned>(jobs, 1, std::max<size_t>(results.size(), 1));
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < jobs; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+  size_t failed = 0;
+  uintmax_t total_size = 0;
+  for (const auto &result : results) {
+    total_size += result.input_size;
+    if (!result.error.empty()) {
+      failed++;
+    }
+  }
+
+  std::ranges::sort(results, std::greater{}, &ConversionResult::duration);
+  size_t timing_count = all_timings ? results.size()
+                                    : std::min<size_t>(results.size(), 10);
+  std::cout << std::format("per-file timings ({} of {}, slowest first):\n",
+                           timing_count, results.size());
+  for (const auto &result : results | std::views::take(timing_count)) {
+    std::cout << std::format("  {:9.3f} ms {:>10} B  {}{}\n",
+                             result.duration.count() * 1000, result.input_size,
+                             result.input.lexically_relative(input).string(),
+                             result.error.empty() ? "" : " (failed)");
+  }
+
+  double seconds = std::max(wall.count(), 1e-9);
+  std::cout << std::format(
+      "converted {} of {} files with {} jobs in {:.3f} s: {:.1f} files/s, "
+      "{:.2f} MB/s\n",
+      results.size() - failed, results.size(), jobs, wall.count(),
+      results.size() / seconds, total_size / seconds / (1024 * 1024));
+
+  if (failed) {
+    std::cout << std::format("{} files failed:\n", failed);
+    for (const auto &result : results) {
+      if (!result.error.empty()) {
+        std::cout << std::format("  {}: {}\n", result.input.string(),
+                                 result.error);
+      }
+    }
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char **argv) {
   argparse::ArgumentParser program("ndfbin");
-  program.add_argument("input").help("Input file");
+  program.add_argument("input").help(
+      "Input file, or a directory to convert every file below it");
   program.add_argument("output").help("Output folder");
   program.add_argument("-v", "--verbose")
       .default_value(false)
@@ -22,6 +139,19 @@ int main(int argc, char **argv) {
       .implicit_value(true)
       .help("instead of parsing the input file, pack the input xml file into a "
             "ndfbin file");
+  program.add_argument("-j", "--jobs")
+      .default_value(std::max(std::thread::hardware_concurrency(), 1u))
+      .scan<'u', unsigned int>()
+      .help("number of files converted in parallel in directory mode, or "
+            "threads used to load a single file");
+  program.add_argument("-e", "--edat-file")
+      .help("treat input as an edat archive and convert the ndfbin file at "
+            "this path inside it, without extracting the archive");
+  program.add_argument("-t", "--timings")
+      .default_value(false)
+      .implicit_value(true)
+      .help("print the timings of all files in directory mode, not only the "
+            "slowest ones");
 
   #ifdef _WIN32
   std::setlocale(LC_NUMERIC, "en-US");
@@ -42,7 +172,7 @@ int main(int argc, char **argv) {
   } else {
     spdlog::set_level(spdlog::level::debug);
   }
-    
+
   if(!fs::exists(program.get<std::string>("input"))) {
     spdlog::error("Input file does not exist");
     exit(1);
@@ -50,19 +180,23 @@ int main(int argc, char **argv) {
 
   fs::create_directories(program.get<std::string>("output"));
 
-  if (!program.get<bool>("-p")) {
-    NDF ndf;
-    ndf.load_from_ndfbin(program.get<std::string>("input"));
-    fs::path out_filename = program.get("input");
-    out_filename = out_filename.filename();
-    out_filename.replace_extension(".xml");
-    ndf.save_as_ndf_xml(fs::path(program.get<std::string>("output")) / out_filename);
-  } else {
+  fs::path input = program.get<std::string>("input");
+  fs::path output = program.get<std::string>("output");
+  if (auto edat_file = program.present("--edat-file")) {
+    EDatReader reader(input);
     NDF ndf;
-    ndf.load_from_ndf_xml(program.get<std::string>("input"));
-    fs::path out_filename = program.get("input");
-    out_filename = out_filename.filename();
-    out_filename.replace_extension(".ndfbin");
-    ndf.save_as_ndfbin(fs::path(program.get<std::string>("output")) / out_filename);
+    ndf.load_from_ndfbin_buffer(reader.open(*edat_file),
+                                program.get<unsigned int>("-j"));
+    fs::path out_filename = fs::path(*edat_file).filename();
+    ndf.save_as_ndf_xml(output / out_filename.replace_extension(".xml"));
+    return 0;
+  }
+  if (fs::is_directory(input)) {
+    return convert_directory(input, output, program.get<bool>("-p"),
+                             program.get<unsigned int>("-j"),
+                             program.get<bool>("-t"));
   }
+
+  convert_file(input, output, program.get<bool>("-p"),
+               program.get<unsigned int>("-j"));
 }
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// calls fn(idx) for every idx below count on up to jobs threads. the indices
+// are handed out one by one, so items of very different cost (like files of
+// an archive) spread evenly. the first exception stops handing out work and
+// gets rethrown after all threads joined
+template <typename F>
+void parallel_for(size_t count, unsigned jobs, F &&fn) {
+  jobs = std::clamp<unsigned>(jobs, 1, std::max<size_t>(count, 1));
+  if (jobs == 1) {
+    for (size_t idx = 0; idx < count; idx++) {
+      fn(idx);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next = 0;
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    while (true) {
+      size_t idx = next++;
+      if (idx >= count) {
+        return;
+      }
+      try {
+        fn(idx);
+      } catch (...) {
+        std::lock_guard lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < jobs; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
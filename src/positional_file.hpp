@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// file read or written at explicit offsets, so several threads can share it
+// without a common file position
+class PositionalFile {
+public:
+  enum class Mode {
+    read,
+    // creates the file or truncates an existing one
+    write,
+  };
+
+private:
+#ifdef _WIN32
+  fs::path m_path;
+#else
+  int m_fd = -1;
+#endif
+
+public:
+  PositionalFile(const fs::path &path, Mode mode) {
+#ifdef _WIN32
+    m_path = path;
+    if (mode == Mode::write) {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      if (!file) {
+        throw std::runtime_error("Failed to open file " + path.string());
+      }
+    } else if (!fs::exists(path)) {
+      throw std::runtime_error("Failed to open file " + path.string());
+    }
+#else
+    if (mode == Mode::read) {
+      m_fd = ::open(path.c_str(), O_RDONLY);
+    } else {
+      m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (m_fd < 0) {
+      throw std::runtime_error("Failed to open file " + path.string());
+    }
+#endif
+  }
+  ~PositionalFile() {
+#ifndef _WIN32
+    if (m_fd >= 0) {
+      ::close(m_fd);
+    }
+#endif
+  }
+
+  PositionalFile(const PositionalFile &) = delete;
+  PositionalFile &operator=(const PositionalFile &) = delete;
+
+  // file descriptor for copy_file_range and friends, -1 on windows
+  [[nodiscard]] int fd() const {
+#ifdef _WIN32
+    return -1;
+#else
+    return m_fd;
+#endif
+  }
+
+  void write_at(size_t offset, std::span<const std::byte> data) const {
+#ifdef _WIN32
+    std::fstream file(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (!file) {
+      throw std::runtime_error("Failed to write file " + m_path.string());
+    }
+#else
+    while (!data.empty()) {
+      ssize_t written = ::pwrite(m_fd, data.data(), data.size(), offset);
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        throw std::runtime_error("Failed to write file");
+      }
+      data = data.subspan(written);
+      offset += written;
+    }
+#endif
+  }
+
+  // writes the pieces back to back starting at offset, with one pwritev for
+  // up to 1024 pieces (the smallest IOV_MAX around)
+  void write_vectored_at(
+      size_t offset, std::span<const std::span<const std::byte>> pieces) const {
+#ifdef _WIN32
+    for (auto piece : pieces) {
+      write_at(offset, piece);
+      offset += piece.size();
+    }
+#else
+    std::vector<iovec> iov;
+    iov.reserve(pieces.size());
+    for (auto piece : pieces) {
+      if (!piece.empty()) {
+        iov.push_back({const_cast<std::byte *>(piece.data()), piece.size()});
+      }
+    }
+    size_t first = 0;
+    while (first < iov.size()) {
+      int count = std::min<size_t>(iov.size() - first, 1024);
+      ssize_t written = ::pwritev(m_fd, iov.data() + first, count, offset);
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        throw std::runtime_error("Failed to write file");
+      }
+      offset += written;
+      // drop what got written, a short write continues inside a piece
+      size_t remaining = written;
+      while (remaining > 0 && remaining >= iov[first].iov_len) {
+        remaining -= iov[first].iov_len;
+        first++;
+      }
+      if (remaining > 0) {
+        iov[first].iov_base =
+            static_cast<char *>(iov[first].iov_base) + remaining;
+        iov[first].iov_len -= remaining;
+      }
+    }
+#endif
+  }
+
+  // writes size bytes at offset of source to out_offset of this file.
+  // source_data is the mapping of source, uses copy_file_range on linux so
+  // the data does not pass through userspace and falls back to writing from
+  // the mapping
+  void copy_from([[maybe_unused]] const PositionalFile &source,
+                 std::span<const std::byte> source_data, size_t offset,
+                 size_t size, size_t out_offset) const {
+    if (offset > source_data.size() || size > source_data.size() - offset) {
+      throw std::runtime_error("Copy range is out of bounds of the source");
+    }
+    size_t copied = 0;
+#ifdef __linux__
+    loff_t in_offset = offset;
+    loff_t copy_out_offset = out_offset;
+    while (copied < size) {
+      ssize_t ret = ::copy_file_range(source.m_fd, &in_offset, m_fd,
+                                      &copy_out_offset, size - copied, 0);
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret <= 0) {
+        // not supported for this pair of files, copy the rest from the mapping
+        break;
+      }
+      copied += ret;
+    }
+#endif
+    write_at(out_offset + copied,
+             source_data.subspan(offset + copied, size - copied));
+  }
+
+  // grows or shrinks the file, new bytes are zero
+  void resize(size_t size) const {
+#ifdef _WIN32
+    fs::resize_file(m_path, size);
+#else
+    if (::ftruncate(m_fd, size) != 0) {
+      throw std::runtime_error("Failed to resize file");
+    }
+#endif
+  }
+};
@@ -0,0 +1,268 @@
+#include "utf_transcode.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define UTF_TRANSCODE_X86 1
+#include <immintrin.h>
+#endif
+
+// the ascii kernels convert full blocks from the start of the input as long
+// as every unit of a block is ascii, and return the number of units converted.
+// the scalar loops below pick up at the first block with anything else in it
+
+static uint16_t load_utf16_unit(const std::byte *src) {
+  uint16_t unit;
+  std::memcpy(&unit, src, sizeof(unit));
+  return unit;
+}
+
+static size_t utf16_ascii_scalar(const std::byte *src, size_t count,
+                                 char *dst) {
+  size_t i = 0;
+  for (; i < count; i++) {
+    auto unit = load_utf16_unit(src + i * 2);
+    if (unit >= 0x80) {
+      break;
+    }
+    dst[i] = static_cast<char>(unit);
+  }
+  return i;
+}
+
+static size_t utf8_ascii_scalar(const char *src, size_t count, char16_t *dst) {
+  size_t i = 0;
+  for (; i < count; i++) {
+    auto byte = static_cast<uint8_t>(src[i]);
+    if (byte >= 0x80) {
+      break;
+    }
+    dst[i] = byte;
+  }
+  return i;
+}
+
+#ifdef UTF_TRANSCODE_X86
+static size_t utf16_ascii_sse2(const std::byte *src, size_t count, char *dst) {
+  const __m128i non_ascii = _mm_set1_epi16(static_cast<int16_t>(0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+    auto hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 16));
+    auto high_bits = _mm_and_si128(_mm_or_si128(lo, hi), non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(high_bits, zero)) != 0xFFFF) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t
+utf16_ascii_avx2(const std::byte *src, size_t count, char *dst) {
+  const __m256i non_ascii = _mm256_set1_epi16(static_cast<int16_t>(0xFF80));
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    auto lo =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2));
+    auto hi =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2 + 32));
+    if (!_mm256_testz_si256(_mm256_or_si256(lo, hi), non_ascii)) {
+      break;
+    }
+    // packus works per 128 bit lane, put the quadwords back in order
+    auto packed =
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0b11011000);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+  }
+  return i;
+}
+
+static size_t utf8_ascii_sse2(const char *src, size_t count, char16_t *dst) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    if (_mm_movemask_epi8(bytes) != 0) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_unpacklo_epi8(bytes, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8),
+                     _mm_unpackhi_epi8(bytes, zero));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t
+utf8_ascii_avx2(const char *src, size_t count, char16_t *dst) {
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    auto bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    if (_mm256_movemask_epi8(bytes) != 0) {
+      break;
+    }
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(dst + i),
+        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(dst + i + 16),
+        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+  }
+  return i;
+}
+
+static std::atomic<bool> avx2_disabled = false;
+
+static bool use_avx2() {
+  static const bool has_avx2 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return has_avx2 && !avx2_disabled.load(std::memory_order_relaxed);
+}
+#endif
+
+void utf_transcode_disable_avx2(bool disable) {
+#ifdef UTF_TRANSCODE_X86
+  avx2_disabled.store(disable, std::memory_order_relaxed);
+#endif
+}
+
+static size_t utf16_ascii(const std::byte *src, size_t count, char *dst) {
+#ifdef UTF_TRANSCODE_X86
+  auto converted = use_avx2() ? utf16_ascii_avx2(src, count, dst)
+                                  : utf16_ascii_sse2(src, count, dst);
+  return converted +
+         utf16_ascii_scalar(src + converted * 2, count - converted,
+                            dst + converted);
+#else
+  return utf16_ascii_scalar(src, count, dst);
+#endif
+}
+
+static size_t utf8_ascii(const char *src, size_t count, char16_t *dst) {
+#ifdef UTF_TRANSCODE_X86
+  auto converted = use_avx2() ? utf8_ascii_avx2(src, count, dst)
+                                  : utf8_ascii_sse2(src, count, dst);
+  return converted + utf8_ascii_scalar(src + converted, count - converted,
+                                       dst + converted);
+#else
+  return utf8_ascii_scalar(src, count, dst);
+#endif
+}
+
+void utf16le_to_utf8(std::span<const std::byte> utf16, std::string &out) {
+  if (utf16.size() % 2 != 0) {
+    throw std::runtime_error(
+        std::format("UTF-16 string of odd length {}", utf16.size()));
+  }
+  const auto *src = utf16.data();
+  size_t count = utf16.size() / 2;
+  // a unit takes at most 3 bytes, a surrogate pair 4
+  out.resize(count * 3);
+  char *dst = out.data();
+  size_t i = 0;
+  while (i < count) {
+    auto ascii = utf16_ascii(src + i * 2, count - i, dst);
+    i += ascii;
+    dst += ascii;
+    // everything up to the next ascii unit
+    while (i < count) {
+      uint32_t c = load_utf16_unit(src + i * 2);
+      if (c < 0x80) {
+        break;
+      }
+      i++;
+      if (c < 0x800) {
+        *dst++ = static_cast<char>(0xC0 | (c >> 6));
+        *dst++ = static_cast<char>(0x80 | (c & 0x3F));
+        continue;
+      }
+      if (c < 0xD800 || c > 0xDFFF) {
+        *dst++ = static_cast<char>(0xE0 | (c >> 12));
+        *dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (c & 0x3F));
+        continue;
+      }
+      if (c >= 0xDC00 || i == count) {
+        throw std::runtime_error(
+            std::format("Unpaired UTF-16 surrogate at unit {}", i - 1));
+      }
+      uint32_t low = load_utf16_unit(src + i * 2);
+      if (low < 0xDC00 || low > 0xDFFF) {
+        throw std::runtime_error(
+            std::format("Unpaired UTF-16 surrogate at unit {}", i - 1));
+      }
+      i++;
+      c = 0x10000 + (((c & 0x3FF) << 10) | (low & 0x3FF));
+      *dst++ = static_cast<char>(0xF0 | (c >> 18));
+      *dst++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      *dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      *dst++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  out.resize(dst - out.data());
+}
+
+void utf8_to_utf16le(std::string_view utf8, std::u16string &out) {
+  const char *src = utf8.data();
+  size_t count = utf8.size();
+  // never more units than bytes
+  out.resize(count);
+  char16_t *dst = out.data();
+  size_t i = 0;
+  while (i < count) {
+    auto ascii = utf8_ascii(src + i, count - i, dst);
+    i += ascii;
+    dst += ascii;
+    while (i < count) {
+      uint32_t lead = static_cast<uint8_t>(src[i]);
+      if (lead < 0x80) {
+        break;
+      }
+      size_t length = lead >= 0xF0   ? 4
+                      : lead >= 0xE0 ? 3
+                      : lead >= 0xC0 ? 2
+                                     : 0;
+      if (length == 0 || lead > 0xF4 || count - i < length) {
+        throw std::runtime_error(
+            std::format("Invalid UTF-8 sequence at byte {}", i));
+      }
+      uint32_t c = lead & (0x7F >> length);
+      for (size_t j = 1; j < length; j++) {
+        uint32_t byte = static_cast<uint8_t>(src[i + j]);
+        if ((byte & 0xC0) != 0x80) {
+          throw std::runtime_error(
+              std::format("Invalid UTF-8 sequence at byte {}", i));
+        }
+        c = (c << 6) | (byte & 0x3F);
+      }
+      // overlong forms, encoded surrogates and code points past U+10FFFF
+      static constexpr uint32_t min_code_point[] = {0, 0, 0x80, 0x800,
+                                                    0x10000};
+      if (c < min_code_point[length] || (c >= 0xD800 && c <= 0xDFFF) ||
+          c > 0x10FFFF) {
+        throw std::runtime_error(
+            std::format("Invalid UTF-8 sequence at byte {}", i));
+      }
+      i += length;
+      if (c < 0x10000) {
+        *dst++ = static_cast<char16_t>(c);
+      } else {
+        c -= 0x10000;
+        *dst++ = static_cast<char16_t>(0xD800 | (c >> 10));
+        *dst++ = static_cast<char16_t>(0xDC00 | (c & 0x3FF));
+      }
+    }
+  }
+  out.resize(dst - out.data());
+}
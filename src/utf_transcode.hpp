@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+// single pass conversions between the utf-16le of WideStrings and utf-8,
+// without going through utf-32. runs of ascii are converted a block at a time
+// with SSE2 or AVX2 where the cpu has it, everything else goes through a
+// scalar loop. invalid input throws std::runtime_error
+
+// utf16 is the raw payload of the string, its size has to be even
+void utf16le_to_utf8(std::span<const std::byte> utf16, std::string &out);
+void utf8_to_utf16le(std::string_view utf8, std::u16string &out);
+
+// uses the SSE2 blocks on cpus with AVX2 as well, so tests can cover both
+void utf_transcode_disable_avx2(bool disable);
@@ -0,0 +1,154 @@
+#include <catch2/catch_all.hpp>
+
+#include "catch2/catch_test_macros.hpp"
+#include "edat_reader.hpp"
+#include "generator.hpp"
+
+#include <fstream>
+#include <sstream>
+
+// writes an archive with the files a.ndfbin, dir/b.ndfbin and dir/c.ndfbin,
+// the dictionary is encoded by hand
+static void write_test_edat(const fs::path &path, const std::string &a,
+                            const std::string &b, const std::string &c) {
+  constexpr uint32_t sector_size = 16;
+  auto aligned = [](uint32_t size) {
+    return (size + sector_size - 1) / sector_size * sector_size;
+  };
+  std::string dictionary;
+  auto put_u32 = [&](uint32_t value) {
+    dictionary.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  };
+  auto put_string = [&](std::string_view str) {
+    dictionary.append(str);
+    dictionary.append(str.size() % 2 == 0 ? 2 : 1, '\0');
+  };
+  auto put_file = [&](std::string_view name, uint32_t offset, uint32_t size,
+                      bool is_last) {
+    put_u32(0);
+    put_u32(is_last ? 0 : 8 + sizeof(EDatFileHeader) + 10);
+    EDatFileHeader header = {};
+    header.offset = offset;
+    header.size = size;
+    dictionary.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    put_string(name);
+  };
+
+  put_u32(0x0A);
+  dictionary.append(6, '\0');
+  put_file("a.ndfbin", 0, a.size(), false);
+  put_u32(8 + 6);
+  put_u32(0);
+  put_string("dir\\");
+  put_file("b.ndfbin", aligned(a.size()), b.size(), false);
+  put_file("c.ndfbin", aligned(a.size()) + aligned(b.size()), c.size(), true);
+
+  EDatHeader header = {};
+  std::memcpy(header.magic, "edat", 4);
+  header.unk0 = 2;
+  header.offset_dictionary = sizeof(header);
+  header.size_dictionary = dictionary.size();
+  header.offset_files = aligned(sizeof(header) + dictionary.size());
+  header.sectorSize = sector_size;
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(dictionary.data(), dictionary.size());
+  for (auto [offset, content] :
+       {std::pair{0u, &a}, std::pair{aligned(a.size()), &b},
+        std::pair{aligned(a.size()) + aligned(b.size()), &c}}) {
+    file.seekp(header.offset_files + offset);
+    file.write(content->data(), content->size());
+  }
+}
+
+TEST_CASE("edat reader", "[edat]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 3);
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  std::string ndfbin = ss.str();
+
+  fs::path path = fs::temp_directory_path() / "edat_reader_test.dat";
+  write_test_edat(path, ndfbin, "first", "second file");
+  EDatReader reader(path);
+
+  SECTION("the index contains all files, sorted") {
+    auto &files = reader.get_files();
+    REQUIRE(files.size() == 3);
+    REQUIRE(files[0].first == "a.ndfbin");
+    REQUIRE(files[1].first == "dir/b.ndfbin");
+    REQUIRE(files[2].first == "dir/c.ndfbin");
+    REQUIRE(reader.contains("dir\\c.ndfbin"));
+    REQUIRE_FALSE(reader.contains("dir/d.ndfbin"));
+  }
+
+  SECTION("files are views into the archive") {
+    auto b = reader.open("dir/b.ndfbin");
+    REQUIRE(std::string_view(reinterpret_cast<const char *>(b.data()),
+                             b.size()) == "first");
+    auto c = reader.open("dir/c.ndfbin");
+    REQUIRE(std::string_view(reinterpret_cast<const char *>(c.data()),
+                             c.size()) == "second file");
+    REQUIRE_THROWS_AS(reader.open("dir/d.ndfbin"), std::runtime_error);
+  }
+
+  SECTION("ndfbin files load straight from the archive") {
+    NDF from_archive;
+    from_archive.load_from_ndfbin_buffer(reader.open("a.ndfbin"));
+    REQUIRE(from_archive.object_map.size() == 3);
+    std::stringstream out;
+    from_archive.save_as_ndfbin_stream(out);
+    REQUIRE(out.str() == ndfbin);
+  }
+}
+
+static std::string read_file(const fs::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), {}};
+}
+
+TEST_CASE("edat extraction", "[edat]") {
+  // several sectors, an empty file and a single byte
+  std::string a(100, '\0');
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = char(i);
+  }
+  fs::path path = fs::temp_directory_path() / "edat_extract_test.dat";
+  write_test_edat(path, a, "", "c");
+  EDatReader reader(path);
+
+  SECTION("the dictionary reads the same from a stream") {
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<EDatFile> files;
+    auto header = read_edat_dictionary(stream, files);
+    // the headers are packed, copy the fields instead of binding them
+    REQUIRE(uint32_t(header.offset_files) ==
+            uint32_t(reader.get_header().offset_files));
+    REQUIRE(files.size() == reader.get_files().size());
+    for (size_t i = 0; i < files.size(); i++) {
+      auto &[path, file_header] = reader.get_files()[i];
+      REQUIRE(files[i].first == path);
+      REQUIRE(uint32_t(files[i].second.offset) == uint32_t(file_header.offset));
+      REQUIRE(uint32_t(files[i].second.size) == uint32_t(file_header.size));
+    }
+  }
+
+  SECTION("truncated dictionaries are rejected") {
+    std::istringstream stream(read_file(path).substr(0, sizeof(EDatHeader) + 8));
+    std::vector<EDatFile> files;
+    REQUIRE_THROWS_AS(read_edat_dictionary(stream, files), std::runtime_error);
+  }
+
+  SECTION("all files get extracted") {
+    for (unsigned jobs : {1u, 4u}) {
+      fs::path outpath = fs::temp_directory_path() / "edat_extract_test";
+      fs::remove_all(outpath);
+      extract_edat(reader, outpath, jobs);
+      REQUIRE(read_file(outpath / "a.ndfbin") == a);
+      REQUIRE(fs::exists(outpath / "dir" / "b.ndfbin"));
+      REQUIRE(fs::file_size(outpath / "dir" / "b.ndfbin") == 0);
+      REQUIRE(read_file(outpath / "dir" / "c.ndfbin") == "c");
+    }
+  }
+}
@@ -0,0 +1,253 @@
+#include <catch2/catch_all.hpp>
+
+#include "catch2/catch_test_macros.hpp"
+#include "edat_reader.hpp"
+#include "edat_writer.hpp"
+#include "md5.hpp"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+static std::string md5_hex(std::string_view data) {
+  std::string ret;
+  for (auto byte : MD5::digest(std::as_bytes(std::span(data)))) {
+    ret += std::format("{:02x}", byte);
+  }
+  return ret;
+}
+
+static std::string read_file(const fs::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), {}};
+}
+
+static void write_file(const fs::path &path, std::string_view content) {
+  fs::create_directories(path.parent_path());
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(content.data(), std::streamsize(content.size()));
+}
+
+// writes the files below root and returns them as entries
+static std::vector<EDatEntry>
+write_sources(const fs::path &root,
+              const std::map<std::string, std::string> &files) {
+  fs::remove_all(root);
+  std::vector<EDatEntry> entries;
+  for (const auto &[path, content] : files) {
+    write_file(root / path, content);
+    entries.push_back({path, root / path, {}});
+  }
+  return entries;
+}
+
+TEST_CASE("md5 digest", "[edat]") {
+  REQUIRE(md5_hex("") == "d41d8cd98f00b204e9800998ecf8427e");
+  REQUIRE(md5_hex("abc") == "900150983cd24fb0d6963f7d28e17f72");
+  REQUIRE(md5_hex("message digest") == "f96b697d7cb7938d525a2f31aaf161d0");
+  std::string digits = "1234567890123456789012345678901234567890"
+                       "1234567890123456789012345678901234567890";
+  REQUIRE(md5_hex(digits) == "57edf4a22be3c955ac49da2e2107b67a");
+
+  // fed in pieces that do not line up with the blocks
+  MD5 md5;
+  auto bytes = std::as_bytes(std::span(digits));
+  md5.update(bytes.first(3));
+  md5.update(bytes.subspan(3, 70));
+  md5.update(bytes.subspan(73));
+  REQUIRE(md5.finalize() == MD5::digest(bytes));
+}
+
+TEST_CASE("edat dictionary order", "[edat]") {
+  std::vector<EDatEntry> entries;
+  for (auto path : {"b.ndf", "B.ndf", "a-b.ndf", "a/c.ndf", "_x.ndf", "9.ndf"}) {
+    entries.push_back({path, {}, {}});
+  }
+  sort_edat_entries(entries);
+  std::vector<std::string> paths;
+  for (const auto &entry : entries) {
+    paths.push_back(entry.path);
+  }
+  // / sorts before -, digits before _ and lower case before upper case
+  REQUIRE(paths == std::vector<std::string>{"9.ndf", "_x.ndf", "a/c.ndf",
+                                            "a-b.ndf", "b.ndf", "B.ndf"});
+
+  REQUIRE_THROWS_AS(edat_dictionary_sort_key("a:b"), std::runtime_error);
+  // the dictionary has no entry for a file in the middle of a path
+  std::vector<EDatEntry> prefixed = {{"a.ndf", {}, {}}, {"a.ndfbin", {}, {}}};
+  REQUIRE_THROWS_AS(build_edat_dictionary(prefixed), std::runtime_error);
+  std::vector<EDatEntry> duplicated = {{"a.ndf", {}, {}}, {"a.ndf", {}, {}}};
+  REQUIRE_THROWS_AS(build_edat_dictionary(duplicated), std::runtime_error);
+}
+
+TEST_CASE("edat writer", "[edat]") {
+  fs::path root = fs::temp_directory_path() / "edat_writer_test";
+  fs::path archive = fs::temp_directory_path() / "edat_writer_test.dat";
+  std::string large(100, '\0');
+  for (size_t i = 0; i < large.size(); i++) {
+    large[i] = char(i);
+  }
+  const std::map<std::string, std::string> files = {
+      {"a.ndfbin", "first"},
+      {"dir/b.ndfbin", large},
+      {"dir/c.ndfbin", ""},
+      {"dir/sub/d.bin", "fourth"},
+      {"dir/sub/e.bin", "fifth"},
+      {"z/f.bin", "sixth"},
+  };
+  auto entries = write_sources(root, files);
+  constexpr uint32_t sector_size = 16;
+  auto header = build_edat(archive, entries, sector_size, 4);
+  std::string bytes = read_file(archive);
+
+  SECTION("the archive reads back") {
+    EDatReader reader(archive);
+    REQUIRE(uint32_t(reader.get_header().sectorSize) == sector_size);
+    REQUIRE(uint32_t(reader.get_header().offset_files) ==
+            uint32_t(header.offset_files));
+    REQUIRE(reader.get_files().size() == files.size());
+    for (const auto &[path, content] : files) {
+      auto data = reader.open(path);
+      REQUIRE(std::string_view(reinterpret_cast<const char *>(data.data()),
+                               data.size()) == content);
+      auto file_header = *reader.get_file_header(path);
+      REQUIRE(uint32_t(file_header.offset) % sector_size == 0);
+      auto digest = MD5::digest(data);
+      REQUIRE(std::memcmp(file_header.checksum, digest.data(), 16) == 0);
+    }
+    REQUIRE(bytes.size() % sector_size == 0);
+
+    auto dictionary = std::string_view(bytes).substr(
+        header.offset_dictionary, header.size_dictionary);
+    auto digest = MD5::digest(std::as_bytes(std::span(dictionary)));
+    REQUIRE(std::memcmp(reader.get_header().checksum, digest.data(), 16) == 0);
+  }
+
+  SECTION("the stream writer writes the same bytes") {
+    auto stream_entries = write_sources(root, files);
+    std::stringstream stream;
+    write_edat(stream, stream_entries, sector_size);
+    REQUIRE(stream.str() == bytes);
+  }
+
+  SECTION("kept layouts give the same archive") {
+    EDatReader reader(archive);
+    std::vector<EDatEntry> kept;
+    for (const auto &[path, file_header] : reader.get_files()) {
+      kept.push_back({path, root / path, file_header});
+    }
+    fs::path rebuilt = fs::temp_directory_path() / "edat_writer_kept.dat";
+    build_edat(rebuilt, kept, sector_size, 1, false);
+    REQUIRE(read_file(rebuilt) == bytes);
+
+    // a source that does not match its header is rejected
+    write_file(root / "a.ndfbin", "changed");
+    REQUIRE_THROWS_AS(build_edat(rebuilt, kept, sector_size, 1, false),
+                      std::runtime_error);
+  }
+
+  SECTION("empty archives") {
+    std::vector<EDatEntry> none;
+    build_edat(archive, none, sector_size, 1);
+    EDatReader reader(archive);
+    REQUIRE(reader.get_files().empty());
+  }
+}
+
+// the content of every file of the archive
+static std::map<std::string, std::string> read_archive(const fs::path &path) {
+  EDatReader reader(path);
+  std::map<std::string, std::string> files;
+  for (const auto &[file_path, _] : reader.get_files()) {
+    auto data = reader.open(file_path);
+    files.emplace(file_path, std::string(reinterpret_cast<const char *>(
+                                             data.data()),
+                                         data.size()));
+  }
+  return files;
+}
+
+TEST_CASE("edat update", "[edat]") {
+  fs::path root = fs::temp_directory_path() / "edat_update_test";
+  fs::path changes_root = fs::temp_directory_path() / "edat_update_changes";
+  fs::path archive = fs::temp_directory_path() / "edat_update_test.dat";
+  std::map<std::string, std::string> files = {
+      {"a.ndfbin", std::string(40, 'a')},
+      {"dir/b.ndfbin", std::string(20, 'b')},
+      {"dir/c.ndfbin", "c"},
+  };
+  // large sectors keep the first file sector after the dictionary free for
+  // more paths, small ones move the file section for every added path
+  uint32_t sector_size = GENERATE(16u, 4096u);
+  auto entries = write_sources(root, files);
+  build_edat(archive, entries, sector_size, 1);
+  EDatReader before(archive);
+  auto untouched = *before.get_file_header("dir/c.ndfbin");
+
+  std::map<std::string, std::string> changed = {
+      // shrinks and stays in its sectors
+      {"a.ndfbin", "shorter"},
+      // grows past its sectors and moves to the end
+      {"dir/b.ndfbin", std::string(5000, 'B')},
+      {"dir/new.ndfbin", "new"},
+      {"dir\\sub\\other.ndfbin", "other"},
+  };
+  fs::remove_all(changes_root);
+  std::map<std::string, fs::path> changes;
+  for (const auto &[path, content] : changed) {
+    write_file(changes_root / path, content);
+    changes.emplace(path, changes_root / path);
+  }
+  auto header = update_edat(archive, changes, 4);
+  // the update went to a new file, the mapping of the old one is unchanged
+  REQUIRE(before.open("a.ndfbin").size() == 40);
+  REQUIRE_FALSE(fs::exists(archive.string() + ".tmp"));
+
+  for (const auto &[path, content] : changed) {
+    std::string archive_path = path;
+    std::ranges::replace(archive_path, '\\', '/');
+    files[archive_path] = content;
+  }
+  REQUIRE(read_archive(archive) == files);
+
+  EDatReader after(archive);
+  REQUIRE(uint32_t(after.get_header().offset_files) ==
+          uint32_t(header.offset_files));
+  // untouched files keep their place and checksum
+  auto kept = *after.get_file_header("dir/c.ndfbin");
+  REQUIRE(uint32_t(kept.offset) == uint32_t(untouched.offset));
+  REQUIRE(std::memcmp(kept.checksum, untouched.checksum, 16) == 0);
+  REQUIRE(uint32_t(after.get_file_header("a.ndfbin")->offset) ==
+          uint32_t(before.get_file_header("a.ndfbin")->offset));
+  for (const auto &[path, file_header] : after.get_files()) {
+    auto digest = MD5::digest(after.open(path));
+    REQUIRE(std::memcmp(file_header.checksum, digest.data(), 16) == 0);
+  }
+  // the slot of the shrunk file is zero padded
+  auto a = after.get_archive().subspan(
+      size_t(header.offset_files) + after.get_file_header("a.ndfbin")->offset,
+      40);
+  REQUIRE(std::ranges::all_of(a.subspan(7),
+                              [](std::byte byte) { return byte == std::byte{0}; }));
+
+  SECTION("invalid paths leave the archive alone") {
+    std::string bytes = read_file(archive);
+    write_file(changes_root / "bad", "bad");
+    REQUIRE_THROWS_AS(update_edat(archive, {{"a:b", changes_root / "bad"}}, 1),
+                      std::runtime_error);
+    REQUIRE(read_file(archive) == bytes);
+  }
+
+  SECTION("failing to write the new archive leaves the old one alone") {
+    std::string bytes = read_file(archive);
+    fs::path blocked = archive.string() + ".tmp";
+    fs::create_directories(blocked);
+    REQUIRE_THROWS(update_edat(archive, changes, 1));
+    REQUIRE(read_file(archive) == bytes);
+    // not removed, it was not created by the update
+    REQUIRE(fs::is_directory(blocked));
+    fs::remove(blocked);
+  }
+}
@@ -4,16 +4,9 @@
 #include "generator.hpp"
 #include "ndf_properties.hpp"
 
-#include <argparse/argparse.hpp>
-
 #include <experimental/random>
 #include <stdint.h>
 
-#include <pybind11/embed.h>
-namespace py = pybind11;
-
-#include "pugixml.hpp"
-
 NDFObject ndf_generator::gen_random_object() {
   NDFObject obj;
   obj.name = "test_object";
@@ -64,11 +57,12 @@ void ndf_generator::add_random_uint32(NDFObject &obj) {
 std::unique_ptr<NDFProperty> ndf_generator::gen_random_list(int idx) {
   auto prop = std::make_unique<NDFPropertyList>();
   prop->property_idx = idx;
-  prop->property_type = NDFPropertyType::UInt32;
-  prop->property_name = std::format("TestUInt32_{}", prop->property_idx);
+  prop->property_type = NDFPropertyType::List;
+  prop->property_name = std::format("TestList_{}", prop->property_idx);
 
   for (int i = 0; i < 10; i++) {
     auto item = gen_random_uint32(-1);
+    item->property_name = "ListItem";
     prop->values.push_back(std::move(item));
   }
   return prop;
@@ -111,100 +105,166 @@ void ndf_generator::add_import_reference(NDFObject &obj, std::string ref) {
   obj.properties.push_back(std::move(prop));
 }
 
-// call with vfs_path -> path to the file
-void ndf_generator::create_edat(
-    fs::path path, std::unordered_map<std::string, std::string> files) {
-  fs::path out_path = path.parent_path() / "out";
-  // first we create the xml file for the edat
-  pugi::xml_document doc;
-  auto root = doc.append_child("EDat");
-  root.append_attribute("sectorSize") = 8192;
-  root.append_attribute("_wgrd_cons_parsers_version") = "0.2.11";
-  for (auto &[vfs_path, _] : files) {
-    auto file = root.append_child("File");
-    std::string p = ("out" / fs::path(vfs_path));
-    std::replace(p.begin(), p.end(), '/', '\\');
-    file.append_attribute("path") = p.c_str();
-  }
-  fs::path xml_path = path;
-  xml_path = xml_path.replace_extension("edat.xml");
-  doc.save_file(xml_path.string().c_str());
-
-  // now we create the out folder and copy the files in there
-  fs::create_directories(out_path);
-  for (auto &[vfs_path, fs_path] : files) {
-    spdlog::info("copying file {} to {}", fs_path,
-                 (out_path / vfs_path).string());
-    fs::copy(fs_path, out_path / vfs_path,
-             fs::copy_options::overwrite_existing);
-  }
-
-  // now we create the edat file
-  py::object edat =
-      py::module::import("wgrd_cons_parsers.edat").attr("EdatMain")();
-
-  // as the EdatMain uses the . instead of [] for accessing, we need the
-  // dingsda Container
-  py::object container =
-      py::module::import("dingsda.lib.containers").attr("Container");
-  py::dict args = py::dict();
-  args["no_alignment"] = true;
-  args["disable_checksums"] = true;
-  edat.attr("args") = container(args);
-  py::object data = edat.attr("get_data")(xml_path.string());
-  edat.attr("pack")(xml_path.string(), out_path.string(), data);
+template <typename T>
+static std::unique_ptr<T> make_property(int idx, std::string name = "") {
+  auto property = std::make_unique<T>();
+  property->property_idx = idx;
+  property->property_name =
+      name.empty() ? std::format("Property_{}", idx) : name;
+  return property;
 }
 
-void ndf_generator::create_test_files(fs::path output_folder) {
-  py::str py_exec = (py::module::import("sys").attr("executable"));
-  spdlog::info(std::string(py_exec));
-  py::str py_path = (py::module::import("sys").attr("path"));
-  spdlog::info(std::string(py_path));
-
-  std::srand(std::time(nullptr));
-
-  fs::create_directories(output_folder / "ndfbin");
-
-  // let's first create some random ndfbin data
-  NDF test_ndf;
-  {
-    add_random_object(test_ndf);
-    auto &obj = test_ndf.object_map.begin().value();
-    add_random_uint16(obj);
-    add_random_uint32(obj);
-    add_random_uint8(obj);
-    add_random_uint8(obj);
+NDFObject ndf_generator::gen_all_types_object() {
+  NDFObject obj = gen_random_object();
+  obj.name = "all_types";
+  int idx = 0;
+
+  auto boolean = make_property<NDFPropertyBool>(idx++);
+  boolean->value = true;
+  obj.add_property(std::move(boolean));
+  auto uint8 = make_property<NDFPropertyUInt8>(idx++);
+  uint8->value = 200;
+  obj.add_property(std::move(uint8));
+  auto int16 = make_property<NDFPropertyInt16>(idx++);
+  int16->value = -1234;
+  obj.add_property(std::move(int16));
+  auto uint16 = make_property<NDFPropertyUInt16>(idx++);
+  uint16->value = 54321;
+  obj.add_property(std::move(uint16));
+  auto int32 = make_property<NDFPropertyInt32>(idx++);
+  int32->value = -123456789;
+  obj.add_property(std::move(int32));
+  auto uint32 = make_property<NDFPropertyUInt32>(idx++);
+  uint32->value = 3000000000;
+  obj.add_property(std::move(uint32));
+  auto float32 = make_property<NDFPropertyFloat32>(idx++);
+  float32->value = 1.5f;
+  obj.add_property(std::move(float32));
+  auto float64 = make_property<NDFPropertyFloat64>(idx++);
+  float64->value = -2.25;
+  obj.add_property(std::move(float64));
+  auto string = make_property<NDFPropertyString>(idx++);
+  string->value = "a string";
+  obj.add_property(std::move(string));
+  auto path = make_property<NDFPropertyPathReference>(idx++);
+  path->path = "GameData:/Some/Path.ndf";
+  obj.add_property(std::move(path));
+  auto wide_string = make_property<NDFPropertyWideString>(idx++);
+  wide_string->value = "a wide string";
+  obj.add_property(std::move(wide_string));
+  auto f32_vec2 = make_property<NDFPropertyF32_vec2>(idx++);
+  f32_vec2->x = 1.0f;
+  f32_vec2->y = -2.0f;
+  obj.add_property(std::move(f32_vec2));
+  auto f32_vec3 = make_property<NDFPropertyF32_vec3>(idx++);
+  f32_vec3->x = 1.0f;
+  f32_vec3->y = 2.0f;
+  f32_vec3->z = 3.5f;
+  obj.add_property(std::move(f32_vec3));
+  auto f32_vec4 = make_property<NDFPropertyF32_vec4>(idx++);
+  f32_vec4->x = 1.0f;
+  f32_vec4->y = 2.0f;
+  f32_vec4->z = 3.0f;
+  f32_vec4->w = 4.25f;
+  obj.add_property(std::move(f32_vec4));
+  auto s32_vec2 = make_property<NDFPropertyS32_vec2>(idx++);
+  s32_vec2->x = -1;
+  s32_vec2->y = 2;
+  obj.add_property(std::move(s32_vec2));
+  auto s32_vec3 = make_property<NDFPropertyS32_vec3>(idx++);
+  s32_vec3->x = 3;
+  s32_vec3->y = -4;
+  s32_vec3->z = 5;
+  obj.add_property(std::move(s32_vec3));
+  // every channel differs, so a swapped channel shows up
+  auto color = make_property<NDFPropertyColor>(idx++, "Color");
+  color->r = 10;
+  color->g = 20;
+  color->b = 30;
+  color->a = 40;
+  obj.add_property(std::move(color));
+  auto guid = make_property<NDFPropertyGUID>(idx++);
+  guid->guid = "00112233445566778899AABBCCDDEEFF";
+  obj.add_property(std::move(guid));
+  auto localisation_hash = make_property<NDFPropertyLocalisationHash>(idx++);
+  localisation_hash->hash = "0123456789ABCDEF";
+  obj.add_property(std::move(localisation_hash));
+  auto hash = make_property<NDFPropertyHash>(idx++);
+  hash->hash = "FFEEDDCCBBAA99887766554433221100";
+  obj.add_property(std::move(hash));
+  obj.add_property(gen_import_reference(idx++, "$/test/import"));
+
+  auto list = make_property<NDFPropertyList>(idx++);
+  for (int32_t i = 0; i < 3; i++) {
+    auto item = make_property<NDFPropertyInt32>(-1, "ListItem");
+    item->value = i * 7;
+    list->values.push_back(std::move(item));
   }
-  // now save it in the output folder
-  test_ndf.save_as_ndf_xml(output_folder / "ndfbin" / "test.ndfbin.xml");
-  test_ndf.save_as_ndfbin(output_folder / "ndfbin" / "test.ndfbin");
-
-  // now generate an edat file containing the ndfbin file
-  create_edat(output_folder / "test.dat",
-              {{"test.ndfbin", output_folder / "ndfbin" / "test.ndfbin"}});
-}
-
-/*
-int main(int argc, char *argv[]) {
-  argparse::ArgumentParser program;
-  program.add_argument("-o").help(gettext("Path to output folder"));
-
-  try {
-    program.parse_args(argc, argv);
-  } catch (const std::runtime_error &err) {
-    std::cout << err.what() << std::endl;
-    std::cout << program;
-    exit(0);
+  obj.add_property(std::move(list));
+
+  // string -> (int16, [vec2])
+  auto map = make_property<NDFPropertyMap>(idx++);
+  for (int16_t i = 0; i < 2; i++) {
+    auto key = make_property<NDFPropertyString>(-1, "Key");
+    key->value = std::format("key_{}", i);
+    auto first = make_property<NDFPropertyInt16>(-1, "First");
+    first->value = i;
+    auto vec = make_property<NDFPropertyF32_vec2>(-1, "ListItem");
+    vec->x = i;
+    vec->y = -i;
+    auto second = make_property<NDFPropertyList>(-1, "Second");
+    second->values.push_back(std::move(vec));
+    auto pair = make_property<NDFPropertyPair>(-1, "Value");
+    pair->first = std::move(first);
+    pair->second = std::move(second);
+    map->values.emplace_back(std::move(key), std::move(pair));
   }
-  py::scoped_interpreter guard{};
+  obj.add_property(std::move(map));
+
+  // (color, import reference)
+  auto pair_color = make_property<NDFPropertyColor>(-1, "First");
+  pair_color->r = 1;
+  pair_color->g = 2;
+  pair_color->b = 3;
+  pair_color->a = 4;
+  auto pair = make_property<NDFPropertyPair>(idx++);
+  pair->first = std::move(pair_color);
+  pair->second = gen_import_reference(-1, "$/test/pair_import");
+  pair->second->property_name = "Second";
+  obj.add_property(std::move(pair));
+  return obj;
+}
 
-  fs::path output_folder;
-  if (program.present("-o")) {
-    output_folder = program.get<std::string>("-o");
-  } else {
-    output_folder = fs::temp_directory_path() / "modding_suite_test_data";
+void ndf_generator::add_random_objects(NDF &ndf, size_t object_count,
+                                       size_t property_count) {
+  for (size_t i = 0; i < object_count; i++) {
+    NDFObject obj;
+    obj.name = std::format("test_object_{}", i);
+    obj.class_name = std::format("TTestClass{}", i % 16);
+    obj.is_top_object = i % 8 == 0;
+    if (i % 4 == 0) {
+      obj.export_path = std::format("$/test/object_{}", i);
+    }
+    for (size_t j = 0; j < property_count; j++) {
+      switch (j % 3) {
+      case 0:
+        add_random_uint8(obj);
+        break;
+      case 1:
+        add_random_uint16(obj);
+        break;
+      default:
+        add_random_uint32(obj);
+        break;
+      }
+    }
+    obj.properties.push_back(gen_random_list(obj.properties.size()));
+    if (i > 0) {
+      add_object_reference(
+          obj, std::format("test_object_{}",
+                           std::experimental::randint<size_t>(0, i - 1)));
+    }
+    add_import_reference(obj, std::format("$/test/import_{}", i % 32));
+    ndf.add_object(std::move(obj));
   }
-
-  create_test_files(output_folder);
 }
-*/
@@ -22,6 +22,16 @@ void add_object_reference(NDFObject &obj, std::string ref);
 std::unique_ptr<NDFProperty> gen_import_reference(int idx, std::string ref);
 void add_import_reference(NDFObject &obj, std::string ref);
 
+// an object named all_types with a property of every type, the lists, maps
+// and pairs nest each other. it imports $/test/import and
+// $/test/pair_import and references no objects
+NDFObject gen_all_types_object();
+
+// adds object_count objects with property_count random scalar properties, a
+// list, a reference to a previous object and an import each
+void add_random_objects(NDF &ndf, size_t object_count,
+                        size_t property_count = 8);
+
 void create_edat(fs::path path,
                  std::unordered_map<std::string, std::string> files);
 
@@ -0,0 +1,335 @@
+// benchmarks for the ndf round trip pipeline, every benchmark runs on a
+// synthetic ndf created by ndf_generator and reports objects/s and bytes/s
+//
+// the object counts can be set with --ndf_objects=100,10000 in addition to
+// the usual google benchmark arguments, save_as_ndfbin_stream/large always
+// uses 100000 objects
+#include <benchmark/benchmark.h>
+
+#include "generator.hpp"
+#include "ndf_db.hpp"
+
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+fs::path bench_directory() { return fs::temp_directory_path() / "ndf_bench"; }
+
+void set_throughput(benchmark::State &state, size_t object_count,
+                    size_t bytes) {
+  state.SetItemsProcessed(state.iterations() * object_count);
+  if (bytes) {
+    state.SetBytesProcessed(state.iterations() * bytes);
+  }
+  state.counters["objects"] = object_count;
+}
+
+std::string save_ndfbin(NDF &ndf) {
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  return ss.str();
+}
+
+void BM_load_from_ndfbin_stream(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  std::string data = save_ndfbin(ndf);
+
+  for (auto _ : state) {
+    NDF loaded;
+    std::stringstream ss(data);
+    loaded.load_from_ndfbin_stream(ss);
+    benchmark::DoNotOptimize(loaded.object_map.size());
+  }
+  set_throughput(state, state.range(0), data.size());
+}
+
+void BM_load_from_ndfbin_parallel(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  std::string data = save_ndfbin(ndf);
+  std::span<const std::byte> buffer(
+      reinterpret_cast<const std::byte *>(data.data()), data.size());
+  unsigned jobs = std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (auto _ : state) {
+    NDF loaded;
+    loaded.load_from_ndfbin_buffer(buffer, jobs);
+    benchmark::DoNotOptimize(loaded.object_map.size());
+  }
+  set_throughput(state, state.range(0), data.size());
+}
+
+// opens the file and touches ten objects, the way most tools use a ndfbin
+void BM_load_from_ndfbin_lazy(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  fs::path path =
+      bench_directory() / std::format("lazy_{}.ndfbin", state.range(0));
+  ndf.save_as_ndfbin(path);
+  size_t size = fs::file_size(path);
+
+  for (auto _ : state) {
+    NDF loaded;
+    loaded.load_from_ndfbin_lazy(path);
+    for (int64_t i = 0; i < state.range(0); i += state.range(0) / 10 + 1) {
+      benchmark::DoNotOptimize(
+          loaded.get_object(std::format("Object_{}", i)).properties.size());
+    }
+  }
+  set_throughput(state, state.range(0), size);
+}
+
+void BM_save_as_ndfbin_stream(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  size_t size = 0;
+
+  for (auto _ : state) {
+    std::stringstream ss;
+    ndf.save_as_ndfbin_stream(ss);
+    size = ss.view().size();
+    benchmark::DoNotOptimize(size);
+  }
+  set_throughput(state, state.range(0), size);
+}
+
+void BM_load_from_ndf_xml(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  fs::path path =
+      bench_directory() / std::format("load_{}.xml", state.range(0));
+  ndf.save_as_ndf_xml(path);
+  size_t size = fs::file_size(path);
+
+  for (auto _ : state) {
+    NDF loaded;
+    loaded.load_from_ndf_xml(path);
+    benchmark::DoNotOptimize(loaded.object_map.size());
+  }
+  set_throughput(state, state.range(0), size);
+}
+
+void BM_load_from_ndf_xml_parallel(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  fs::path path =
+      bench_directory() / std::format("load_{}.xml", state.range(0));
+  ndf.save_as_ndf_xml(path);
+  size_t size = fs::file_size(path);
+  unsigned jobs = std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (auto _ : state) {
+    NDF loaded;
+    loaded.load_from_ndf_xml(path, jobs);
+    benchmark::DoNotOptimize(loaded.object_map.size());
+  }
+  set_throughput(state, state.range(0), size);
+}
+
+void BM_save_as_ndf_xml(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  fs::path path =
+      bench_directory() / std::format("save_{}.xml", state.range(0));
+
+  for (auto _ : state) {
+    ndf.save_as_ndf_xml(path);
+  }
+  set_throughput(state, state.range(0), fs::file_size(path));
+}
+
+void BM_ndf_db_insert_object(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  std::unique_ptr<NDF_DB> db;
+
+  for (auto _ : state) {
+    // the previous db gets destroyed outside of the measurement
+    state.PauseTiming();
+    db = std::make_unique<NDF_DB>();
+    db->init();
+    int ndf_file_id = db->insert_file("$/bench/file.ndfbin", "/tmp/bench",
+                                      "/tmp/bench", "bench")
+                          .value();
+    state.ResumeTiming();
+
+    for (const auto &[name, obj] : ndf.object_map) {
+      benchmark::DoNotOptimize(db->insert_object(ndf_file_id, obj));
+    }
+  }
+  set_throughput(state, state.range(0), 0);
+}
+
+void BM_ndf_db_insert_ndf(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  std::unique_ptr<NDF_DB> db;
+  int64_t rows = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    db = std::make_unique<NDF_DB>();
+    db->init();
+    int ndf_file_id = db->insert_file("$/bench/file.ndfbin", "/tmp/bench",
+                                      "/tmp/bench", "bench")
+                          .value();
+    state.ResumeTiming();
+
+    rows = db->insert_ndf(ndf_file_id, ndf).value().rows;
+  }
+  set_throughput(state, state.range(0), 0);
+  state.counters["rows/s"] = benchmark::Counter(
+      state.iterations() * rows, benchmark::Counter::kIsRate);
+}
+
+// keys like the ones save_as_ndfbin_stream puts into its tables: object
+// names, and export and import paths split into tran indices
+struct GenTableKeys {
+  std::vector<std::string> strings;
+  std::vector<std::vector<uint32_t>> paths;
+};
+
+GenTableKeys gen_table_keys(size_t object_count) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, object_count);
+  GenTableKeys keys;
+  std::map<std::string, uint32_t> trans;
+  auto add_path = [&](std::string_view path) {
+    std::vector<uint32_t> indices;
+    for (auto part : std::views::split(path, '/')) {
+      auto [it, _] = trans.try_emplace(std::string(part.begin(), part.end()),
+                                       trans.size());
+      indices.push_back(it->second);
+      keys.strings.push_back(it->first);
+    }
+    keys.paths.push_back(std::move(indices));
+  };
+  for (const auto &[idx, it] : ndf.object_map | std::views::enumerate) {
+    keys.strings.push_back(it.second.name);
+    keys.strings.push_back(it.second.class_name);
+    add_path(std::format("$/GFX/Unit/Descriptor_{}", it.second.name));
+    // the generator imports $/test/import_0 to 31
+    add_path(std::format("$/test/import_{}", idx % 32));
+  }
+  return keys;
+}
+
+// the tree maps save_as_ndfbin_stream used before NDFIndexTable. neither
+// benchmark reserves, std::map can not
+void BM_gen_tables_std_map(benchmark::State &state) {
+  auto keys = gen_table_keys(state.range(0));
+  for (auto _ : state) {
+    std::map<std::string, uint32_t> strings;
+    std::map<std::vector<uint32_t>, uint32_t> paths;
+    for (const auto &key : keys.strings) {
+      benchmark::DoNotOptimize(strings.try_emplace(key, strings.size()));
+    }
+    for (const auto &key : keys.paths) {
+      benchmark::DoNotOptimize(paths.try_emplace(key, paths.size()));
+    }
+  }
+  set_throughput(state, state.range(0), 0);
+  state.counters["keys"] = keys.strings.size() + keys.paths.size();
+}
+
+void BM_gen_tables_index_table(benchmark::State &state) {
+  auto keys = gen_table_keys(state.range(0));
+  for (auto _ : state) {
+    NDFIndexTable<std::string> strings;
+    NDFIndexTable<std::vector<uint32_t>> paths;
+    for (const auto &key : keys.strings) {
+      benchmark::DoNotOptimize(strings.insert(key));
+    }
+    for (const auto &key : keys.paths) {
+      benchmark::DoNotOptimize(paths.insert(key));
+    }
+  }
+  set_throughput(state, state.range(0), 0);
+  state.counters["keys"] = keys.strings.size() + keys.paths.size();
+}
+
+void BM_ndf_db_get_object(benchmark::State &state) {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, state.range(0));
+  NDF_DB db;
+  db.init();
+  int ndf_file_id =
+      db.insert_file("$/bench/file.ndfbin", "/tmp/bench", "/tmp/bench", "bench")
+          .value();
+  std::vector<int> object_ids;
+  for (const auto &[name, obj] : ndf.object_map) {
+    object_ids.push_back(db.insert_object(ndf_file_id, obj).value());
+  }
+
+  for (auto _ : state) {
+    for (int object_id : object_ids) {
+      auto obj = db.get_object(object_id);
+      benchmark::DoNotOptimize(obj);
+    }
+  }
+  set_throughput(state, state.range(0), 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  spdlog::set_level(spdlog::level::warn);
+
+  std::vector<int64_t> object_counts = {100, 1000};
+  // strip our own arguments before handing the rest to google benchmark
+  std::vector<char *> args;
+  for (int i = 0; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg.starts_with("--ndf_objects=")) {
+      object_counts.clear();
+      for (auto count : std::views::split(arg.substr(14), ',')) {
+        object_counts.push_back(
+            std::stoll(std::string(count.begin(), count.end())));
+      }
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  int args_count = args.size();
+  benchmark::Initialize(&args_count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(args_count, args.data())) {
+    return 1;
+  }
+
+  fs::create_directories(bench_directory());
+
+  const std::pair<const char *, void (*)(benchmark::State &)> benchmarks[] = {
+      {"load_from_ndfbin_stream", BM_load_from_ndfbin_stream},
+      {"load_from_ndfbin_parallel", BM_load_from_ndfbin_parallel},
+      {"load_from_ndfbin_lazy", BM_load_from_ndfbin_lazy},
+      {"save_as_ndfbin_stream", BM_save_as_ndfbin_stream},
+      {"load_from_ndf_xml", BM_load_from_ndf_xml},
+      {"load_from_ndf_xml_parallel", BM_load_from_ndf_xml_parallel},
+      {"save_as_ndf_xml", BM_save_as_ndf_xml},
+      {"gen_tables/std_map", BM_gen_tables_std_map},
+      {"gen_tables/index_table", BM_gen_tables_index_table},
+      {"NDF_DB::insert_object", BM_ndf_db_insert_object},
+      {"NDF_DB::insert_ndf", BM_ndf_db_insert_ndf},
+      {"NDF_DB::get_object", BM_ndf_db_get_object},
+  };
+  for (const auto &[name, fn] : benchmarks) {
+    auto *bench = benchmark::RegisterBenchmark(name, fn);
+    for (auto count : object_counts) {
+      bench->Arg(count);
+    }
+    bench->Unit(benchmark::kMillisecond);
+  }
+  // the generator tables grow with the file, only large files show their cost
+  benchmark::RegisterBenchmark("save_as_ndfbin_stream/large",
+                               BM_save_as_ndfbin_stream)
+      ->Arg(100000)
+      ->Unit(benchmark::kMillisecond);
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  fs::remove_all(bench_directory());
+  return 0;
+}
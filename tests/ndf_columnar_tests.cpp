@@ -0,0 +1,76 @@
+#include <catch2/catch_all.hpp>
+
+#include "catch2/catch_test_macros.hpp"
+#include "generator.hpp"
+#include "ndf_columnar.hpp"
+
+TEST_CASE("columnar store", "[ndf_columnar]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 40);
+  NDFColumnarStore store(ndf);
+
+  REQUIRE(store.object_count() == 40);
+
+  SECTION("objects of a class are a contiguous range") {
+    auto [begin, end] = store.get_class_range("TTestClass3");
+    REQUIRE(end - begin == 3);
+    for (uint32_t object = begin; object < end; object++) {
+      REQUIRE(store.get_class_name(object) == "TTestClass3");
+    }
+    auto [missing_begin, missing_end] = store.get_class_range("TMissing");
+    REQUIRE(missing_begin == missing_end);
+  }
+
+  SECTION("columns hold the values of every object") {
+    auto column = store.get_column<uint32_t>("TestUInt32_2");
+    REQUIRE(column.has_value());
+    REQUIRE(column->size() == 40);
+    for (size_t i = 0; i < column->size(); i++) {
+      auto &object = ndf.object_map.at(
+          store.get_object_name(column->objects[i]));
+      auto &property = static_cast<NDFPropertyUInt32 &>(
+          *object.properties.at(2));
+      REQUIRE(column->values[i] == property.value);
+    }
+  }
+
+  SECTION("columns can be limited to a class") {
+    auto column = store.get_column<uint8_t>("TestUInt8_0", "TTestClass5");
+    REQUIRE(column.has_value());
+    REQUIRE(column->size() == 3);
+    for (size_t i = 0; i < column->size(); i++) {
+      auto &object = ndf.object_map.at(
+          store.get_object_name(column->objects[i]));
+      REQUIRE(object.class_name == "TTestClass5");
+      auto &property = static_cast<NDFPropertyUInt8 &>(
+          *object.properties.at(0));
+      REQUIRE(column->values[i] == property.value);
+      REQUIRE(store.get_value<uint8_t>(column->objects[i], "TestUInt8_0") ==
+              property.value);
+    }
+  }
+
+  SECTION("only scalars with a matching type have columns") {
+    REQUIRE_FALSE(store.get_column<uint16_t>("TestUInt8_0").has_value());
+    REQUIRE_FALSE(store.get_column<uint32_t>("TestList_8").has_value());
+    REQUIRE_FALSE(store.get_column<float>("MaxSpeed").has_value());
+  }
+}
+
+TEST_CASE("columnar store scalar types", "[ndf_columnar]") {
+  NDF ndf;
+  ndf.add_object(ndf_generator::gen_all_types_object());
+  NDFColumnarStore store(ndf);
+
+  REQUIRE(store.get_value<bool>(0, "Property_0") == true);
+  REQUIRE(store.get_value<uint8_t>(0, "Property_1") == 200);
+  REQUIRE(store.get_value<int16_t>(0, "Property_2") == -1234);
+  REQUIRE(store.get_value<uint16_t>(0, "Property_3") == 54321);
+  REQUIRE(store.get_value<int32_t>(0, "Property_4") == -123456789);
+  REQUIRE(store.get_value<uint32_t>(0, "Property_5") == 3000000000);
+  REQUIRE(store.get_value<float>(0, "Property_6") == 1.5f);
+  auto column = store.get_column<double>("Property_7");
+  REQUIRE(column.has_value());
+  REQUIRE(column->size() == 1);
+  REQUIRE(column->values[0] == -2.25);
+}
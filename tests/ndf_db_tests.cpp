@@ -115,6 +115,33 @@ bool check_property_equality(NDFProperty *prop1, NDFProperty *prop2) {
       }
     }
   }
+  if (prop1->is_map()) {
+    NDFPropertyMap *map1 = (NDFPropertyMap *)(prop1);
+    NDFPropertyMap *map2 = (NDFPropertyMap *)(prop2);
+    REQUIRE(map1->values.size() == map2->values.size());
+    for (size_t x = 0; x < map1->values.size(); x++) {
+      if (!check_property_equality(map1->values[x].first.get(),
+                                   map2->values[x].first.get()) ||
+          !check_property_equality(map1->values[x].second.get(),
+                                   map2->values[x].second.get())) {
+        return false;
+      }
+    }
+  }
+  if (prop1->is_pair()) {
+    NDFPropertyPair *pair1 = (NDFPropertyPair *)(prop1);
+    NDFPropertyPair *pair2 = (NDFPropertyPair *)(prop2);
+    if (!check_property_equality(pair1->first.get(), pair2->first.get()) ||
+        !check_property_equality(pair1->second.get(), pair2->second.get())) {
+      return false;
+    }
+  }
+  if (!prop1->is_list() && !prop1->is_map() && !prop1->is_pair() &&
+      prop1->as_string() != prop2->as_string()) {
+    spdlog::info("value {} differs from {}", prop1->as_string(),
+                 prop2->as_string());
+    return false;
+  }
   return true;
 }
 
@@ -185,6 +212,62 @@ TEST_CASE_PERSISTENT_FIXTURE(PyFixture, "ndf_db tests", "[ndf_db]") {
     REQUIRE(check_object_equality(&obj1, &db_obj.value()));
   }
 
+  SECTION("hydrating maps and pairs") {
+    NDF_DB db;
+    db.init();
+    auto ndf_file_id_opt =
+        db.insert_file("$/test/file.ndfbin", "/tmp/foo", "/tmp/bar", "test");
+    REQUIRE(ndf_file_id_opt.has_value());
+
+    // ends with a map of string -> (int16, [vec2]) and a (color, import
+    // reference) pair
+    auto obj = ndf_generator::gen_all_types_object();
+    auto obj_id_opt = db.insert_object(ndf_file_id_opt.value(), obj);
+    REQUIRE(obj_id_opt.has_value());
+
+    auto db_obj = db.get_object(obj_id_opt.value());
+    REQUIRE(db_obj.has_value());
+    REQUIRE(check_object_equality(&obj, &db_obj.value()));
+    auto &properties = db_obj.value().properties;
+    auto &map =
+        dynamic_cast<NDFPropertyMap &>(*properties[properties.size() - 2]);
+    REQUIRE(map.values.size() == 2);
+    auto &value = dynamic_cast<NDFPropertyPair &>(*map.values[1].second);
+    REQUIRE(dynamic_cast<NDFPropertyInt16 &>(*value.first).value == 1);
+    auto &pair = dynamic_cast<NDFPropertyPair &>(*properties.back());
+    REQUIRE(dynamic_cast<NDFPropertyImportReference &>(*pair.second)
+                .import_name == "$/test/pair_import");
+  }
+
+  SECTION("missing value rows") {
+    fs::path db_path = fs::temp_directory_path() / "ndf_db_missing_test.db";
+    fs::remove(db_path);
+    auto obj = ndf_generator::gen_all_types_object();
+    int obj_id;
+    {
+      NDF_DB db;
+      REQUIRE(db.init(db_path));
+      auto ndf_file_id_opt =
+          db.insert_file("$/test/file.ndfbin", "/tmp/foo", "/tmp/bar", "test");
+      REQUIRE(ndf_file_id_opt.has_value());
+      auto obj_id_opt = db.insert_object(ndf_file_id_opt.value(), obj);
+      REQUIRE(obj_id_opt.has_value());
+      obj_id = obj_id_opt.value();
+    }
+    // the uint32 property is left without its value row
+    sqlite3 *raw;
+    REQUIRE(sqlite3_open(db_path.string().c_str(), &raw) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(raw, "DELETE FROM ndf_uint32;", nullptr, nullptr,
+                         nullptr) == SQLITE_OK);
+    sqlite3_close(raw);
+    {
+      NDF_DB db;
+      REQUIRE(db.init(db_path));
+      REQUIRE_FALSE(db.get_object(obj_id).has_value());
+    }
+    fs::remove(db_path);
+  }
+
   SECTION("changing object names") {
     NDF_DB db;
     db.init();
@@ -270,4 +353,63 @@ TEST_CASE_PERSISTENT_FIXTURE(PyFixture, "ndf_db tests", "[ndf_db]") {
         (NDFPropertyImportReference *)db_obj.value().properties[5].get();
     REQUIRE(import_ref->import_name == "$/test/new_path");
   }
+
+  SECTION("bulk inserting a whole ndf") {
+    fs::path db_path = fs::temp_directory_path() / "ndf_db_bulk_test.db";
+    fs::remove(db_path);
+    NDF ndf;
+    ndf_generator::add_random_objects(ndf, 50);
+    {
+      NDF_DB db;
+      REQUIRE(db.init(db_path));
+      auto ndf_file_id_opt =
+          db.insert_file("$/test/file.ndfbin", "/tmp/foo", "/tmp/bar", "test");
+      REQUIRE(ndf_file_id_opt.has_value());
+
+      NDFIngestOptions options;
+      options.fast_journal = true;
+      auto stats = db.insert_ndf(ndf_file_id_opt.value(), ndf, options);
+      REQUIRE(stats.has_value());
+      REQUIRE(stats->objects == 50);
+      REQUIRE(stats->rows > 50);
+
+      // object ids are handed out in insertion order
+      int object_id = 1;
+      for (auto it = ndf.object_map.begin(); it != ndf.object_map.end(); ++it) {
+        auto db_obj = db.get_object(object_id++);
+        REQUIRE(db_obj.has_value());
+        REQUIRE(check_object_equality(&it.value(), &db_obj.value()));
+      }
+    }
+    fs::remove(db_path);
+  }
+
+  SECTION("reopening a migrated database") {
+    fs::path db_path = fs::temp_directory_path() / "ndf_db_migration_test.db";
+    fs::remove(db_path);
+    NDF ndf;
+    ndf_generator::add_random_objects(ndf, 20);
+    {
+      NDF_DB db;
+      REQUIRE(db.init(db_path));
+      REQUIRE(db.get_schema_version() == 2);
+      auto ndf_file_id_opt =
+          db.insert_file("$/test/file.ndfbin", "/tmp/foo", "/tmp/bar", "test");
+      REQUIRE(ndf_file_id_opt.has_value());
+      NDFIngestOptions options;
+      options.defer_indices = true;
+      REQUIRE(db.insert_ndf(ndf_file_id_opt.value(), ndf, options));
+    }
+    {
+      // the tables and indices exist already, init must not fail on them
+      NDF_DB db;
+      REQUIRE(db.init(db_path));
+      REQUIRE(db.get_schema_version() == 2);
+      auto db_obj = db.get_object(1);
+      REQUIRE(db_obj.has_value());
+      REQUIRE(check_object_equality(&ndf.object_map.begin().value(),
+                                    &db_obj.value()));
+    }
+    fs::remove(db_path);
+  }
 }
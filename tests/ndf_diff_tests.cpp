@@ -0,0 +1,207 @@
+#include <catch2/catch_all.hpp>
+
+#include "catch2/catch_test_macros.hpp"
+#include "generator.hpp"
+#include "ndf_diff.hpp"
+
+static void copy_objects(const NDF &from, NDF &to) {
+  for (const auto &[name, object] : from.object_map) {
+    to.add_object(object.get_copy());
+  }
+}
+
+static NDFProperty &find_property(NDFObject &object, std::string_view name) {
+  for (auto &property : object.properties) {
+    if (property->property_name == name) {
+      return *property;
+    }
+  }
+  FAIL("missing property " << name);
+  throw std::logic_error("unreachable");
+}
+
+static std::vector<std::string> change_paths(const NDFObjectChange &change) {
+  std::vector<std::string> ret;
+  for (const auto &property : change.properties) {
+    ret.push_back(property.path_string());
+  }
+  return ret;
+}
+
+TEST_CASE("structural diff", "[ndf_diff]") {
+  NDF from;
+  ndf_generator::add_random_objects(from, 40);
+  from.add_object(ndf_generator::gen_all_types_object());
+  NDF to;
+  copy_objects(from, to);
+
+  SECTION("equal objects have equal hashes") {
+    for (const auto &[name, object] : from.object_map) {
+      REQUIRE(ndf_object_hash(object) == ndf_object_hash(to.get_object(name)));
+    }
+    REQUIRE(diff_ndf(from, to).empty());
+  }
+
+  SECTION("changes are found and applied") {
+    auto &list_object = to.get_object("test_object_3");
+    auto &list = static_cast<NDFPropertyList &>(
+        find_property(list_object, "TestList_8"));
+    static_cast<NDFPropertyUInt32 &>(*list.values[4]).value += 1;
+
+    to.get_object("test_object_5").class_name = "TChangedClass";
+
+    auto &removed_from = to.get_object("test_object_6");
+    removed_from.properties.erase(removed_from.properties.begin());
+
+    auto added = ndf_generator::gen_random_uint32(-1);
+    added->property_name = "TestAdded";
+    to.get_object("test_object_7").properties.push_back(std::move(added));
+
+    auto &grown = static_cast<NDFPropertyList &>(
+        find_property(to.get_object("test_object_8"), "TestList_8"));
+    grown.values.push_back(ndf_generator::gen_random_uint32(-1));
+
+    to.remove_object("test_object_9");
+    auto new_object = to.get_object("test_object_1").get_copy();
+    new_object.name = "test_object_new";
+    to.add_object(std::move(new_object));
+
+    auto diff = diff_ndf(from, to);
+    REQUIRE(diff.removed_objects == std::vector<std::string>{"test_object_9"});
+    REQUIRE(diff.added_objects.size() == 1);
+    REQUIRE(diff.added_objects[0].name == "test_object_new");
+    REQUIRE(diff.changed_objects.size() == 5);
+
+    const auto &changes = diff.changed_objects;
+    REQUIRE(changes[0].name == "test_object_3");
+    REQUIRE(change_paths(changes[0]) ==
+            std::vector<std::string>{"TestList_8[4]"});
+    REQUIRE(changes[1].name == "test_object_5");
+    REQUIRE(changes[1].header_changed);
+    REQUIRE(changes[1].class_name == "TChangedClass");
+    REQUIRE(changes[1].properties.empty());
+    REQUIRE(changes[2].properties.size() == 1);
+    REQUIRE(changes[2].properties[0].kind == NDFPropertyChange::Removed);
+    REQUIRE(changes[3].properties.size() == 1);
+    REQUIRE(changes[3].properties[0].kind == NDFPropertyChange::Added);
+    REQUIRE(changes[3].properties[0].position == 11);
+    // lists that changed their size are replaced as a whole
+    REQUIRE(change_paths(changes[4]) ==
+            std::vector<std::string>{"TestList_8"});
+
+    auto parallel = diff_ndf(from, to, 4);
+    REQUIRE(parallel.changed_objects.size() == changes.size());
+    for (size_t i = 0; i < changes.size(); i++) {
+      REQUIRE(parallel.changed_objects[i].name == changes[i].name);
+      REQUIRE(change_paths(parallel.changed_objects[i]) ==
+              change_paths(changes[i]));
+    }
+
+    apply_ndf_diff(from, diff);
+    REQUIRE(from.object_map.size() == to.object_map.size());
+    for (const auto &[name, object] : to.object_map) {
+      REQUIRE(from.object_map.contains(name));
+      REQUIRE(ndf_object_hash(from.get_object(name)) ==
+              ndf_object_hash(object));
+    }
+    REQUIRE(diff_ndf(from, to).empty());
+  }
+
+  SECTION("changes in maps and pairs are found and applied") {
+    auto &object = to.get_object("all_types");
+    // string -> (int16, [vec2])
+    auto &map =
+        static_cast<NDFPropertyMap &>(find_property(object, "Property_22"));
+    static_cast<NDFPropertyString &>(*map.values[1].first).value = "changed";
+    auto &map_value = static_cast<NDFPropertyPair &>(*map.values[0].second);
+    auto &vec = static_cast<NDFPropertyF32_vec2 &>(
+        *static_cast<NDFPropertyList &>(*map_value.second).values[0]);
+    vec.x = 42.0f;
+    // (color, import reference)
+    auto &pair =
+        static_cast<NDFPropertyPair &>(find_property(object, "Property_23"));
+    static_cast<NDFPropertyColor &>(*pair.first).a = 99;
+    static_cast<NDFPropertyImportReference &>(*pair.second).import_name =
+        "$/test/changed";
+
+    auto diff = diff_ndf(from, to);
+    REQUIRE(diff.changed_objects.size() == 1);
+    const auto &change = diff.changed_objects[0];
+    REQUIRE(change.name == "all_types");
+    REQUIRE(change_paths(change) ==
+            std::vector<std::string>{"Property_22[0].Value.Second[0]",
+                                     "Property_22[1].Key", "Property_23.First",
+                                     "Property_23.Second"});
+    const auto &steps = change.properties[0].path;
+    REQUIRE(steps.size() == 3);
+    REQUIRE(steps[0].kind == NDFPropertyPathStep::MapValue);
+    REQUIRE(steps[1].kind == NDFPropertyPathStep::PairSecond);
+    REQUIRE(steps[2].kind == NDFPropertyPathStep::ListItem);
+    REQUIRE(change.properties[1].path[0].kind == NDFPropertyPathStep::MapKey);
+    REQUIRE(change.properties[1].path[0].index == 1);
+    REQUIRE(change.properties[2].path[0].kind ==
+            NDFPropertyPathStep::PairFirst);
+    REQUIRE(change.properties[3].value->as_string() ==
+            pair.second->as_string());
+
+    SECTION("the changed items are replaced") {
+      apply_ndf_diff(from, diff);
+      auto &applied = from.get_object("all_types");
+      REQUIRE(ndf_object_hash(applied) == ndf_object_hash(object));
+      auto &applied_map =
+          static_cast<NDFPropertyMap &>(find_property(applied, "Property_22"));
+      REQUIRE(static_cast<NDFPropertyString &>(*applied_map.values[1].first)
+                  .value == "changed");
+      REQUIRE(diff_ndf(from, to).empty());
+    }
+
+    SECTION("map entries that do not exist throw") {
+      auto &from_map = static_cast<NDFPropertyMap &>(
+          find_property(from.get_object("all_types"), "Property_22"));
+      from_map.values.pop_back();
+      REQUIRE_THROWS_AS(apply_ndf_diff(from, diff), std::runtime_error);
+    }
+
+    SECTION("paths through other types throw") {
+      auto &from_object = from.get_object("all_types");
+      auto &from_pair = find_property(from_object, "Property_23");
+      auto replacement = ndf_generator::gen_random_uint32(-1);
+      replacement->property_name = "Property_23";
+      for (auto &property : from_object.properties) {
+        if (property.get() == &from_pair) {
+          property = std::move(replacement);
+        }
+      }
+      REQUIRE_THROWS_AS(apply_ndf_diff(from, diff), std::runtime_error);
+    }
+  }
+
+  SECTION("reordered properties are found and applied") {
+    auto &object = to.get_object("test_object_4");
+    std::swap(object.properties[0], object.properties[2]);
+    REQUIRE(ndf_object_hash(object) !=
+            ndf_object_hash(from.get_object("test_object_4")));
+
+    auto diff = diff_ndf(from, to);
+    REQUIRE(diff.changed_objects.size() == 1);
+    const auto &change = diff.changed_objects[0];
+    REQUIRE(change.properties.empty());
+    REQUIRE(change.property_order.size() == object.properties.size());
+    for (size_t i = 0; i < object.properties.size(); i++) {
+      REQUIRE(change.property_order[i] == object.properties[i]->property_name);
+    }
+
+    apply_ndf_diff(from, diff);
+    REQUIRE(ndf_object_hash(from.get_object("test_object_4")) ==
+            ndf_object_hash(object));
+    REQUIRE(diff_ndf(from, to).empty());
+  }
+
+  SECTION("diffs only apply to matching objects") {
+    to.get_object("test_object_2").class_name = "TChangedClass";
+    auto diff = diff_ndf(from, to);
+    NDF other;
+    ndf_generator::add_random_objects(other, 2);
+    REQUIRE_THROWS_AS(apply_ndf_diff(other, diff), std::runtime_error);
+  }
+}
@@ -0,0 +1,124 @@
+#include <catch2/catch_all.hpp>
+
+#include <set>
+#include <sstream>
+
+#include "catch2/catch_test_macros.hpp"
+#include "generator.hpp"
+#include "ndf_value.hpp"
+
+TEST_CASE("variant property values", "[ndf_value]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 20);
+  ndf.add_object(ndf_generator::gen_all_types_object());
+
+  // the decoder looks imports up in import_name_table, the loaders fill it
+  for (auto &[name, object] : ndf.object_map) {
+    for (const auto &import : object.get_import_references()) {
+      ndf.import_name_table[ndf.get_or_add_impr(import)] = import;
+    }
+  }
+
+  SECTION("every type is covered") {
+    std::set<uint32_t> types;
+    for (const auto &property : ndf.get_object("all_types").properties) {
+      types.insert(property->property_type);
+    }
+    // both references are type 9
+    REQUIRE(types.size() == std::variant_size_v<NDFValue::Storage> - 1);
+  }
+
+  SECTION("values convert to and from properties") {
+    for (auto &[name, object] : ndf.object_map) {
+      for (const auto &property : object.properties) {
+        auto value = NDFValue::from_property(*property);
+        REQUIRE(value.ndf_type() == property->property_type);
+        REQUIRE(value.as_string() == property->as_string());
+
+        auto converted = value.to_property();
+        REQUIRE(converted->property_type == property->property_type);
+        REQUIRE(converted->as_string() == property->as_string());
+        REQUIRE(NDFValue::from_property(*converted) == value);
+      }
+    }
+  }
+
+  SECTION("color channels keep their order") {
+    auto value = NDFValue::from_property(
+        *ndf.get_object("all_types").get_property("Color"));
+    // b, g, r, a like in the file
+    REQUIRE(value.get<NDFColorValue>().value ==
+            std::array<uint8_t, 4>{30, 20, 10, 40});
+    REQUIRE(value.as_string() == "(10, 20, 30, 40)");
+  }
+
+  SECTION("values encode like properties") {
+    for (auto &[name, object] : ndf.object_map) {
+      for (const auto &property : object.properties) {
+        auto value = NDFValue::from_property(*property);
+
+        std::stringstream property_stream;
+        property->to_ndfbin(&ndf, property_stream);
+        BinaryWriter writer;
+        value.to_ndfbin(ndf, writer);
+        std::string value_bytes(
+            reinterpret_cast<const char *>(writer.data().data()),
+            writer.size());
+        REQUIRE(value_bytes == property_stream.str());
+
+        // the string table of the loader, at the indices the encoder took
+        auto add_string = [&](const std::string &str) {
+          uint32_t idx = ndf.get_or_add_string(str);
+          if (ndf.string_table.size() <= idx) {
+            ndf.string_table.resize(idx + 1);
+          }
+          ndf.string_table[idx] = str;
+        };
+        value.for_each<NDFStringValue>(
+            [&](NDFStringValue &str) { add_string(str.value); });
+        value.for_each<NDFPathReferenceValue>(
+            [&](NDFPathReferenceValue &path) { add_string(path.value); });
+
+        BinaryCursor cursor(writer.data());
+        auto decoded = NDFValue::from_ndfbin(value.ndf_type(), cursor, ndf);
+        REQUIRE(cursor.remaining() == 0);
+        // the decoder names referenced objects by their index
+        bool has_object_references = false;
+        value.for_each_object_reference(
+            [&](const std::string &) { has_object_references = true; });
+        if (!has_object_references) {
+          REQUIRE(decoded == value);
+        }
+      }
+    }
+  }
+
+  SECTION("references are found in nested values") {
+    NDFListValue list;
+    list.values.push_back(NDFObjectReferenceValue{"Object_1"});
+    list.values.push_back(
+        NDFPairValue(NDFImportReferenceValue{"$/Import/A"},
+                     NDFObjectReferenceValue{"Object_2"}));
+    NDFMapValue map;
+    map.values.emplace_back(NDFStringValue{"key"},
+                            NDFObjectReferenceValue{"Object_3"});
+    list.values.push_back(std::move(map));
+    NDFValue value(std::move(list));
+
+    std::vector<std::string> objects;
+    value.for_each_object_reference(
+        [&](const std::string &name) { objects.push_back(name); });
+    REQUIRE(objects ==
+            std::vector<std::string>{"Object_1", "Object_2", "Object_3"});
+    std::vector<std::string> imports;
+    value.for_each_import_reference(
+        [&](const std::string &name) { imports.push_back(name); });
+    REQUIRE(imports == std::vector<std::string>{"$/Import/A"});
+
+    NDFValue copy = value;
+    REQUIRE(copy == value);
+    copy.get<NDFListValue>().values.at(1).get<NDFPairValue>().second =
+        std::make_unique<NDFValue>(NDFObjectReferenceValue{"Object_4"});
+    REQUIRE_FALSE(copy == value);
+  }
+}
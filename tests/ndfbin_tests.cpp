@@ -0,0 +1,499 @@
+#include <catch2/catch_all.hpp>
+
+#include "catch2/catch_test_macros.hpp"
+#include "generator.hpp"
+#include "ndf_properties.hpp"
+#include "ndf_index_table.hpp"
+#include "ndf_xml_writer.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <streambuf>
+
+static NDF create_test_ndf() {
+  NDF ndf;
+  auto obj1 = ndf_generator::gen_random_object();
+  ndf_generator::add_random_uint8(obj1);
+  ndf_generator::add_random_uint16(obj1);
+  ndf_generator::add_random_uint32(obj1);
+  ndf_generator::add_object_reference(obj1, "test_object");
+  ndf_generator::add_import_reference(obj1, "$/foo/bar");
+  ndf.add_object(std::move(obj1));
+  return ndf;
+}
+
+TEST_CASE("ndfbin buffer loader", "[ndfbin]") {
+  auto ndf = create_test_ndf();
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  std::string data = ss.str();
+  std::span<const std::byte> buffer(
+      reinterpret_cast<const std::byte *>(data.data()), data.size());
+
+  SECTION("stream and buffer loader produce the same file") {
+    NDF from_buffer;
+    from_buffer.load_from_ndfbin_buffer(buffer);
+    std::stringstream ss_buffer;
+    from_buffer.save_as_ndfbin_stream(ss_buffer);
+
+    NDF from_stream;
+    std::stringstream in(data);
+    from_stream.load_from_ndfbin_stream(in);
+    std::stringstream ss_stream;
+    from_stream.save_as_ndfbin_stream(ss_stream);
+
+    REQUIRE(from_buffer.object_map.size() == 1);
+    REQUIRE(ss_buffer.str() == data);
+    REQUIRE(ss_stream.str() == data);
+  }
+
+  SECTION("truncated files throw instead of reading past the end") {
+    NDF truncated;
+    REQUIRE_THROWS_AS(
+        truncated.load_from_ndfbin_buffer(buffer.first(buffer.size() - 8)),
+        std::runtime_error);
+  }
+}
+
+// replaces the first occurrence of from in data, which has to exist
+static void patch_bytes(std::string &data, std::span<const uint32_t> from,
+                        std::span<const uint32_t> to) {
+  std::string_view needle(reinterpret_cast<const char *>(from.data()),
+                          from.size_bytes());
+  auto pos = data.find(needle);
+  REQUIRE(pos != std::string::npos);
+  data.replace(pos, needle.size(), reinterpret_cast<const char *>(to.data()),
+               to.size_bytes());
+}
+
+TEST_CASE("corrupt string indices", "[ndfbin]") {
+  NDF ndf;
+  auto obj = ndf_generator::gen_random_object();
+  auto string = std::make_unique<NDFPropertyString>();
+  string->property_name = "TestString";
+  string->value = "text";
+  obj.properties.push_back(std::move(string));
+  auto path = std::make_unique<NDFPropertyPathReference>();
+  path->property_name = "TestPath";
+  path->path = "$/path";
+  obj.properties.push_back(std::move(path));
+  ndf.add_object(std::move(obj));
+
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  std::string data = ss.str();
+
+  // the object is stored as property index, type and string table index
+  // per property. properties are indexed by name, strings in order of use
+  SECTION("string") {
+    const uint32_t from[] = {1, NDFPropertyType::String, 0};
+    const uint32_t to[] = {1, NDFPropertyType::String, 1000};
+    patch_bytes(data, from, to);
+  }
+  SECTION("path reference") {
+    const uint32_t from[] = {0, NDFPropertyType::PathReference, 1};
+    const uint32_t to[] = {0, NDFPropertyType::PathReference, 1000};
+    patch_bytes(data, from, to);
+  }
+  NDF corrupt;
+  REQUIRE_THROWS_AS(
+      corrupt.load_from_ndfbin_buffer(std::as_bytes(std::span(data))),
+      std::out_of_range);
+}
+
+TEST_CASE("streaming xml writer", "[ndf_xml]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 20);
+  // export path with characters that have to be escaped
+  auto escaped = ndf_generator::gen_random_object();
+  escaped.export_path = "$/a<b>&\"c\"\t";
+  ndf_generator::add_random_list(escaped);
+  ndf.add_object(std::move(escaped));
+
+  SECTION("same bytes as the pugixml document") {
+    pugi::xml_document doc;
+    auto root = doc.append_child("NDF");
+    for (const auto &[name, obj] : ndf.object_map) {
+      auto object_node = root.append_child(obj.name.c_str());
+      object_node.append_attribute("class") = obj.class_name.c_str();
+      object_node.append_attribute("export_path") = obj.export_path.c_str();
+      object_node.append_attribute("is_top_object") = obj.is_top_object;
+      for (const auto &prop : obj.properties) {
+        prop->to_ndf_xml(object_node);
+      }
+    }
+    std::stringstream expected;
+    doc.save(expected);
+
+    std::stringstream streamed;
+    ndf.save_as_ndf_xml_stream(streamed);
+    REQUIRE(streamed.str() == expected.str());
+  }
+
+  SECTION("elements are closed by finish") {
+    std::stringstream ss;
+    {
+      NDFXmlWriter writer(ss);
+      writer.start_element("a");
+      writer.start_element("b");
+      writer.attribute("x", 1.5f);
+    }
+    REQUIRE(ss.str() == "<?xml version=\"1.0\"?>\n<a>\n\t<b x=\"1.5\" />\n</a>\n");
+  }
+}
+
+TEST_CASE("parallel xml loader", "[ndf_xml]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 50);
+  fs::path path = fs::temp_directory_path() / "parallel_xml_loader_test.xml";
+  ndf.save_as_ndf_xml(path);
+
+  NDF serial;
+  serial.load_from_ndf_xml(path);
+  std::stringstream ss_serial;
+  serial.save_as_ndfbin_stream(ss_serial);
+
+  for (unsigned jobs : {2u, 7u, 64u}) {
+    NDF parallel;
+    parallel.load_from_ndf_xml(path, jobs);
+    REQUIRE(parallel.object_map.size() == serial.object_map.size());
+    REQUIRE(std::ranges::equal(parallel.object_map | std::views::keys,
+                               serial.object_map | std::views::keys));
+    std::stringstream ss_parallel;
+    parallel.save_as_ndfbin_stream(ss_parallel);
+    REQUIRE(ss_parallel.str() == ss_serial.str());
+  }
+}
+
+TEST_CASE("parallel ndfbin loader", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 50);
+  // every property type, so skip_ndfbin has to step over each of them
+  for (int i = 0; i < 20; i++) {
+    auto obj = ndf_generator::gen_all_types_object();
+    obj.name = std::format("all_types_{}", i);
+    obj.export_path = std::format("$/test/all_types_{}", i);
+    ndf.add_object(std::move(obj));
+  }
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  std::string data = ss.str();
+  std::span<const std::byte> buffer(
+      reinterpret_cast<const std::byte *>(data.data()), data.size());
+
+  NDF serial;
+  serial.load_from_ndfbin_buffer(buffer);
+  std::stringstream ss_serial;
+  serial.save_as_ndfbin_stream(ss_serial);
+  REQUIRE(ss_serial.str() == data);
+
+  for (unsigned jobs : {2u, 7u, 64u}) {
+    NDF parallel;
+    parallel.load_from_ndfbin_buffer(buffer, jobs);
+    REQUIRE(std::ranges::equal(parallel.object_map | std::views::keys,
+                               serial.object_map | std::views::keys));
+    std::stringstream ss_parallel;
+    parallel.save_as_ndfbin_stream(ss_parallel);
+    REQUIRE(ss_parallel.str() == data);
+  }
+}
+
+TEST_CASE("move assignment of loaded ndfs", "[ndfbin]") {
+  // the properties of both live in the arenas of their NDF
+  auto load = [](size_t object_count, std::string &data) {
+    NDF ndf;
+    ndf_generator::add_random_objects(ndf, object_count);
+    std::stringstream ss;
+    ndf.save_as_ndfbin_stream(ss);
+    data = ss.str();
+    NDF loaded;
+    loaded.load_from_ndfbin_buffer(std::as_bytes(std::span(data)));
+    return loaded;
+  };
+  std::string target_data;
+  std::string source_data;
+  NDF target = load(30, target_data);
+  NDF source = load(20, source_data);
+
+  target = std::move(source);
+  REQUIRE(target.object_map.size() == 20);
+  std::stringstream ss;
+  target.save_as_ndfbin_stream(ss);
+  REQUIRE(ss.str() == source_data);
+}
+
+TEST_CASE("lazy ndfbin loader", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 20);
+  fs::path path = fs::temp_directory_path() / "lazy_ndfbin_loader_test.ndfbin";
+  ndf.save_as_ndfbin(path);
+
+  NDF eager;
+  eager.load_from_ndfbin(path);
+  std::stringstream ss_eager;
+  eager.save_as_ndfbin_stream(ss_eager);
+
+  NDF lazy;
+  lazy.load_from_ndfbin_lazy(path);
+  REQUIRE(lazy.has_lazy_objects());
+  REQUIRE(std::ranges::equal(lazy.object_map | std::views::keys,
+                             eager.object_map | std::views::keys));
+  REQUIRE(lazy.object_map.at("Object_3").properties.empty());
+  REQUIRE(lazy.object_map.at("Object_3").class_name ==
+          eager.object_map.at("Object_3").class_name);
+
+  SECTION("get_object decodes a single object") {
+    auto &object = lazy.get_object("Object_3");
+    REQUIRE(object.properties.size() ==
+            eager.get_object("Object_3").properties.size());
+    REQUIRE(lazy.object_map.at("Object_4").properties.empty());
+    REQUIRE(lazy.has_lazy_objects());
+  }
+
+  SECTION("saving decodes everything") {
+    std::stringstream ss_lazy;
+    lazy.save_as_ndfbin_stream(ss_lazy);
+    REQUIRE_FALSE(lazy.has_lazy_objects());
+    REQUIRE(ss_lazy.str() == ss_eager.str());
+  }
+
+  SECTION("pending objects can be removed") {
+    REQUIRE(lazy.remove_object("Object_19"));
+    lazy.load_lazy_objects();
+    REQUIRE(lazy.object_map.size() == 19);
+  }
+
+  SECTION("the reference index sees pending objects") {
+    REQUIRE(lazy.get_referencing_objects("Object_3") ==
+            eager.get_referencing_objects("Object_3"));
+  }
+
+  // unmaps the file
+  lazy.load_lazy_objects();
+  fs::remove(path);
+}
+
+TEST_CASE("reference index", "[ndf]") {
+  NDF ndf;
+  for (auto name : {"a", "b", "c"}) {
+    auto obj = ndf_generator::gen_random_object();
+    obj.name = name;
+    ndf.add_object(std::move(obj));
+  }
+  ndf_generator::add_object_reference(ndf.get_object("b"), "a");
+  ndf.get_object("c").properties.push_back(ndf_generator::gen_random_list(0));
+  auto &list =
+      static_cast<NDFPropertyList &>(*ndf.get_object("c").properties.back());
+  list.values.push_back(ndf_generator::gen_object_reference(0, "a"));
+  list.values.push_back(ndf_generator::gen_object_reference(0, "b"));
+
+  auto object_name = [&](const std::string &object, size_t property) {
+    return static_cast<NDFPropertyObjectReference &>(
+               *ndf.get_object(object).properties.at(property))
+        .object_name;
+  };
+
+  // sorted, the order of the index is not specified
+  auto referencing = [&](const std::string &name) {
+    auto ret = ndf.get_referencing_objects(name);
+    std::ranges::sort(ret);
+    return ret;
+  };
+
+  REQUIRE(referencing("a") == std::vector<std::string>{"b", "c"});
+  REQUIRE(referencing("c").empty());
+
+  SECTION("rename fixes references and keeps the index") {
+    REQUIRE(ndf.change_object_name("a", "x"));
+    REQUIRE(object_name("b", 0) == "x");
+    REQUIRE(referencing("a").empty());
+    REQUIRE(referencing("x") == std::vector<std::string>{"b", "c"});
+
+    REQUIRE(ndf.change_object_name("b", "y"));
+    REQUIRE(object_name("y", 0) == "x");
+    REQUIRE(referencing("x") == std::vector<std::string>{"c", "y"});
+    REQUIRE(referencing("y") == std::vector<std::string>{"c"});
+  }
+
+  SECTION("bulk renames") {
+    REQUIRE(ndf.bulk_rename_objects({{"b", "y"}, {"c", "z"}}));
+    REQUIRE(object_name("y", 0) == "a");
+    REQUIRE(referencing("a").size() == 2);
+    REQUIRE(referencing("y") == std::vector<std::string>{"z"});
+  }
+
+  SECTION("removed objects leave the index") {
+    REQUIRE(ndf.remove_object("c"));
+    REQUIRE(referencing("a") == std::vector<std::string>{"b"});
+    REQUIRE(referencing("b").empty());
+    REQUIRE(ndf.copy_object("b", "d"));
+    REQUIRE(referencing("a") == std::vector<std::string>{"b", "d"});
+  }
+}
+
+TEST_CASE("object renames", "[ndf]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 10);
+  auto names = [&]() {
+    std::vector<std::string> ret;
+    for (const auto &[name, object] : ndf.object_map) {
+      REQUIRE(name == object.name);
+      ret.push_back(name);
+    }
+    return ret;
+  };
+
+  SECTION("renamed objects keep their position and properties") {
+    auto *property = ndf.get_object("test_object_3").properties[0].get();
+    REQUIRE(ndf.change_object_name("test_object_3", "renamed"));
+    REQUIRE(names()[3] == "renamed");
+    REQUIRE(ndf.get_object("renamed").properties[0].get() == property);
+    REQUIRE_FALSE(ndf.change_object_name("renamed", "test_object_4"));
+  }
+
+  SECTION("bulk renames are applied at once") {
+    REQUIRE(ndf.bulk_rename_objects({{"test_object_1", "test_object_2"},
+                                     {"test_object_2", "test_object_1"},
+                                     {"test_object_5", "five"}}));
+    auto after = names();
+    REQUIRE(after.size() == 10);
+    REQUIRE(after[1] == "test_object_2");
+    REQUIRE(after[2] == "test_object_1");
+    REQUIRE(after[5] == "five");
+
+    REQUIRE_FALSE(ndf.bulk_rename_objects({{"five", "test_object_0"}}));
+    REQUIRE_FALSE(ndf.bulk_rename_objects({{"missing", "six"}}));
+    REQUIRE(names() == after);
+  }
+}
+
+TEST_CASE("index table", "[ndfbin]") {
+  NDFIndexTable<std::string> strings;
+  for (uint32_t i = 0; i < 1000; i++) {
+    auto [index, inserted] = strings.insert(std::format("string_{}", i));
+    REQUIRE(index == i);
+    REQUIRE(inserted);
+  }
+  REQUIRE(strings.insert(std::string("string_10")) ==
+          std::pair<uint32_t, bool>{10, false});
+  REQUIRE(strings.find(std::string_view("string_999")) == 999u);
+  REQUIRE_FALSE(strings.find(std::string_view("string_1000")).has_value());
+  REQUIRE(strings[42] == "string_42");
+
+  NDFIndexTable<std::vector<uint32_t>> paths;
+  paths.reserve(4);
+  REQUIRE(paths.insert(std::vector<uint32_t>{1, 2}).first == 0);
+  REQUIRE(paths.insert(std::vector<uint32_t>{1}).first == 1);
+  REQUIRE(paths.insert(std::vector<uint32_t>{1, 2}).first == 0);
+  REQUIRE(paths.find(std::vector<uint32_t>{2, 1}) == std::nullopt);
+  REQUIRE(paths.size() == 2);
+}
+
+// accepts writes only, seeking fails like it does on a pipe
+struct AppendOnlyBuffer : std::streambuf {
+  std::string data;
+
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      data.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char *s, std::streamsize count) override {
+    data.append(s, count);
+    return count;
+  }
+};
+
+TEST_CASE("buffered ndfbin writer", "[ndfbin]") {
+  NDF ndf;
+  ndf_generator::add_random_objects(ndf, 20);
+  auto obj = ndf_generator::gen_random_object();
+  obj.export_path = "$/test/nested/object";
+  for (const char *import : {"$/a/b", "$/a/b/c", "$/a/d", "$/e"}) {
+    ndf_generator::add_import_reference(obj, import);
+  }
+  ndf.add_object(std::move(obj));
+
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  std::string data = ss.str();
+
+  SECTION("buffer and file match the stream") {
+    auto buffer = ndf.save_as_ndfbin_buffer();
+    REQUIRE(std::string(reinterpret_cast<const char *>(buffer.data()),
+                        buffer.size()) == data);
+
+    fs::path path = fs::temp_directory_path() / "ndfbin_writer_test.ndfbin";
+    ndf.save_as_ndfbin(path);
+    std::ifstream file(path, std::ios::binary);
+    std::string from_file((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+    file.close();
+    fs::remove(path);
+    REQUIRE(from_file == data);
+  }
+
+  SECTION("streams that cannot seek work") {
+    AppendOnlyBuffer append_only;
+    std::ostream out(&append_only);
+    ndf.save_as_ndfbin_stream(out);
+    REQUIRE(append_only.data == data);
+  }
+
+  SECTION("import and export trees load back") {
+    NDF loaded;
+    std::stringstream in(data);
+    loaded.load_from_ndfbin_stream(in);
+    // loaded objects are named after their index, it is the last one
+    const auto &object = loaded.object_map.nth(20)->second;
+    REQUIRE(object.export_path == "$/test/nested/object");
+    std::vector<std::string> imports;
+    for (const auto &property : object.properties) {
+      if (auto *import =
+              dynamic_cast<NDFPropertyImportReference *>(property.get())) {
+        imports.push_back(import->import_name);
+      }
+    }
+    REQUIRE(imports ==
+            std::vector<std::string>{"$/a/b", "$/a/b/c", "$/a/d", "$/e"});
+  }
+}
+
+// written by the stream based writer the buffered one replaced. its objects
+// export $/test/nested/object, $/test/nested/deeper/object, $/test/other and
+// $/unrelated and import $/a/b, $/a/b/c, $/a/d and $/e
+TEST_CASE("ndfbin writer matches the previous writer", "[ndfbin]") {
+  fs::path golden_path = fs::path(TEST_DATA_DIR) / "nested_paths.ndfbin";
+  std::ifstream golden_file(golden_path, std::ios::binary);
+  REQUIRE(golden_file);
+  std::string golden((std::istreambuf_iterator<char>(golden_file)),
+                     std::istreambuf_iterator<char>());
+
+  NDF ndf;
+  std::stringstream in(golden);
+  ndf.load_from_ndfbin_stream(in);
+  REQUIRE(ndf.object_map.size() == 10);
+  REQUIRE(ndf.object_map.nth(7)->second.export_path ==
+          "$/test/nested/deeper/object");
+
+  std::stringstream ss;
+  ndf.save_as_ndfbin_stream(ss);
+  REQUIRE(ss.str() == golden);
+
+  auto buffer = ndf.save_as_ndfbin_buffer();
+  REQUIRE(std::string(reinterpret_cast<const char *>(buffer.data()),
+                      buffer.size()) == golden);
+
+  fs::path path = fs::temp_directory_path() / "ndfbin_golden_test.ndfbin";
+  ndf.save_as_ndfbin(path);
+  std::ifstream file(path, std::ios::binary);
+  std::string from_file((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+  file.close();
+  fs::remove(path);
+  REQUIRE(from_file == golden);
+}
@@ -0,0 +1,105 @@
+#include <catch2/catch_all.hpp>
+
+#include <array>
+#include <cstring>
+#include <random>
+#include <span>
+#include <sstream>
+
+#include "catch2/catch_test_macros.hpp"
+#include "ndf.hpp"
+#include "utf.hpp"
+#include "utf_transcode.hpp"
+
+static std::string to_utf8(const std::u16string &str) {
+  std::string out;
+  utf16le_to_utf8(std::as_bytes(std::span(str)), out);
+  return out;
+}
+
+// long enough runs of ascii for the SSE2 and AVX2 blocks, with one, two,
+// three and four byte sequences in between
+static void check_against_utf32() {
+  const std::u32string characters = U" azAZ09é߿Жࠀ中"
+                                    U"￿\U0001F600\U0010FFFF";
+  std::mt19937 rng(42);
+  for (int i = 0; i < 1000; i++) {
+    std::u32string str;
+    size_t length = rng() % 300;
+    bool mostly_ascii = rng() % 2;
+    for (size_t j = 0; j < length; j++) {
+      if (mostly_ascii && rng() % 32 != 0) {
+        str.push_back(U'a' + rng() % 26);
+      } else {
+        str.push_back(characters[rng() % characters.size()]);
+      }
+    }
+    auto utf16 = Utf32To16(str);
+    auto utf8 = Utf32To8(str);
+    REQUIRE(to_utf8(utf16) == utf8);
+
+    std::u16string back;
+    utf8_to_utf16le(utf8, back);
+    REQUIRE(back == utf16);
+  }
+}
+
+TEST_CASE("utf-16 transcoding", "[utf]") {
+  SECTION("strings match the utf-32 conversions") { check_against_utf32(); }
+
+  SECTION("the SSE2 blocks match the utf-32 conversions") {
+    // a no-op without AVX2, the SSE2 blocks ran above already
+    utf_transcode_disable_avx2(true);
+    struct Enable {
+      ~Enable() { utf_transcode_disable_avx2(false); }
+    } enable;
+    check_against_utf32();
+  }
+
+  SECTION("invalid input throws") {
+    REQUIRE_THROWS(to_utf8(u"abc\xDC00"));
+    REQUIRE_THROWS(to_utf8(u"abc\xD800"));
+    REQUIRE_THROWS(to_utf8(u"abc\xD800x"));
+    std::string out;
+    std::array<std::byte, 3> odd{};
+    REQUIRE_THROWS(utf16le_to_utf8(odd, out));
+
+    std::u16string utf16;
+    REQUIRE_THROWS(utf8_to_utf16le("abc\x80", utf16));
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xE4\xB8", utf16));
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xC3x", utf16));
+    // encoded surrogates
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xED\xA0\x80", utf16));
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xED\xBF\xBF", utf16));
+    // overlong forms of U+0000, U+007F, U+07FF and U+FFFF
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xC0\x80", utf16));
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xC1\xBF", utf16));
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xE0\x9F\xBF", utf16));
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xF0\x8F\xBF\xBF", utf16));
+    // past U+10FFFF
+    REQUIRE_THROWS(utf8_to_utf16le("abc\xF4\x90\x80\x80", utf16));
+    // the smallest valid forms and the code points around the surrogates
+    REQUIRE_NOTHROW(utf8_to_utf16le("\xC2\x80\xE0\xA0\x80\xF0\x90\x80\x80"
+                                    "\xED\x9F\xBF\xEE\x80\x80",
+                                    utf16));
+    REQUIRE(utf16 == u"\u0080\u0800\U00010000\uD7FF\uE000");
+  }
+
+  SECTION("wide strings keep their utf-16 length") {
+    NDF ndf;
+    NDFPropertyWideString property;
+    property.value = "Straße 中文 \U0001F600";
+    std::stringstream stream;
+    property.to_ndfbin(&ndf, stream);
+    auto data = stream.str();
+    uint32_t length;
+    std::memcpy(&length, data.data(), sizeof(length));
+    REQUIRE(length == Utf32To16(Utf8To32(property.value)).size() * 2);
+    REQUIRE(data.size() == sizeof(length) + length);
+
+    BinaryCursor cursor(std::as_bytes(std::span(data)));
+    NDFPropertyWideString decoded;
+    decoded.from_ndfbin(&ndf, cursor);
+    REQUIRE(decoded.value == property.value);
+  }
+}